@@ -0,0 +1,127 @@
+// File: bench_mixer.cpp
+// Microbenchmark of the mixing kernels against their scalar references.
+// Build with CMAKE_BUILD_TYPE=Release (and optionally DRUMPI_NATIVE_ARCH=ON)
+// for representative numbers.
+
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+
+#include "mixer.hpp"
+
+using namespace drumpi;
+using namespace audio;
+
+/*! Period size used by `start_jackd.bash`. */
+const int nFrames = 128;
+/*! Number of voices mixed per period. */
+const int nVoices = 32;
+/*! Number of periods to time. */
+const int nPeriods = 20000;
+/*! Ports each side of the main pair is repeated to, as on an 8-output
+interface. */
+const int nFanOuts = 3;
+
+typedef void (*mixFunc_t)(sample_t*, const sample_t*, float, int);
+typedef void (*mixRampFunc_t)(sample_t*, const sample_t*, float, float, int);
+typedef void (*mixInt16Func_t)(sample_t*, const int16_t*, float, int);
+typedef void (*fanFunc_t)(sample_t* const*, int, const sample_t*, int);
+
+/*! Times mixing nVoices voices into a period, nPeriods times.
+\return nanoseconds per period. */
+double timeMix(mixFunc_t f, std::vector<std::vector<sample_t>>& voices, std::vector<sample_t>& out) {
+    auto start = std::chrono::steady_clock::now();
+    for (int p = 0; p < nPeriods; p++) {
+        for (int v = 0; v < nVoices; v++) {
+            f(out.data(), voices[v].data(), 0.5f, nFrames);
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / nPeriods;
+}
+
+/*! Times mixing nVoices voices into a period with a gain ramp, nPeriods
+times.
+\return nanoseconds per period. */
+double timeMixRamp(mixRampFunc_t f, std::vector<std::vector<sample_t>>& voices, std::vector<sample_t>& out) {
+    auto start = std::chrono::steady_clock::now();
+    for (int p = 0; p < nPeriods; p++) {
+        for (int v = 0; v < nVoices; v++) {
+            f(out.data(), voices[v].data(), 0.5f, -0.001f, nFrames);
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / nPeriods;
+}
+
+/*! Times mixing nVoices 16-bit voices into a period, nPeriods times.
+\return nanoseconds per period. */
+double timeMixInt16(mixInt16Func_t f, std::vector<std::vector<int16_t>>& voices, std::vector<sample_t>& out) {
+    auto start = std::chrono::steady_clock::now();
+    for (int p = 0; p < nPeriods; p++) {
+        for (int v = 0; v < nVoices; v++) {
+            f(out.data(), voices[v].data(), 0.5f * int16Scale, nFrames);
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / nPeriods;
+}
+
+/*! Times repeating one side of the main pair to the ports past it,
+nPeriods times.
+\return nanoseconds per period. */
+double timeFan(fanFunc_t f, std::vector<sample_t>& in, sample_t* const* outs) {
+    auto start = std::chrono::steady_clock::now();
+    for (int p = 0; p < nPeriods; p++) {
+        f(outs, nFanOuts, in.data(), nFrames);
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / nPeriods;
+}
+
+int main() {
+    std::vector<std::vector<sample_t>> voices(nVoices, std::vector<sample_t>(nFrames));
+    std::vector<std::vector<int16_t>> voices16(nVoices, std::vector<int16_t>(nFrames));
+    std::vector<sample_t> out(nFrames, 0.f);
+    std::vector<std::vector<sample_t>> fans(nFanOuts, std::vector<sample_t>(nFrames));
+    sample_t* outs[nFanOuts];
+    for (int i = 0; i < nFanOuts; i++) outs[i] = fans[i].data();
+
+    for (int v = 0; v < nVoices; v++) {
+        for (int i = 0; i < nFrames; i++) {
+            voices[v][i] = float(rand()) / float(RAND_MAX) - 0.5f;
+            voices16[v][i] = (int16_t)(voices[v][i] * 32768.f);
+        }
+    }
+
+    // Warm up caches
+    timeMix(mixGain, voices, out);
+
+    double scalarMix = timeMix(mixGainScalar, voices, out);
+    double simdMix = timeMix(mixGain, voices, out);
+    double scalarRamp = timeMixRamp(mixGainRampScalar, voices, out);
+    double simdRamp = timeMixRamp(mixGainRamp, voices, out);
+    double scalarMix16 = timeMixInt16(mixGainInt16Scalar, voices16, out);
+    double simdMix16 = timeMixInt16(mixGainInt16, voices16, out);
+    double scalarFan = timeFan(fanOutScalar, out, outs);
+    double simdFan = timeFan(fanOut, out, outs);
+
+    std::cout << "Mixer kernels: " << mixerKernelName() << std::endl;
+    std::cout << nVoices << " voices x " << nFrames << " frames per period" << std::endl;
+    std::cout << "mixGain scalar: " << scalarMix << " ns/period" << std::endl;
+    std::cout << "mixGain " << mixerKernelName() << ": " << simdMix << " ns/period"
+        << " (" << scalarMix / simdMix << "x)" << std::endl;
+    std::cout << "mixGainRamp scalar: " << scalarRamp << " ns/period" << std::endl;
+    std::cout << "mixGainRamp " << mixerKernelName() << ": " << simdRamp << " ns/period"
+        << " (" << scalarRamp / simdRamp << "x, " << simdRamp / simdMix << "x mixGain)" << std::endl;
+    std::cout << "mixGainInt16 scalar: " << scalarMix16 << " ns/period" << std::endl;
+    std::cout << "mixGainInt16 " << mixerKernelName() << ": " << simdMix16 << " ns/period"
+        << " (" << scalarMix16 / simdMix16 << "x)" << std::endl;
+    std::cout << "fanOut scalar: " << scalarFan << " ns/period" << std::endl;
+    std::cout << "fanOut " << mixerKernelName() << ": " << simdFan << " ns/period"
+        << " (" << scalarFan / simdFan << "x)" << std::endl;
+
+    // Keep the results live
+    return (out[0] == 12345.f) ? 1 : 0;
+}
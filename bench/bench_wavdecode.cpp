@@ -0,0 +1,123 @@
+// File: bench_wavdecode.cpp
+// Benchmark of WAV decoding: the original per-sample decoder against the
+// bulk decoder in AudioFile::load and streaming with WaveReader.
+// Build with CMAKE_BUILD_TYPE=Release for representative numbers.
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+
+#include <AudioFile.h>
+
+/*! Length of the test file in seconds. */
+const int seconds = 10;
+/*! Sample rate of the test file. */
+const int sampleRate = 44100;
+/*! Number of decodes to time. */
+const int nRuns = 20;
+/*! Frames per WaveReader read. */
+const int chunkFrames = 4096;
+
+/*! Per-sample decoder as AudioFile used before the bulk decoders, for 16-bit
+PCM: each sample is assembled from bytes and pushed onto its channel.
+\return `true` on success. */
+bool referenceDecode(std::string path, std::vector<std::vector<float>>& samples) {
+    std::ifstream file(path, std::ios::binary);
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    // Find the format and data chunks
+    int fmt = -1, d = -1;
+    for (size_t i = 12; i + 8 <= data.size();) {
+        uint32_t size = data[i + 4] | (data[i + 5] << 8) | (data[i + 6] << 16) | (data[i + 7] << 24);
+        if (memcmp(&data[i], "fmt ", 4) == 0) fmt = i;
+        if (memcmp(&data[i], "data", 4) == 0) {
+            d = i;
+            break;
+        }
+        i += 8 + size;
+    }
+    if (fmt < 0 || d < 0) return false;
+
+    int numChannels = data[fmt + 10] | (data[fmt + 11] << 8);
+    uint32_t dataSize = data[d + 4] | (data[d + 5] << 8) | (data[d + 6] << 16) | (data[d + 7] << 24);
+    int numFrames = dataSize / (2 * numChannels);
+
+    samples.assign(numChannels, std::vector<float>());
+    for (int i = 0; i < numFrames; i++) {
+        for (int c = 0; c < numChannels; c++) {
+            int index = d + 8 + 2 * (i * numChannels + c);
+            if (index + 1 >= (int)data.size()) return false;
+            int16_t s = (int16_t)((data[index + 1] << 8) | data[index]);
+            samples[c].push_back(s / 32768.f);
+        }
+    }
+
+    return true;
+}
+
+/*! Times a decode function over nRuns runs.
+\return milliseconds per decode. */
+template <class F>
+double timeDecode(F f) {
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < nRuns; r++) f();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count() / nRuns;
+}
+
+int main() {
+    std::string path = "/tmp/drumpi_bench_" + std::to_string(getpid()) + ".wav";
+    int numFrames = seconds * sampleRate;
+
+    // Stereo 16-bit test file, like the banks
+    AudioFile<float> source;
+    source.setAudioBufferSize(2, numFrames);
+    source.setBitDepth(16);
+    source.setSampleRate(sampleRate);
+    for (int c = 0; c < 2; c++) {
+        for (int i = 0; i < numFrames; i++) source.samples[c][i] = float(rand()) / float(RAND_MAX) - 0.5f;
+    }
+    source.save(path);
+
+    std::vector<std::vector<float>> reference;
+    AudioFile<float> bulk;
+    std::vector<std::vector<float>> streamed(2, std::vector<float>(numFrames));
+
+    double tReference = timeDecode([&] { referenceDecode(path, reference); });
+    double tBulk = timeDecode([&] { bulk.load(path); });
+    double tStreamed = timeDecode([&] {
+        WaveReader<float> reader;
+        reader.open(path);
+        float* out[2];
+        for (int pos = 0; pos < numFrames;) {
+            out[0] = streamed[0].data() + pos;
+            out[1] = streamed[1].data() + pos;
+            int n = reader.read(out, chunkFrames);
+            if (n == 0) break;
+            pos += n;
+        }
+    });
+
+    // All three must agree
+    bool same = reference.size() == 2 && bulk.getNumSamplesPerChannel() == numFrames;
+    for (int c = 0; same && c < 2; c++) {
+        same = reference[c] == bulk.samples[c] && reference[c] == streamed[c];
+    }
+
+    std::remove(path.data());
+
+    std::cout << seconds << " s stereo 16-bit WAV at " << sampleRate << " Hz" << std::endl;
+    std::cout << "per-sample decode: " << tReference << " ms" << std::endl;
+    std::cout << "AudioFile::load: " << tBulk << " ms (" << tReference / tBulk << "x)" << std::endl;
+    std::cout << "WaveReader, " << chunkFrames << "-frame chunks: " << tStreamed << " ms ("
+        << tReference / tStreamed << "x)" << std::endl;
+    std::cout << "Outputs " << (same ? "match" : "DIFFER") << std::endl;
+
+    return same ? 0 : 1;
+}
@@ -32,6 +32,26 @@
 #include <unordered_map>
 #include <iterator>
 #include <algorithm>
+#include <limits>
+#include <cstdint>
+#include <type_traits>
+
+// SIMD sample conversion for the bulk WAV decoders
+#if defined (__SSE2__)
+    #include <emmintrin.h>
+    #define AUDIOFILE_SSE2
+#elif defined (__ARM_NEON) || defined (__ARM_NEON__)
+    #include <arm_neon.h>
+    #define AUDIOFILE_NEON
+#endif
+
+// The SIMD paths and memcpy reads assume WAV's little-endian byte order
+#if defined (__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+    #undef AUDIOFILE_SSE2
+    #undef AUDIOFILE_NEON
+#else
+    #define AUDIOFILE_LITTLE_ENDIAN
+#endif
 
 // disable some warnings on Windows
 #if defined (_MSC_VER)
@@ -257,6 +277,246 @@ enum AIFFAudioFormat
     Error
 };
 
+//=============================================================
+/** Bulk decoders for interleaved WAV sample data. Each decodes numFrames
+ * frames of numChannels interleaved samples into one output buffer per
+ * channel, without allocating, so they can decode straight into a
+ * caller-provided buffer.
+ */
+namespace AudioFileDecoding
+{
+    inline int16_t readInt16 (const uint8_t* p)
+    {
+        return (int16_t) (p[0] | (p[1] << 8));
+    }
+
+    inline int32_t readInt24 (const uint8_t* p)
+    {
+        int32_t v = (p[2] << 16) | (p[1] << 8) | p[0];
+        return (v ^ 0x800000) - 0x800000; // sign extend
+    }
+
+    inline int32_t readInt32 (const uint8_t* p)
+    {
+#if defined (AUDIOFILE_LITTLE_ENDIAN)
+        int32_t v;
+        memcpy (&v, p, 4);
+        return v;
+#else
+        return (int32_t) ((uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24));
+#endif
+    }
+
+    inline float readFloat32 (const uint8_t* p)
+    {
+        int32_t i = readInt32 (p);
+        float f;
+        memcpy (&f, &i, 4);
+        return f;
+    }
+
+    template <class T>
+    void decodePcm8 (const uint8_t* in, int numChannels, T* const* out, int numFrames)
+    {
+        for (int i = 0; i < numFrames; i++)
+            for (int c = 0; c < numChannels; c++)
+                out[c][i] = static_cast<T> (in[i * numChannels + c] - 128) / static_cast<T> (128.);
+    }
+
+    template <class T>
+    void decodePcm16Scalar (const uint8_t* in, int numChannels, T* const* out, int start, int numFrames)
+    {
+        for (int i = start; i < numFrames; i++)
+            for (int c = 0; c < numChannels; c++)
+                out[c][i] = static_cast<T> (readInt16 (in + 2 * (i * numChannels + c))) / static_cast<T> (32768.);
+    }
+
+    template <class T>
+    void decodePcm16 (const uint8_t* in, int numChannels, T* const* out, int numFrames)
+    {
+        decodePcm16Scalar (in, numChannels, out, 0, numFrames);
+    }
+
+    /** Single precision overload with SIMD paths for mono and stereo */
+    inline void decodePcm16 (const uint8_t* in, int numChannels, float* const* out, int numFrames)
+    {
+        int i = 0;
+
+#if defined (AUDIOFILE_SSE2)
+        const __m128 scale = _mm_set1_ps (1.f / 32768.f);
+
+        if (numChannels == 1)
+        {
+            for (; i + 8 <= numFrames; i += 8)
+            {
+                __m128i s = _mm_loadu_si128 (reinterpret_cast<const __m128i*> (in + 2 * i));
+                __m128i lo = _mm_srai_epi32 (_mm_unpacklo_epi16 (s, s), 16);
+                __m128i hi = _mm_srai_epi32 (_mm_unpackhi_epi16 (s, s), 16);
+                _mm_storeu_ps (out[0] + i, _mm_mul_ps (_mm_cvtepi32_ps (lo), scale));
+                _mm_storeu_ps (out[0] + i + 4, _mm_mul_ps (_mm_cvtepi32_ps (hi), scale));
+            }
+        }
+        else if (numChannels == 2)
+        {
+            // Each 32-bit lane holds a frame: left in the low half, right in the high half
+            for (; i + 4 <= numFrames; i += 4)
+            {
+                __m128i s = _mm_loadu_si128 (reinterpret_cast<const __m128i*> (in + 4 * i));
+                __m128i left = _mm_srai_epi32 (_mm_slli_epi32 (s, 16), 16);
+                __m128i right = _mm_srai_epi32 (s, 16);
+                _mm_storeu_ps (out[0] + i, _mm_mul_ps (_mm_cvtepi32_ps (left), scale));
+                _mm_storeu_ps (out[1] + i, _mm_mul_ps (_mm_cvtepi32_ps (right), scale));
+            }
+        }
+#elif defined (AUDIOFILE_NEON)
+        const float scale = 1.f / 32768.f;
+
+        if (numChannels == 1)
+        {
+            for (; i + 8 <= numFrames; i += 8)
+            {
+                int16x8_t s = vld1q_s16 (reinterpret_cast<const int16_t*> (in + 2 * i));
+                vst1q_f32 (out[0] + i, vmulq_n_f32 (vcvtq_f32_s32 (vmovl_s16 (vget_low_s16 (s))), scale));
+                vst1q_f32 (out[0] + i + 4, vmulq_n_f32 (vcvtq_f32_s32 (vmovl_s16 (vget_high_s16 (s))), scale));
+            }
+        }
+        else if (numChannels == 2)
+        {
+            for (; i + 8 <= numFrames; i += 8)
+            {
+                int16x8x2_t s = vld2q_s16 (reinterpret_cast<const int16_t*> (in + 4 * i));
+                for (int c = 0; c < 2; c++)
+                {
+                    vst1q_f32 (out[c] + i, vmulq_n_f32 (vcvtq_f32_s32 (vmovl_s16 (vget_low_s16 (s.val[c]))), scale));
+                    vst1q_f32 (out[c] + i + 4, vmulq_n_f32 (vcvtq_f32_s32 (vmovl_s16 (vget_high_s16 (s.val[c]))), scale));
+                }
+            }
+        }
+#endif
+
+        // Remainder, and other channel counts
+        decodePcm16Scalar (in, numChannels, out, i, numFrames);
+    }
+
+    template <class T>
+    void decodePcm24 (const uint8_t* in, int numChannels, T* const* out, int numFrames)
+    {
+        for (int i = 0; i < numFrames; i++)
+            for (int c = 0; c < numChannels; c++)
+                out[c][i] = (T) readInt24 (in + 3 * (i * numChannels + c)) / (T) 8388608.;
+    }
+
+    template <class T>
+    void decodePcm32 (const uint8_t* in, int numChannels, T* const* out, int numFrames)
+    {
+        for (int i = 0; i < numFrames; i++)
+            for (int c = 0; c < numChannels; c++)
+                out[c][i] = (T) readInt32 (in + 4 * (i * numChannels + c)) / static_cast<float> (std::numeric_limits<std::int32_t>::max());
+    }
+
+    template <class T>
+    void decodeFloat32 (const uint8_t* in, int numChannels, T* const* out, int numFrames)
+    {
+#if defined (AUDIOFILE_LITTLE_ENDIAN)
+        // Mono float data is already in place
+        if (numChannels == 1 && std::is_same<T, float>::value)
+        {
+            memcpy (out[0], in, 4 * (size_t) numFrames);
+            return;
+        }
+#endif
+        for (int i = 0; i < numFrames; i++)
+            for (int c = 0; c < numChannels; c++)
+                out[c][i] = (T) readFloat32 (in + 4 * (i * numChannels + c));
+    }
+
+    /** Decodes interleaved WAV sample data of any supported format.
+     * @Returns false if the bit depth is not supported
+     */
+    template <class T>
+    bool decode (const uint8_t* in, int bitDepth, bool isFloat, int numChannels, T* const* out, int numFrames)
+    {
+        switch (bitDepth)
+        {
+            case 8: decodePcm8 (in, numChannels, out, numFrames); return true;
+            case 16: decodePcm16 (in, numChannels, out, numFrames); return true;
+            case 24: decodePcm24 (in, numChannels, out, numFrames); return true;
+            case 32:
+                if (isFloat)
+                    decodeFloat32 (in, numChannels, out, numFrames);
+                else
+                    decodePcm32 (in, numChannels, out, numFrames);
+                return true;
+            default: return false;
+        }
+    }
+}
+
+//=============================================================
+/** Streaming WAV reader. Reads the header on open, then decodes the
+ * sample data a block at a time straight into caller-provided buffers, so
+ * a file can be decoded without holding it all in memory, or into a
+ * buffer laid out however the caller likes.
+ */
+template <class T>
+class WaveReader
+{
+public:
+    
+    //=============================================================
+    /** Constructor */
+    WaveReader();
+    
+    //=============================================================
+    /** Opens a WAV file and reads its header
+     * @Returns true if the file is a WAV file this reader can decode
+     */
+    bool open (std::string filePath);
+    
+    /** Closes the file */
+    void close();
+    
+    //=============================================================
+    /** Decodes the next frames of the file into one buffer per channel
+     * @param channels array of getNumChannels() buffers of at least numFrames samples
+     * @param numFrames the number of frames to decode
+     * @Returns the number of frames decoded, less than numFrames at the end of the file
+     */
+    int read (T* const* channels, int numFrames);
+    
+    //=============================================================
+    /** @Returns the sample rate */
+    uint32_t getSampleRate() const;
+    
+    /** @Returns the number of audio channels */
+    int getNumChannels() const;
+    
+    /** @Returns the bit depth of the file data */
+    int getBitDepth() const;
+    
+    /** @Returns the number of frames in the file */
+    int getNumSamplesPerChannel() const;
+    
+    /** @Returns the number of frames read so far */
+    int getPosition() const;
+    
+private:
+    
+    //=============================================================
+    std::ifstream file;
+    std::vector<uint8_t> block;
+    std::vector<T*> out;
+    uint32_t sampleRate;
+    int numChannels;
+    int bitDepth;
+    bool isFloat;
+    int numFrames;
+    int position;
+    
+    /** Frames decoded per file read */
+    enum { blockFrames = 4096 };
+};
+
 //=============================================================
 /* IMPLEMENTATION */
 //=============================================================
@@ -571,61 +831,25 @@ bool AudioFile<T>::decodeWaveFile (std::vector<uint8_t>& fileData)
     int numSamples = dataChunkSize / (numChannels * bitDepth / 8);
     int samplesStartIndex = indexOfDataChunk + 8;
     
+    if (samplesStartIndex + (size_t) numSamples * numBytesPerBlock > fileData.size())
+    {
+        reportError ("ERROR: read file error as the metadata indicates more samples than there are in the file data");
+        return false;
+    }
+    
     clearAudioBuffer();
     samples.resize (numChannels);
     
-    for (int i = 0; i < numSamples; i++)
+    // decode in bulk straight into the channel buffers
+    std::vector<T*> channels (numChannels);
+    for (int channel = 0; channel < numChannels; channel++)
     {
-        for (int channel = 0; channel < numChannels; channel++)
-        {
-            int sampleIndex = samplesStartIndex + (numBytesPerBlock * i) + channel * numBytesPerSample;
-            
-            if ((sampleIndex + (bitDepth / 8) - 1) >= fileData.size())
-            {
-                reportError ("ERROR: read file error as the metadata indicates more samples than there are in the file data");
-                return false;
-            }
-            
-            if (bitDepth == 8)
-            {
-                T sample = singleByteToSample (fileData[sampleIndex]);
-                samples[channel].push_back (sample);
-            }
-            else if (bitDepth == 16)
-            {
-                int16_t sampleAsInt = twoBytesToInt (fileData, sampleIndex);
-                T sample = sixteenBitIntToSample (sampleAsInt);
-                samples[channel].push_back (sample);
-            }
-            else if (bitDepth == 24)
-            {
-                int32_t sampleAsInt = 0;
-                sampleAsInt = (fileData[sampleIndex + 2] << 16) | (fileData[sampleIndex + 1] << 8) | fileData[sampleIndex];
-                
-                if (sampleAsInt & 0x800000) //  if the 24th bit is set, this is a negative number in 24-bit world
-                    sampleAsInt = sampleAsInt | ~0xFFFFFF; // so make sure sign is extended to the 32 bit float
-
-                T sample = (T)sampleAsInt / (T)8388608.;
-                samples[channel].push_back (sample);
-            }
-            else if (bitDepth == 32)
-            {
-                int32_t sampleAsInt = fourBytesToInt (fileData, sampleIndex);
-                T sample;
-                
-                if (audioFormat == WavAudioFormat::IEEEFloat)
-                    sample = (T)reinterpret_cast<float&> (sampleAsInt);
-                else // assume PCM
-                    sample = (T) sampleAsInt / static_cast<float> (std::numeric_limits<std::int32_t>::max());
-                
-                samples[channel].push_back (sample);
-            }
-            else
-            {
-                assert (false);
-            }
-        }
+        samples[channel].resize (numSamples);
+        channels[channel] = samples[channel].data();
     }
+    
+    AudioFileDecoding::decode (fileData.data() + samplesStartIndex, bitDepth, audioFormat == WavAudioFormat::IEEEFloat,
+                               numChannels, channels.data(), numSamples);
 
     // -----------------------------------------------------------
     // iXML CHUNK
@@ -1284,6 +1508,177 @@ void AudioFile<T>::reportError (std::string errorMessage)
         std::cout << errorMessage << std::endl;
 }
 
+//=============================================================
+template <class T>
+WaveReader<T>::WaveReader()
+{
+    static_assert(std::is_floating_point<T>::value, "ERROR: WaveReader only supports floating point sample formats");
+    
+    sampleRate = 0;
+    numChannels = 0;
+    bitDepth = 0;
+    isFloat = false;
+    numFrames = 0;
+    position = 0;
+}
+
+//=============================================================
+template <class T>
+bool WaveReader<T>::open (std::string filePath)
+{
+    close();
+    file.open (filePath, std::ios::binary);
+    
+    uint8_t header[12];
+    if (! file.read (reinterpret_cast<char*> (header), 12) || memcmp (header, "RIFF", 4) != 0 || memcmp (header + 8, "WAVE", 4) != 0)
+    {
+        close();
+        return false;
+    }
+    
+    // walk the chunks until the data chunk, which must follow the format chunk
+    bool haveFormat = false;
+    uint16_t numBytesPerBlock = 0;
+    uint8_t chunk[8];
+    
+    while (file.read (reinterpret_cast<char*> (chunk), 8))
+    {
+        uint32_t chunkSize = (uint32_t) AudioFileDecoding::readInt32 (chunk + 4);
+        
+        if (memcmp (chunk, "fmt ", 4) == 0)
+        {
+            uint8_t f[40] = {0};
+            uint32_t n = std::min<uint32_t> (chunkSize, sizeof (f));
+            if (n < 16 || ! file.read (reinterpret_cast<char*> (f), n))
+                break;
+            
+            uint16_t audioFormat = (uint16_t) AudioFileDecoding::readInt16 (f);
+            
+            // extensible files keep the real format at the start of the sub-format GUID
+            if (audioFormat == WavAudioFormat::Extensible && n >= 26)
+                audioFormat = (uint16_t) AudioFileDecoding::readInt16 (f + 24);
+            
+            numChannels = (uint16_t) AudioFileDecoding::readInt16 (f + 2);
+            sampleRate = (uint32_t) AudioFileDecoding::readInt32 (f + 4);
+            numBytesPerBlock = (uint16_t) AudioFileDecoding::readInt16 (f + 12);
+            bitDepth = (uint16_t) AudioFileDecoding::readInt16 (f + 14);
+            isFloat = audioFormat == WavAudioFormat::IEEEFloat;
+            
+            haveFormat = (audioFormat == WavAudioFormat::PCM || isFloat) && (! isFloat || bitDepth == 32)
+                && (bitDepth == 8 || bitDepth == 16 || bitDepth == 24 || bitDepth == 32)
+                && numChannels >= 1 && numChannels <= 128 && numBytesPerBlock == numChannels * (bitDepth / 8);
+            
+            if (! haveFormat)
+                break;
+            
+            file.seekg (chunkSize - n + (chunkSize & 1), std::ios::cur);
+        }
+        else if (memcmp (chunk, "data", 4) == 0)
+        {
+            if (! haveFormat)
+                break;
+            
+            numFrames = (int) (chunkSize / numBytesPerBlock);
+            position = 0;
+            block.resize ((size_t) blockFrames * numBytesPerBlock);
+            out.resize (numChannels);
+            return true;
+        }
+        else
+        {
+            // chunks are padded to an even length
+            file.seekg (chunkSize + (chunkSize & 1), std::ios::cur);
+        }
+    }
+    
+    close();
+    return false;
+}
+
+//=============================================================
+template <class T>
+void WaveReader<T>::close()
+{
+    if (file.is_open())
+        file.close();
+    
+    file.clear();
+    numFrames = 0;
+    position = 0;
+}
+
+//=============================================================
+template <class T>
+int WaveReader<T>::read (T* const* channels, int framesToRead)
+{
+    int numBytesPerBlock = numChannels * (bitDepth / 8);
+    int done = 0;
+    framesToRead = std::min (framesToRead, numFrames - position);
+    
+    std::copy (channels, channels + numChannels, out.begin());
+    
+    while (done < framesToRead)
+    {
+        int n = std::min (framesToRead - done, (int) blockFrames);
+        bool truncated = ! file.read (reinterpret_cast<char*> (block.data()), (std::streamsize) n * numBytesPerBlock);
+        
+        // short file: keep the whole frames that were read
+        if (truncated)
+            n = (int) (file.gcount() / numBytesPerBlock);
+        
+        AudioFileDecoding::decode (block.data(), bitDepth, isFloat, numChannels, out.data(), n);
+        
+        for (int c = 0; c < numChannels; c++)
+            out[c] += n;
+        
+        done += n;
+        position += n;
+        
+        if (truncated)
+        {
+            numFrames = position;
+            break;
+        }
+    }
+    
+    return done;
+}
+
+//=============================================================
+template <class T>
+uint32_t WaveReader<T>::getSampleRate() const
+{
+    return sampleRate;
+}
+
+//=============================================================
+template <class T>
+int WaveReader<T>::getNumChannels() const
+{
+    return numChannels;
+}
+
+//=============================================================
+template <class T>
+int WaveReader<T>::getBitDepth() const
+{
+    return bitDepth;
+}
+
+//=============================================================
+template <class T>
+int WaveReader<T>::getNumSamplesPerChannel() const
+{
+    return numFrames;
+}
+
+//=============================================================
+template <class T>
+int WaveReader<T>::getPosition() const
+{
+    return position;
+}
+
 #if defined (_MSC_VER)
     __pragma(warning (pop))
 #elif defined (__GNUC__)
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "/root/repo/lib/cppTimer/libcpptimer.a"
+  "/root/repo/lib/cppTimer/libcpptimer.pdb"
+  "CMakeFiles/cpptimer.dir/CppTimer.cpp.o"
+  "CMakeFiles/cpptimer.dir/CppTimer.cpp.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/cpptimer.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
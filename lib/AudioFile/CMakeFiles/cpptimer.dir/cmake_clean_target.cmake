@@ -0,0 +1,3 @@
+file(REMOVE_RECURSE
+  "/root/repo/lib/cppTimer/libcpptimer.a"
+)
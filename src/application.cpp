@@ -1,6 +1,12 @@
 //application.cpp
 
 #include <iostream>
+#include <thread>
+#include <chrono>
+#include <cerrno>
+
+#include <sys/eventfd.h>
+#include <unistd.h>
 
 #include "application.hpp"
 
@@ -13,6 +19,10 @@ DisplayClock::DisplayClock(ApplicationCallback* a) {
     appc = a;
 }
 
+DisplayClock::~DisplayClock() {
+	stop();
+}
+
 void DisplayClock::tick() {
 	Application* app = static_cast<Application*>(appc);
 
@@ -26,6 +36,10 @@ DisplayDelay::DisplayDelay(ApplicationCallback* a) {
     appc = a;
 }
 
+DisplayDelay::~DisplayDelay() {
+	stop();
+}
+
 void DisplayDelay::trigger() {
 	Application* app = static_cast<Application*>(appc);
 	app->displayState = app->mode; // Reset to primary display mode after timeout
@@ -82,7 +96,7 @@ bool PerformanceMode::interpretKeyPress(ApplicationCallback* appc, int key) {
 		case KEY_L:
 		case KEY_SEMICOLON:
 			// Trigger the drum sound
-			app->playbackEngine.trigger(interpretDrumKey(key));
+			app->playbackEngine.trigger(interpretDrumKey(key), app->inputTime);
 			actionFlag = true;
 			break;
 	}
@@ -122,7 +136,7 @@ bool SequencerMode::interpretKeyPress(ApplicationCallback* appc, int key) {
 			// Interpret the drum key
 			currentdrum = interpretDrumKey(key);
 			// Trigger the drum sound
-			app->playbackEngine.trigger(currentdrum);
+			app->playbackEngine.trigger(currentdrum, app->inputTime);
 			actionFlag = true;
 			break;
 		
@@ -212,7 +226,7 @@ bool SetTempoMode::interpretKeyPress(ApplicationCallback* appc, int key) {
 
 void SetTempoMode::updateDisplay(ApplicationCallback* appc) {
 	Application* app = static_cast<Application*>(appc);
-	app->display.setVal(app->seqClocker->getRateBPM()/4, true);
+	app->display.setVal((unsigned int)(app->seqClocker->getRateBPM() / 4), true);
 }
 
 
@@ -267,14 +281,14 @@ bool SetDrumVolumeMode::interpretKeyPress(ApplicationCallback *appc, int key) {
 			// Increase selected drum's volume
 			app->playbackEngine.volumeUp(drumselected);
 			// Trigger selected drum for user reference
-			if (triggerDrums) app->playbackEngine.trigger(drumselected);
+			if (triggerDrums) app->playbackEngine.trigger(drumselected, app->inputTime);
 			actionFlag = true;
 			break;
 		case KEY_COMMA:
 			// Decrease selected drum's volume
 			app->playbackEngine.volumeDown(drumselected);
 			// Trigger selected drum for user reference
-			if (triggerDrums) app->playbackEngine.trigger(drumselected);
+			if (triggerDrums) app->playbackEngine.trigger(drumselected, app->inputTime);
 			actionFlag = true;
 			break;
 		
@@ -289,7 +303,7 @@ bool SetDrumVolumeMode::interpretKeyPress(ApplicationCallback *appc, int key) {
 			// Interpret the drum key
 			drumselected = interpretDrumKey(key);
 			// Trigger the drum sound
-			app->playbackEngine.trigger(drumselected);
+			app->playbackEngine.trigger(drumselected, app->inputTime);
 			actionFlag = true;
 			break;
 
@@ -312,27 +326,28 @@ void SetDrumVolumeMode::updateDisplay(ApplicationCallback* appc) {
 SetDrumBankMode::SetDrumBankMode() {
 	// Default bank
 	bank = 1;
-	safeBank = bank;
 	label = SET_DRUM_BANK_MODE;
 }
 
 bool SetDrumBankMode::interpretKeyPress(ApplicationCallback* appc, int key) {
 	Application* app = static_cast<Application*>(appc);
-	audio::sampleSourceStatus_t loadStatus = audio::SOURCE_READY;
 	bool actionFlag = false;
+
+	checkLoad(app);
+
 	switch (key) {
 		case KEY_DOT:
 			// Bank up
 			bank++;
-			// Load the bank
-			loadStatus = app->playbackEngine.loadBank(bank, audio::SOURCE_PREGENERATED);
+			// Load the bank in the background
+			app->playbackEngine.requestBank(bank, audio::SOURCE_PREGENERATED);
 			actionFlag = true;
 			break;
 		case KEY_COMMA:
 			// Bank down
 			if (bank > 0) bank--;
-			// Load the bank
-			loadStatus = app->playbackEngine.loadBank(bank, audio::SOURCE_PREGENERATED);
+			// Load the bank in the background
+			app->playbackEngine.requestBank(bank, audio::SOURCE_PREGENERATED);
 			actionFlag = true;
 			break;
 		
@@ -345,28 +360,32 @@ bool SetDrumBankMode::interpretKeyPress(ApplicationCallback* appc, int key) {
 		case KEY_L:
 		case KEY_SEMICOLON:
 			// Trigger the relevant drum sound
-			app->playbackEngine.trigger(interpretDrumKey(key));
+			app->playbackEngine.trigger(interpretDrumKey(key), app->inputTime);
 			actionFlag = true;
 			break;
 	}
 
-	if (loadStatus != audio::SOURCE_READY) {
-		std::cout << std::endl << "Could not load bank " << bank << std::endl;
-		std::cout << "Returning to bank " << safeBank << std::endl;
-		bank = safeBank;
-		app->playbackEngine.loadBank(bank, audio::SOURCE_PREGENERATED);
-	} else {
-		safeBank = bank;
-	}
-
 	return actionFlag;
 }
 
 void SetDrumBankMode::updateDisplay(ApplicationCallback* appc) {
 	Application* app = static_cast<Application*>(appc);
+	checkLoad(app);
 	app->display.setVal(getBank(), true);
 }
 
+void SetDrumBankMode::checkLoad(Application* app) {
+	if (app->playbackEngine.isLoading()) return;
+
+	// A failed load leaves the previous bank playing
+	int loaded = app->playbackEngine.getBank();
+	if (loaded >= 0 && bank != loaded) {
+		std::cout << std::endl << "Could not load bank " << bank << std::endl;
+		std::cout << "Returning to bank " << loaded << std::endl;
+		bank = loaded;
+	}
+}
+
 int SetDrumBankMode::getBank() {
 	return bank;
 }
@@ -379,22 +398,51 @@ Application::Application() {
 	subMode = &setMasterVolumeMode;
 	displayState = mode;
 	running = true;
+	statsRequested = false;
+	quitFd = eventfd(0, EFD_CLOEXEC);
 }
 
-void Application::setup() {
+Application::~Application() {
+	if (audioEngine) audioEngine->stop();
+	if (quitFd >= 0) close(quitFd);
+}
+
+void Application::setup(audio::audioBackendType_t backend, bool directOuts, audio::sampleFormat_t format,
+	float streamSeconds)
+{
 	// Connect keyboard thread to Application
 	kbdThread.kbdIn.connectCallback(this);
 
-	// Jack client
-	audioEngine.reset(new audio::JackClient("DrumPi"));
+	// Audio output, with a pair of ports per drum for direct outputs
+	int nOutPorts = directOuts ? audio::PlaybackEngine::numDirectOuts : 2;
+	switch (backend) {
+		case audio::BACKEND_NULL:
+			audioEngine.reset(new audio::NullBackend(48000, 128, nOutPorts));
+			break;
+		case audio::BACKEND_JACK:
+		default:
+			// Only the main mix is connected to the hardware
+			audioEngine.reset(new audio::JackClient("DrumPi", nOutPorts, 0, 2));
+			break;
+	}
+	playbackEngine.setDirectOuts(directOuts);
+
+	// Load samples at the server's rate, in the requested format
+	playbackEngine.prepare(audioEngine->getSampleRate(), audioEngine->getBufferSize());
+	playbackEngine.setSampleFormat(format);
+	playbackEngine.setStreamThreshold(streamSeconds);
 
 	// Get the PlaybackEngine to load the audio samples for bank 1
 	playbackEngine.loadBank(setDrumBankMode.getBank(), audio::SOURCE_PREGENERATED);
+	// and have the banks either side ready to switch to
+	playbackEngine.preloadAround(setDrumBankMode.getBank(), audio::SOURCE_PREGENERATED);
 
 	// Sequencer
-	seq.reset(new Sequencer(16));
-	// SequencerClock
-	seqClocker.reset(new SequencerClock(seq, playbackEngine));
+	seq.reset(new Sequencer(numSteps));
+	song.addPattern(seq);
+	// SequencerClock, clocked sample-accurately by the audio callback
+	seqClocker.reset(new SequencerClock(seq, playbackEngine, true));
+	seqClocker->setSong(&song);
 
 	// DisplayClock
 	displayClock.reset(new DisplayClock(this));
@@ -411,15 +459,61 @@ void Application::run() {
 
 	kbdThread.start();
 
-	while(running) {}
+	// Sleep until quit() is called
+	uint64_t count;
+	while (running) {
+		if (quitFd < 0) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(100));
+		} else if (read(quitFd, &count, sizeof(count)) < 0 && errno != EINTR) {
+			break;
+		}
+
+		if (statsRequested.exchange(false)) printStats(std::cout);
+	}
 
+	// Stop taking input first, then whatever drives the audio, then the audio
 	kbdThread.stop();
 
+	if (displayDelay->isActive()) displayDelay->stop();
 	displayClock->stop();
 
+	seqClocker->stop();
+
 	audioEngine->stop();
 }
 
+void Application::requestStats() {
+	statsRequested = true;
+
+	uint64_t one = 1;
+	if (quitFd >= 0) {
+		ssize_t r = write(quitFd, &one, sizeof(one));
+		(void)r;
+	}
+}
+
+void Application::printStats(std::ostream& os) {
+	os << std::endl << "Key-to-sound latency:" << std::endl;
+	playbackEngine.getLatencyStats().dump(os);
+
+	if (audioEngine) {
+		os << "Audio thread:" << std::endl;
+		audio::AudioStats::dump(os, audioEngine->getStats());
+	}
+
+	os << "Disk stream underruns: " << playbackEngine.getStreamer().getUnderruns() << std::endl;
+}
+
+void Application::quit() {
+	running = false;
+
+	uint64_t one = 1;
+	if (quitFd >= 0) {
+		ssize_t r = write(quitFd, &one, sizeof(one));
+		(void)r;
+	}
+}
+
 void Application::interpretKeyPress(int key) {
 	bool actionFlag;
 
@@ -5,16 +5,22 @@
 
 #include <string>
 #include <memory>
+#include <atomic>
+#include <ostream>
 
 #include "applicationcallback.hpp"
 #include "audio.hpp"
+#include "nullBackend.hpp"
 #include "playback.hpp"
 #include "display.hpp"
 #include "sequencer.hpp"
+#include "song.hpp"
 #include "keyboardthread.hpp"
 
 namespace drumpi {
-	
+
+class Application;
+
 /*! \ref clock::Metronome derived class to clock a \ref Display. */
 class DisplayClock : public clock::Clock {
 public:
@@ -23,6 +29,10 @@ public:
 	\param a \ref Application object to update. */
 	DisplayClock(ApplicationCallback* a);
 
+	/*! Destructor.
+	Stops the clock before the object is torn down. */
+	~DisplayClock();
+
 	/*! Override the tick method.
 	Clocks the \ref Application. */
 	void tick() override;
@@ -42,6 +52,10 @@ public:
 	\param a \ref Application object to be clocked. */
 	DisplayDelay(ApplicationCallback* a);
 
+	/*! Destructor.
+	Stops the timer before the object is torn down. */
+	~DisplayDelay();
+
 	/*! Override the tick method.
 	Clocks the \ref Application. */
 	void trigger() override;
@@ -226,10 +240,13 @@ public:
 	int getBank();
 
 private:
+	/*! Reverts the selected bank if its load failed.
+	 * @param app The main \ref Application.
+	 */
+	void checkLoad(Application* app);
+
 	/*! Current bank selected. */
 	int bank;
-	/*! The last bank successfully loaded. */
-	int safeBank;
 };
 
 
@@ -246,22 +263,58 @@ public:
 	/*! Constructor */
 	Application();
 
+	/*! Destructor.
+	 * 
+	 * Makes sure the audio stream has stopped before the
+	 * \ref audio::PlaybackEngine it calls is destroyed.
+	 */
+	~Application();
+
 	/*! \brief Sets up the application. 
 	 * 
 	 * This method is called on startup to perform various set up tasks,
 	 * including connecting the \ref Application to the \ref KeyboardInput
 	 * as a callback, resetting the sequencer and display,
 	 * and loading the drum sample bank.
+	 * @param backend \ref audio::audioBackendType_t of the audio output to use.
+	 * @param directOuts if `true`, each drum is also sent to its own pair of
+	 * outputs for external mixing, see \ref audio::PlaybackEngine::render.
+	 * @param format \ref audio::sampleFormat_t to hold samples in;
+	 * \ref audio::SAMPLE_INT16 halves their memory.
+	 * @param streamSeconds samples longer than this many seconds are
+	 * streamed from disk, or 0 to load every sample whole.
 	 */
-	void setup();
+	void setup(audio::audioBackendType_t backend = audio::BACKEND_JACK, bool directOuts = false,
+		audio::sampleFormat_t format = audio::SAMPLE_FLOAT32, float streamSeconds = 0.f);
 
 	/*! \brief Runs the application.
 	 * 
 	 * This method is called on startup after setup has been
 	 * performed, starting the audio engine, the display refresh clock,
-	 * and creating the keyboard thread.
+	 * and creating the keyboard thread. It then sleeps until \ref quit
+	 * is called, and shuts everything down again before returning.
 	 */
 	void run();
+
+	/*!
+	 * \brief Asks \ref run to return.
+	 * 
+	 * Only sets a flag and writes to an eventfd, so it is safe to call
+	 * from a signal handler or any thread.
+	 */
+	void quit() override;
+
+	/*!
+	 * \brief Asks \ref run to print the latency and audio thread statistics.
+	 * 
+	 * Safe to call from a signal handler or any thread.
+	 */
+	void requestStats();
+
+	/*! Prints the key-to-sound latency and audio thread statistics.
+	 * @param os Stream to print to.
+	 */
+	void printStats(std::ostream& os);
 	
 	/*! 
 	 * This method is called by \ref KeyboardInput when a keyboard event occurs.
@@ -308,7 +361,7 @@ public:
 	KeyboardThread kbdThread;
 
 	/*! AudioEngine object. */
-	std::unique_ptr<audio::JackClient> audioEngine = nullptr;
+	std::unique_ptr<audio::AudioBackend> audioEngine = nullptr;
 	
 	/*! DisplayClock object. */
 	std::unique_ptr<DisplayClock> displayClock = nullptr;
@@ -325,9 +378,23 @@ public:
 	/*! Sequencer object. */
 	std::shared_ptr<Sequencer> seq = nullptr;
 
+	/*! Song holding the patterns, with \ref seq as pattern 0. Outlives
+	\ref seqClocker. */
+	Song song;
+
+	/*! Steps in \ref seq, two pages of 8 in sequencer mode. */
+	const int numSteps = 16;
+
 	/*! SequencerClock object used to clock the Sequencer. */
 	std::unique_ptr<SequencerClock> seqClocker = nullptr;
 
+private:
+	/*! Eventfd written by \ref quit and \ref requestStats to wake \ref run. */
+	int quitFd;
+
+	/*! Set by \ref requestStats. */
+	std::atomic<bool> statsRequested;
+
 };
 
 } // namespace drumpi
@@ -3,6 +3,9 @@
 #ifndef APPLICATIONCALLBACK_H
 #define APPLICATIONCALLBACK_H
 
+#include <atomic>
+#include <cstdint>
+
 #include "defs.hpp"
 
 namespace drumpi {
@@ -16,8 +19,16 @@ public:
     /*! Virtual function to be overridden by derived class. */
     virtual void setState(stateLabel_t newstate) = 0;
     
+    /*! Asks the application to shut down.
+    Must be safe to call from a signal handler. */
+    virtual void quit() = 0;
+
     /*! Running flag for the application. */
-    bool running;
+    std::atomic<bool> running;
+
+    /*! `CLOCK_MONOTONIC` time in ns of the input event being interpreted,
+    or 0 if unknown. Set before each call to \ref interpretKeyPress. */
+    uint64_t inputTime = 0;
 };
 
 } //namespace drumpi
@@ -1,14 +1,18 @@
 // File: audio.cpp
 #include <audio.hpp>
+#include "latency.hpp"
+
+#include <algorithm>
 
 using namespace drumpi;
 using namespace audio;
 
-JackClient::JackClient(std::string clientName, int nOutPorts, int nInPorts) {
+JackClient::JackClient(std::string clientName, int nOutPorts, int nInPorts, int nConnect) {
     open = false;
     running = false;
 
     setNumPorts(nOutPorts, nInPorts);
+    this->nConnect = (nConnect < 0) ? nOutPorts : std::min(nConnect, nOutPorts);
 
     // Establish client name
     this->clientName = clientName;
@@ -68,7 +72,10 @@ audioError_t JackClient::start(AudioCallback& callback) {
 
     // Set up callback
     this->callback = &callback;
+    sampleRate = getSampleRate();
+    callback.prepare(sampleRate, getBufferSize());
     jack_set_process_callback(client, JackClient::_process, this);
+    jack_set_xrun_callback(client, JackClient::_xrun, this);
 
     // Activate Jack client
     int err = jack_activate(client);
@@ -81,8 +88,9 @@ audioError_t JackClient::start(AudioCallback& callback) {
 
     // Get port names(?)
     // Output ports are inputs as they are 'input' to the backend
+    // Connect as many as there are hardware outputs; the list ends in NULL
     const char** portsTemp = jack_get_ports(client, NULL, NULL, JackPortIsPhysical|JackPortIsInput);
-    for (int i = 0; i < ports.size(); i++) {
+    for (int i = 0; portsTemp && i < nConnect && portsTemp[i]; i++) {
         ports[i] = portsTemp[i];
         err = jack_connect(
             client,
@@ -124,29 +132,53 @@ bool JackClient::isRunning() {
     return running;
 }
 
+int JackClient::getSampleRate() {
+    if (!open) return 0;
+    return jack_get_sample_rate(client);
+}
+
+int JackClient::getBufferSize() {
+    if (!open) return 0;
+    return jack_get_buffer_size(client);
+}
+
+AudioStatsSnapshot JackClient::getStats() {
+    AudioStatsSnapshot s = stats.read();
+    if (open) s.cpuLoad = jack_cpu_load(client);
+    return s;
+}
+
 int JackClient::_process(jack_nframes_t nFrames, void *arg) {
     // `arg` should be a pointer to the JackClient object
     JackClient* self = static_cast<JackClient*>(arg);
-    // Vector of pointers to sample buffers
-    // Not 2D vector as `jack_port_get_buffer` returns a pointer, not values
-    std::vector<sample_t*> out(self->outPorts.size());
-    std::vector<sample_t> samples(nFrames);
+    uint64_t startTime = monotonicTime();
 
-    samples = self->callback->getSamples(nFrames);
-
-    for (int i = 0; i < out.size(); i++) { // For each port...
+    for (int i = 0; i < self->outPorts.size(); i++) { // For each port...
         // Get a sample memory buffer for each port
-        out[i] = (sample_t*)jack_port_get_buffer(self->outPorts[i], nFrames);
+        self->outBuffers[i] = (sample_t*)jack_port_get_buffer(self->outPorts[i], nFrames);
+    }
 
-        for (int j = 0; j < nFrames; j++) { // For each frame/sample...
-            // Copy retrieved samples to output
-            out[i][j] = samples[j];
-        }
+    // The period being rendered starts playing one period after this cycle
+    // began; Jack's clock is CLOCK_MONOTONIC in microseconds
+    jack_nframes_t frame = jack_last_frame_time(self->client);
+    self->callback->setOutputTime(jack_frames_to_time(self->client, frame + nFrames) * 1000ULL);
+
+    // Render straight into the port buffers
+    self->callback->render(self->outBuffers.data(), self->outBuffers.size(), nFrames);
+
+    // Time spent against the period's budget
+    if (self->sampleRate > 0) {
+        self->stats.recordPeriod(monotonicTime() - startTime, (nFrames * 1000000000ULL) / self->sampleRate);
     }
 
     return NO_ERROR;
 }
 
+int JackClient::_xrun(void *arg) {
+    static_cast<JackClient*>(arg)->stats.recordXrun();
+    return 0;
+}
+
 void JackClient::_shutdown(void *arg) {
     // If Jack calls this, close the program.
     exit(1);
@@ -154,6 +186,7 @@ void JackClient::_shutdown(void *arg) {
 
 void JackClient::setNumPorts(int nOutPorts, int nInPorts) {
     outPorts.resize(nOutPorts);
+    outBuffers.resize(nOutPorts);
     inPorts.resize(nInPorts);
     ports.resize(nOutPorts + nInPorts);
 }
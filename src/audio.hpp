@@ -5,10 +5,12 @@
 #include <vector>
 #include <string>
 #include <memory>
+#include <cstdint>
 
 #include <jack/jack.h>
 
 #include "defs.hpp"
+#include "audioStats.hpp"
 
 namespace drumpi {
 namespace audio {
@@ -18,20 +20,78 @@ class AudioCallback {
     public:
         /*! Called by a \ref JackClient object when samples are requested by
         Jack.
-        \param nSamples the number of samples requested.
-        \return a vector of samples, of type \ref sample_t (`float`) */
-        virtual std::vector<sample_t> getSamples(int nSamples) = 0;
+        Runs on the real-time audio thread, so implementations must not
+        allocate, lock or otherwise block.
+        \param outs array of output buffers, one per port, each of length
+        nFrames.
+        \param nOuts number of output buffers.
+        \param nFrames number of frames to write to each buffer. */
+        virtual void render(sample_t* const* outs, int nOuts, int nFrames) = 0;
+
+        /*! Called by a \ref JackClient object before processing starts, so
+        the callback can size its buffers and timing for the server.
+        \param sampleRate server sample rate in Hz.
+        \param bufferSize server period size in frames. */
+        virtual void prepare(int sampleRate, int bufferSize) {}
+
+        /*! Called by the backend before each \ref render with the time at
+        which the first frame of the period will be played, for latency
+        measurement. Runs on the real-time audio thread.
+        \param ns `CLOCK_MONOTONIC` time in nanoseconds. */
+        virtual void setOutputTime(uint64_t ns) {}
+};
+
+/*! Abstract audio output backend.
+Drives an \ref AudioCallback from the backend's own real-time thread. */
+class AudioBackend {
+    public:
+        /*! Destructor. */
+        virtual ~AudioBackend() {}
+
+        /*! Starts calling the callback for output samples.
+        \param callback \ref AudioCallback object to fetch output samples from.
+        \return error code. */
+        virtual audioError_t start(AudioCallback& callback) = 0;
+
+        /*! Stops the backend.
+        \param closeClient whether to close the backend or just deactivate it.
+        \return error code. */
+        virtual audioError_t stop(bool closeClient = true) = 0;
+
+        /*! Check if the backend is open.
+        \return `true` if the backend is open. */
+        virtual bool isOpen() = 0;
+
+        /*! Check if the backend is running.
+        \return `true` if the backend is running. */
+        virtual bool isRunning() = 0;
+
+        /*! Returns the backend's sample rate.
+        \return sample rate in Hz. */
+        virtual int getSampleRate() = 0;
+
+        /*! Returns the backend's period size.
+        \return period size in frames. */
+        virtual int getBufferSize() = 0;
+
+        /*! Returns the callback timing and xrun statistics.
+        Call from a non-real-time thread.
+        \return the statistics. */
+        virtual AudioStatsSnapshot getStats() = 0;
 };
 
 /*! Audio engine class for interacting with the Jack server. */
-class JackClient {
+class JackClient : public AudioBackend {
     public:
         /*! Constructor.
         Specifies parameters to Jack.
         \param clientName requested client name in Jack.
         \param nOutPorts number of output ports. Default 2.
-        \param nInPorts number of input ports. Default 0. */
-        JackClient(std::string clientName, int nOutPorts = JackClient::defNumOutPorts, int nInPorts = JackClient::defNumInPorts);
+        \param nInPorts number of input ports. Default 0.
+        \param nConnect number of output ports to connect to the hardware
+        outputs on start, or -1 for all. Default -1. */
+        JackClient(std::string clientName, int nOutPorts = JackClient::defNumOutPorts, int nInPorts = JackClient::defNumInPorts,
+            int nConnect = -1);
 
         /*! Destructor.
         Closes the Jack client. */
@@ -40,21 +100,34 @@ class JackClient {
         /*! Informs Jack that the program is ready to go.
         \param callback \ref AudioCallback object to fetch output samples from.
         \return error code. */
-        audioError_t start(AudioCallback& callback);
+        audioError_t start(AudioCallback& callback) override;
 
         /*! Stops the Jack engine.
         \param closeClient whether to close the Jack client or just deactivate 
         it.
         \return error code. */
-        audioError_t stop(bool closeClient = true);
+        audioError_t stop(bool closeClient = true) override;
 
         /*! Check if the Jack client is open.
         \return `true` if the client is open. */
-        bool isOpen();
+        bool isOpen() override;
 
         /*! Check if the Jack client is running.
         \return `true` if the client is running. */
-        bool isRunning();
+        bool isRunning() override;
+
+        /*! Returns the Jack server's sample rate.
+        \return sample rate in Hz, or 0 if the client is not open. */
+        int getSampleRate() override;
+
+        /*! Returns the Jack server's period size.
+        \return period size in frames, or 0 if the client is not open. */
+        int getBufferSize() override;
+
+        /*! Returns the callback timing and xrun statistics, with the Jack
+        server's DSP load sampled now.
+        \return the statistics. */
+        AudioStatsSnapshot getStats() override;
 
         /*! Read method to send output buffer to the Jack server.
         Called by Jack when samples are needed.
@@ -67,6 +140,11 @@ class JackClient {
         or disconnect the client.
         \param arg 0. */
         static void _shutdown(void *arg);
+
+        /*! Xrun method to count xruns reported by the Jack server.
+        \param arg pointer to the \ref JackClient (`this`) object.
+        \return 0. */
+        static int _xrun(void *arg);
     
     private:
         /*! Pointer to the \ref AudioCallback object that fetches output
@@ -89,15 +167,25 @@ class JackClient {
         std::string clientName;
         /*! Jack output ports. */
         std::vector<jack_port_t*> outPorts;
+        /*! Output port buffer pointers, refreshed each period.
+        Sized with \ref outPorts so \ref _process never allocates. */
+        std::vector<sample_t*> outBuffers;
         /*! Jack input ports. Not (yet) implemented. */
         std::vector<jack_port_t*> inPorts;
         /*! Jack ports string. */
         std::vector<std::string> ports;
+        /*! Number of output ports connected on start. */
+        int nConnect;
         /*! Jack options. */
         jack_options_t options = JackNullOption;
         /*! Jack status. */
         jack_status_t jackStatus;
 
+        /*! Callback timing and xrun statistics. */
+        AudioStats stats;
+        /*! Sample rate cached for timing the callback. */
+        int sampleRate = 0;
+
         /*! \ref JackClient error status. */
         audioError_t errorStatus = NO_ERROR;
 
@@ -0,0 +1,68 @@
+// File: audioStats.cpp
+#include "audioStats.hpp"
+
+#include <vector>
+#include <algorithm>
+
+using namespace drumpi;
+using namespace audio;
+
+AudioStats::AudioStats() {
+    reset();
+}
+
+void AudioStats::recordPeriod(uint64_t durationNs, uint64_t budgetNs) {
+    if (budgetNs == 0) return;
+
+    uint64_t n = periods.load(std::memory_order_relaxed);
+    uint64_t load = (durationNs * loadScale) / budgetNs;
+
+    loads[n % window].store((uint32_t)std::min<uint64_t>(load, UINT32_MAX), std::memory_order_relaxed);
+    periods.store(n + 1, std::memory_order_release);
+}
+
+void AudioStats::recordXrun() {
+    xruns.fetch_add(1, std::memory_order_relaxed);
+}
+
+AudioStatsSnapshot AudioStats::read() const {
+    AudioStatsSnapshot s;
+    s.periods = periods.load(std::memory_order_acquire);
+    s.xruns = xruns.load(std::memory_order_relaxed);
+    s.lastLoad = 0.f;
+    s.maxLoad = 0.f;
+    s.p99Load = 0.f;
+    s.cpuLoad = -1.f;
+
+    if (s.periods == 0) return s;
+
+    // Copy out the window; slots being overwritten meanwhile are still recent
+    int n = std::min<uint64_t>(s.periods, window);
+    std::vector<uint32_t> v(n);
+    for (int i = 0; i < n; i++) v[i] = loads[i].load(std::memory_order_relaxed);
+
+    s.lastLoad = float(loads[(s.periods - 1) % window].load(std::memory_order_relaxed)) / loadScale;
+    s.maxLoad = float(*std::max_element(v.begin(), v.end())) / loadScale;
+
+    int k = std::min(n - 1, (int)(0.99 * n));
+    std::nth_element(v.begin(), v.begin() + k, v.end());
+    s.p99Load = float(v[k]) / loadScale;
+
+    return s;
+}
+
+void AudioStats::reset() {
+    for (int i = 0; i < window; i++) loads[i].store(0, std::memory_order_relaxed);
+    periods = 0;
+    xruns = 0;
+}
+
+void AudioStats::dump(std::ostream& os, const AudioStatsSnapshot& s) {
+    os << "periods=" << s.periods
+       << " xruns=" << s.xruns
+       << " callback last=" << int(s.lastLoad * 100.f) << "%"
+       << " p99=" << int(s.p99Load * 100.f) << "%"
+       << " max=" << int(s.maxLoad * 100.f) << "%";
+    if (s.cpuLoad >= 0.f) os << " dsp=" << int(s.cpuLoad) << "%";
+    os << std::endl;
+}
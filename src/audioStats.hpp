@@ -0,0 +1,82 @@
+// File: audioStats.hpp
+#ifndef DRUMPI_AUDIO_STATS_H
+#define DRUMPI_AUDIO_STATS_H
+
+#include <array>
+#include <atomic>
+#include <ostream>
+#include <cstdint>
+
+#include "defs.hpp"
+
+namespace drumpi {
+namespace audio {
+
+/*! Audio thread health at a moment in time, as read by \ref AudioStats. */
+struct AudioStatsSnapshot {
+    /*! Number of periods processed. */
+    uint64_t periods;
+    /*! Number of xruns reported. */
+    uint64_t xruns;
+    /*! Duration of the last callback as a fraction of the period. */
+    float lastLoad;
+    /*! Longest callback in the recent window as a fraction of the period. */
+    float maxLoad;
+    /*! 99th percentile callback in the recent window as a fraction of the
+    period. */
+    float p99Load;
+    /*! Audio server's own DSP load as a percentage, or -1 if unknown. */
+    float cpuLoad;
+};
+
+/*! Callback timing and xrun counts of an audio backend.
+Written by the backend's threads without locking or allocating, and read as
+an \ref AudioStatsSnapshot from any other thread. The max and p99 cover a
+rolling window of recent periods. */
+class AudioStats {
+    public:
+        /*! Constructor. */
+        AudioStats();
+
+        /*! Records one callback. Audio thread only.
+        \param durationNs time spent in the callback in nanoseconds.
+        \param budgetNs length of the period in nanoseconds. */
+        void recordPeriod(uint64_t durationNs, uint64_t budgetNs);
+
+        /*! Records an xrun. Safe from any thread. */
+        void recordXrun();
+
+        /*! Reads the current statistics.
+        Allocates, so never call from the audio thread.
+        \return the statistics; \ref AudioStatsSnapshot::cpuLoad is -1. */
+        AudioStatsSnapshot read() const;
+
+        /*! Removes all recorded statistics.
+        Not atomic with respect to concurrent recording. */
+        void reset();
+
+        /*! Writes a summary of a snapshot.
+        \param os stream to write to.
+        \param s the snapshot. */
+        static void dump(std::ostream& os, const AudioStatsSnapshot& s);
+
+        /*! Number of periods in the rolling window. */
+        static const int window = 1024;
+
+    private:
+        /*! Load of each recent callback in 1/10000ths of the period,
+        indexed by period number modulo \ref window. */
+        std::array<std::atomic<uint32_t>, window> loads;
+        /*! Number of periods recorded. */
+        std::atomic<uint64_t> periods;
+        /*! Number of xruns recorded. */
+        std::atomic<uint64_t> xruns;
+
+        /*! Fixed-point scale of \ref loads. */
+        static const uint32_t loadScale = 10000;
+};
+
+} // namespace audio
+} // namespace drumpi
+
+#endif // define DRUMPI_AUDIO_STATS_H
@@ -0,0 +1,117 @@
+// File: bankCache.cpp
+#include "bankCache.hpp"
+
+#include <algorithm>
+
+using namespace drumpi;
+using namespace audio;
+
+BankCache::BankCache(int maxBanks, size_t budget) {
+    this->maxBanks = std::max(maxBanks, 1);
+    this->budget = budget;
+    bytes = 0;
+}
+
+std::shared_ptr<const DrumBank> BankCache::find(int id, sampleSourceType_t type) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for (std::list<Entry>::iterator it = entries.begin(); it != entries.end(); ++it) {
+        if (it->id == id && it->type == type) {
+            // Move to the front
+            entries.splice(entries.begin(), entries, it);
+            return entries.front().bank;
+        }
+    }
+
+    return nullptr;
+}
+
+bool BankCache::contains(int id, sampleSourceType_t type) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for (std::list<Entry>::iterator it = entries.begin(); it != entries.end(); ++it) {
+        if (it->id == id && it->type == type) return true;
+    }
+
+    return false;
+}
+
+void BankCache::insert(std::shared_ptr<const DrumBank> bank, sampleSourceType_t type) {
+    if (!bank) return;
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // Replace any existing copy
+    for (std::list<Entry>::iterator it = entries.begin(); it != entries.end(); ++it) {
+        if (it->id == bank->id && it->type == type) {
+            bytes -= it->bytes;
+            entries.erase(it);
+            break;
+        }
+    }
+
+    Entry e;
+    e.id = bank->id;
+    e.type = type;
+    e.bank = bank;
+    e.bytes = bankBytes(*bank);
+
+    entries.push_front(e);
+    bytes += e.bytes;
+
+    evict();
+}
+
+void BankCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.clear();
+    bytes = 0;
+}
+
+void BankCache::setMaxBanks(int maxBanks) {
+    std::lock_guard<std::mutex> lock(mutex);
+    this->maxBanks = std::max(maxBanks, 1);
+    evict();
+}
+
+int BankCache::getMaxBanks() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return maxBanks;
+}
+
+void BankCache::setBudget(size_t budget) {
+    std::lock_guard<std::mutex> lock(mutex);
+    this->budget = budget;
+    evict();
+}
+
+size_t BankCache::getBudget() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return budget;
+}
+
+int BankCache::size() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries.size();
+}
+
+size_t BankCache::getBytes() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return bytes;
+}
+
+size_t BankCache::bankBytes(const DrumBank& bank) {
+    size_t n = 0;
+    for (int i = 0; i < NUM_DRUMS; i++) {
+        if (bank.data[i]) n += bank.data[i]->getBytes();
+    }
+    return n;
+}
+
+void BankCache::evict() {
+    // Always keep the most recently used bank
+    while (entries.size() > 1 && ((int)entries.size() > maxBanks || bytes > budget)) {
+        bytes -= entries.back().bytes;
+        entries.pop_back();
+    }
+}
@@ -0,0 +1,134 @@
+// File: bankCache.hpp
+#ifndef DRUMPI_BANK_CACHE_H
+#define DRUMPI_BANK_CACHE_H
+
+#include <list>
+#include <array>
+#include <memory>
+#include <mutex>
+#include <cstdint>
+#include <cstddef>
+
+#include "defs.hpp"
+#include "sampleSource.hpp"
+
+namespace drumpi {
+namespace audio {
+
+/*! A complete set of drum sources.
+Built away from the audio thread and published whole, so the audio thread
+never sees a half-loaded bank. */
+struct DrumBank {
+    /*! ID of the bank in the \ref AudioLibrary. */
+    int id;
+    /*! Source of each drum. Shared with cached copies of the bank and banks
+    built from this one by \ref PlaybackEngine::setSource. */
+    std::array<std::shared_ptr<SampleSource>, NUM_DRUMS> sources;
+    /*! Sample data of each drum, as played by the audio thread. */
+    std::array<std::shared_ptr<const SampleData>, NUM_DRUMS> data;
+};
+
+
+/*! Cache of recently used banks.
+Keeps up to a number of banks, within a memory budget, evicting the least
+recently used first. The most recently used bank is never evicted, even if it
+alone exceeds the budget. Safe to use from several control threads; never
+used by the audio thread. */
+class BankCache {
+    public:
+        /*! Constructor.
+        \param maxBanks maximum number of banks to keep.
+        \param budget maximum total size of the banks' samples in bytes. */
+        BankCache(int maxBanks = BankCache::defMaxBanks, size_t budget = BankCache::defBudget);
+
+        /*! Looks up a bank, marking it most recently used.
+        \param id ID of the bank.
+        \param type \ref sampleSourceType_t of the bank's sources.
+        \return the bank, or `nullptr` if not cached. */
+        std::shared_ptr<const DrumBank> find(int id, sampleSourceType_t type);
+
+        /*! Checks if a bank is cached, without marking it used.
+        \param id ID of the bank.
+        \param type \ref sampleSourceType_t of the bank's sources.
+        \return `true` if cached. */
+        bool contains(int id, sampleSourceType_t type);
+
+        /*! Adds a bank as the most recently used, evicting others as needed.
+        Replaces any cached bank with the same ID and type.
+        \param bank the bank.
+        \param type \ref sampleSourceType_t of the bank's sources. */
+        void insert(std::shared_ptr<const DrumBank> bank, sampleSourceType_t type);
+
+        /*! Removes all banks. */
+        void clear();
+
+        /*! Sets the maximum number of banks to keep.
+        \param maxBanks number of banks, at least 1. */
+        void setMaxBanks(int maxBanks);
+
+        /*! Returns the maximum number of banks to keep.
+        \return number of banks. */
+        int getMaxBanks();
+
+        /*! Sets the memory budget.
+        \param budget maximum total size of the banks' samples in bytes. */
+        void setBudget(size_t budget);
+
+        /*! Returns the memory budget.
+        \return budget in bytes. */
+        size_t getBudget();
+
+        /*! Returns the number of banks cached.
+        \return number of banks. */
+        int size();
+
+        /*! Returns the total size of the cached banks' samples.
+        \return size in bytes. */
+        size_t getBytes();
+
+        /*! Returns the size of a bank's samples.
+        Samples shared between drums are counted once per drum.
+        \param bank the bank.
+        \return size in bytes. */
+        static size_t bankBytes(const DrumBank& bank);
+
+    private:
+        /*! A cached bank. */
+        struct Entry {
+            /*! ID of the bank. */
+            int id;
+            /*! Source type of the bank. */
+            sampleSourceType_t type;
+            /*! The bank. */
+            std::shared_ptr<const DrumBank> bank;
+            /*! Size of the bank's samples in bytes. */
+            size_t bytes;
+        };
+
+        /*! Evicts least recently used banks until within limits.
+        Call with \ref mutex held. */
+        void evict();
+
+        /*! Cached banks, most recently used first. */
+        std::list<Entry> entries;
+        /*! Total size of the cached banks' samples in bytes. */
+        size_t bytes;
+
+        /*! Maximum number of banks. */
+        int maxBanks;
+        /*! Memory budget in bytes. */
+        size_t budget;
+
+        /*! Guards all members. */
+        std::mutex mutex;
+
+        /*! Default maximum number of banks. */
+        static const int defMaxBanks = 8;
+        /*! Default memory budget, 64 MiB. */
+        static const size_t defBudget = 64 * 1024 * 1024;
+};
+
+} // namespace audio
+} // namespace drumpi
+
+#endif // define DRUMPI_BANK_CACHE_H
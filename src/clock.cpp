@@ -2,6 +2,8 @@
 
 #include "clock.hpp"
 
+#include <cmath>
+
 using namespace drumpi;
 using namespace clock;
 
@@ -23,12 +25,12 @@ int Timer::getTime() {
 }
 
 void Timer::start() {
-    CppTimer::start(long(time * 1000000), ONESHOT);
+    ThreadTimer::start(long(time) * 1000000, TIMER_ONESHOT);
     active = true;
 }
 
 void Timer::stop() {
-    CppTimer::stop();
+    ThreadTimer::stop();
     active = false;
 }
 
@@ -62,13 +64,14 @@ int Clock::getRate() {
 }
 
 void Clock::start() {
-    CppTimer::start(long(rate*1000000));
-    timerEvent();
+    rateChangeFlag = false;
+    ThreadTimer::start(long(rate) * 1000000);
     active = true;
+    fire();
 }
 
 void Clock::stop() {
-    CppTimer::stop();
+    ThreadTimer::stop();
     active = false;
 }
 
@@ -78,25 +81,93 @@ bool Clock::isActive() {
 
 void Clock::timerEvent() {
     if (rateChangeFlag) {
+        // Restart the period from this tick, without an extra one
         rateChangeFlag = false;
-        stop();
-        start();
-        return;
+        ThreadTimer::start(long(rate) * 1000000);
     }
     tick();
 }
 
 
+TempoGrid::TempoGrid() {
+    origin = 0;
+    beats = 0;
+    period = 1e9;
+}
+
+void TempoGrid::reset(int64_t origin) {
+    this->origin = origin;
+    beats = 0;
+}
+
+void TempoGrid::setPeriod(double ns) {
+    origin = getDeadline();
+    beats = 0;
+    period = ns;
+}
+
+double TempoGrid::getPeriod() {
+    return period;
+}
+
+int64_t TempoGrid::advance() {
+    beats++;
+    return getDeadline();
+}
+
+int64_t TempoGrid::getDeadline() {
+    return origin + std::llround(beats * period);
+}
+
+
 Metronome::Metronome() {
     setRateBPM(120);
     rateChangeFlag = false;
 }
 
-void Metronome::setRateBPM(int bpm) {
+void Metronome::setRateBPM(double bpm) {
+    // Not taken up by a beat half way through
+    std::lock_guard<std::recursive_mutex> lock(eventMutex());
+
+    // Kept in whole ms for getRate() only
+    setRate(int(60000 / bpm));
+    rateChangeFlag = false;
     this->bpm = bpm;
-    setRate(bpmToMs(this->bpm));
 }
 
-int Metronome::getRateBPM() {
+double Metronome::getRateBPM() {
     return bpm;
 }
+
+void Metronome::start() {
+    // The timer thread reads and advances the grid if already running
+    std::lock_guard<std::recursive_mutex> lock(eventMutex());
+    syncRate();
+    grid.reset(now());
+    grid.setPeriod(bpmToNs(bpm));
+    active = true;
+    fire();
+}
+
+void Metronome::timerEvent() {
+    // A new tempo takes effect from this beat
+    syncRate();
+    double period = bpmToNs(bpm);
+    if (period != grid.getPeriod()) grid.setPeriod(period);
+
+    tick();
+
+    int64_t next = grid.advance();
+    while (next + (int64_t)period <= now()) next = grid.advance();
+
+    // The tick may have stopped the metronome
+    if (active) startAt(next);
+}
+
+void Metronome::syncRate() {
+    // A rate set in ms with setRate() replaces the BPM
+    if (rateChangeFlag) {
+        rateChangeFlag = false;
+        bpm = 60000. / getRate();
+    }
+}
@@ -3,10 +3,12 @@
 #ifndef DRUMPI_CLOCK_H
 #define DRUMPI_CLOCK_H
 
-#include "CppTimer.h"
+#include <atomic>
+#include <cstdint>
+
+#include "timerThread.hpp"
 
 namespace drumpi {
-/*! The namespace for timing related items. */
 namespace clock {
 
 /*! Converts BPM to ms.
@@ -16,11 +18,59 @@ inline int bpmToMs(int bpm) {
     return 60000 / bpm;
 }
 
+/*! Converts BPM to ns, without rounding.
+\param bpm BPM value to convert to ns.
+\return period of BPM in ns. */
+inline double bpmToNs(double bpm) {
+    return 60e9 / bpm;
+}
+
+
+/*! Absolute beat times for a fractional tempo.
+Each deadline is worked out from the time of the last tempo change and the
+number of beats since, rather than by adding the period to the previous
+deadline, so rounding to whole ns never builds up into drift. */
+class TempoGrid {
+    public:
+        /*! Constructor.
+        Starts at time 0 with a period of 1 second. */
+        TempoGrid();
+
+        /*! Restarts the grid.
+        \param origin time of the current beat in ns. */
+        void reset(int64_t origin);
+
+        /*! Sets the period from the current beat on.
+        The current beat keeps its time, so the phase carries over.
+        \param ns period in ns. */
+        void setPeriod(double ns);
+
+        /*! Returns the period.
+        \return period in ns. */
+        double getPeriod();
+
+        /*! Moves to the next beat.
+        \return time of the new current beat in ns. */
+        int64_t advance();
+
+        /*! Returns the time of the current beat.
+        \return time in ns. */
+        int64_t getDeadline();
+
+    private:
+        /*! Time of the beat the current period started on, in ns. */
+        int64_t origin;
+        /*! Beats since \ref origin. */
+        int64_t beats;
+        /*! Period in ns. */
+        double period;
+};
+
 
 /*! Trigger a single delayed action.
 To use, create a class that inherits from this and override the \ref trigger
-method to set the functionality. */
-class Timer : public CppTimer {
+method to set the functionality. \ref trigger runs on the \ref TimerThread. */
+class Timer : public ThreadTimer {
     public:
         /*! Constructor. */
         Timer();
@@ -65,8 +115,9 @@ class Timer : public CppTimer {
 
 /*! Trigger repeated actions.
 To use, create a class that inherits from this and override the \ref tick method
-to set the functionality. */
-class Clock : public CppTimer {
+to set the functionality. \ref tick runs on the \ref TimerThread, apart from
+the first one, which \ref start runs on the calling thread. */
+class Clock : public ThreadTimer {
     public:
         /*! Constructor. */
         Clock();
@@ -107,16 +158,19 @@ class Clock : public CppTimer {
         /*! Clock rate in ms. */
         int rate;
 
+    protected:
         /*! Active flag. */
         bool active;
 
-    protected:
         /*! Flag for the clocking rate being changed. */
         bool rateChangeFlag;
 };
 
 
-/*! Metronome class, similar to \ref Clock but can operate in BPM.
+/*! Metronome class, similar to \ref Clock but operates in fractional BPM.
+Beats are timed from absolute deadlines on a \ref TempoGrid, so the tempo is
+kept to the ns and does not drift however long it runs. A beat more than a
+whole period late is dropped rather than played in a burst.
 To use, create a class that inherits from this and override the \ref tick method
 to set the functionality. */
 class Metronome : public Clock {
@@ -125,19 +179,33 @@ class Metronome : public Clock {
         Metronome();
 
         /*! Sets the clock rate in BPM.
-        The change takes effect on the next \ref tick, or can be forced by
-        calling \ref stop and then \ref start.
+        Safe to call while running. The change takes effect from the next
+        \ref tick, keeping the phase of the beat.
         \param bpm desired clocking rate in BPM. */
-        void setRateBPM(int bpm);
+        void setRateBPM(double bpm);
 
         /*! Returns the clock rate in BPM.
         \return clock rate in BPM. */
-        int getRateBPM();
-    
+        double getRateBPM();
+
+        /*! Start the metronome.
+        The first \ref tick runs at once, on the calling thread. */
+        void start();
+
     private:
+        /*! Override event method to call tick() and time the next beat. */
+        void timerEvent() override;
+
+        /*! Takes up a rate set in ms with \ref setRate since the last
+        beat. */
+        void syncRate();
+
         /*! Clock rate in BPM.
         Stored to avoid quantisation issues from ms-to-BPM conversion. */
-        int bpm;
+        std::atomic<double> bpm;
+
+        /*! Beat times. Only used under \ref eventMutex. */
+        TempoGrid grid;
 };
 
 } // namespace clock
@@ -0,0 +1,100 @@
+// File: commandQueue.hpp
+#ifndef DRUMPI_COMMAND_QUEUE_H
+#define DRUMPI_COMMAND_QUEUE_H
+
+#include <atomic>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace drumpi {
+
+/*! Bounded lock-free multi-producer, single-consumer queue.
+Used to pass commands from the control threads (keyboard, clocks) to the
+real-time audio thread. Pushing and popping never allocate or block, so both
+are safe to call from the audio thread and from signal handlers.
+\tparam T type of the queued items. Must be trivially copyable.
+\tparam N capacity of the queue. Must be a power of two. */
+template <typename T, int N>
+class CommandQueue {
+    static_assert(N > 0 && (N & (N - 1)) == 0, "CommandQueue capacity must be a power of two");
+
+    public:
+        /*! Constructor. */
+        CommandQueue() {
+            for (int i = 0; i < N; i++) {
+                cells[i].sequence.store(i, std::memory_order_relaxed);
+            }
+            enqueuePos.store(0, std::memory_order_relaxed);
+            dequeuePos = 0;
+        }
+
+        /*! Adds an item to the queue.
+        May be called from any thread.
+        \param item item to add.
+        \return `false` if the queue is full and the item was dropped. */
+        bool push(const T& item) {
+            Cell* cell;
+            size_t pos = enqueuePos.load(std::memory_order_relaxed);
+
+            for (;;) {
+                cell = &cells[pos & (N - 1)];
+                size_t seq = cell->sequence.load(std::memory_order_acquire);
+                intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+
+                if (diff == 0) {
+                    // Slot is free, try to claim it
+                    if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+                } else if (diff < 0) {
+                    // Queue is full
+                    return false;
+                } else {
+                    // Another producer claimed the slot, reload
+                    pos = enqueuePos.load(std::memory_order_relaxed);
+                }
+            }
+
+            cell->item = item;
+            cell->sequence.store(pos + 1, std::memory_order_release);
+            return true;
+        }
+
+        /*! Removes the oldest item from the queue.
+        Must only be called from the single consumer thread.
+        \param item destination for the removed item.
+        \return `false` if the queue is empty. */
+        bool pop(T& item) {
+            Cell* cell = &cells[dequeuePos & (N - 1)];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+
+            if ((intptr_t)seq - (intptr_t)(dequeuePos + 1) < 0) return false;
+
+            item = cell->item;
+            cell->sequence.store(dequeuePos + N, std::memory_order_release);
+            dequeuePos++;
+            return true;
+        }
+
+    private:
+        /*! Queue slot. */
+        struct Cell {
+            /*! Slot sequence number, used to hand the slot between producers
+            and the consumer. */
+            std::atomic<size_t> sequence;
+            /*! Queued item. */
+            T item;
+        };
+
+        /*! Ring of queue slots. */
+        std::array<Cell, N> cells;
+
+        /*! Position of the next item to be pushed. Shared by producers. */
+        alignas(64) std::atomic<size_t> enqueuePos;
+
+        /*! Position of the next item to be popped. Consumer only. */
+        alignas(64) size_t dequeuePos;
+};
+
+} // namespace drumpi
+
+#endif // define DRUMPI_COMMAND_QUEUE_H
@@ -32,6 +32,9 @@ typedef enum _DrumIDs {
 /*! The number of drums available in the DrumPi. */
 #define NUM_DRUMS (int)_DrumIDs::_NUM_DRUMS
 
+/*! Velocity of a full-strength hit. */
+#define MAX_VELOCITY 127
+
 /*! ID labels for the DrumPi's operational modes. */
 typedef enum _StateLabels {
     PERFORMANCE_MODE,
@@ -42,6 +45,20 @@ typedef enum _StateLabels {
     SET_DRUM_BANK_MODE
 } stateLabel_t;
 
+/*! The namespace for timing related items. */
+namespace clock {
+
+/*! Firing modes of a \ref ThreadTimer. */
+typedef enum _TimerTypes {
+    /*! Fires repeatedly at its interval. */
+    TIMER_PERIODIC,
+
+    /*! Fires once. */
+    TIMER_ONESHOT
+} timerType_t;
+
+} // namespace clock
+
 /*! The namespace for audio system related items. */
 namespace audio {
 
@@ -80,6 +97,63 @@ typedef enum _SampleSourceStatus {
     SOURCE_ERROR
 } sampleSourceStatus_t;
 
+/*! Formats sample data can be stored in. */
+typedef enum _SampleFormats {
+    /*! 32-bit float. */
+    SAMPLE_FLOAT32,
+
+    /*! 16-bit signed integer, converted to float as it is mixed. Half the
+    memory of \ref SAMPLE_FLOAT32 and lossless for 16-bit sources. */
+    SAMPLE_INT16
+} sampleFormat_t;
+
+/*! Identifies a type of audio output backend. */
+typedef enum _AudioBackendTypes {
+    /*! Output through a Jack server. */
+    BACKEND_JACK,
+
+    /*! No output, clocked by a timer thread. For testing without audio
+    hardware. */
+    BACKEND_NULL
+} audioBackendType_t;
+
+/*! Identifies a command sent to the audio thread. */
+typedef enum _PlaybackCommandTypes {
+    /*! Start playback of a drum. */
+    CMD_TRIGGER,
+
+    /*! Stop playback of a drum. */
+    CMD_UNTRIGGER,
+
+    /*! Set the volume of a drum. */
+    CMD_DRUM_VOLUME,
+
+    /*! Set the master volume. */
+    CMD_MASTER_VOLUME,
+
+    /*! Set the voice stealing policy. */
+    CMD_STEAL_POLICY,
+
+    /*! Set the pan position of a drum. */
+    CMD_DRUM_PAN,
+
+    /*! Turn the per-drum direct outputs on or off. */
+    CMD_DIRECT_OUTS
+} playbackCommandType_t;
+
+/*! Policies for choosing a voice to reuse when none are free. */
+typedef enum _VoiceStealPolicies {
+    /*! Reuse the voice that was started longest ago. */
+    STEAL_OLDEST,
+
+    /*! Reuse the voice with the lowest estimated level. */
+    STEAL_QUIETEST,
+
+    /*! Retriggering a drum chokes its own voice, like a single playhead.
+    Falls back to \ref STEAL_OLDEST if the drum is not playing. */
+    STEAL_SAME_DRUM
+} voiceStealPolicy_t;
+
 /*! Error codes for the audio engine system. */
 typedef enum _AudioError {
     /*! No error. */
@@ -0,0 +1,315 @@
+// File: diskStream.cpp
+#include "diskStream.hpp"
+
+#include <algorithm>
+#include <cerrno>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+#include "sampleCache.hpp"
+#include "mixer.hpp"
+#include "threads.hpp"
+
+using namespace drumpi;
+using namespace audio;
+
+// DiskStream class
+
+DiskStream::DiskStream() {
+    fd = -1;
+    dataOffset = 0;
+    format = SAMPLE_FLOAT32;
+    numFrames = 0;
+    numChannels = 1;
+    sampleRate = 0;
+}
+
+DiskStream::~DiskStream() {
+    if (fd >= 0) close(fd);
+}
+
+bool DiskStream::open(std::string cachePath) {
+    _SampleCacheHeader header;
+
+    if (fd >= 0) close(fd);
+    fd = ::open(cachePath.data(), O_RDONLY);
+    if (fd < 0) return false;
+
+    if (!SampleCache::readHeader(fd, header)) {
+        close(fd);
+        fd = -1;
+        return false;
+    }
+
+    dataOffset = header.dataOffset;
+    format = (sampleFormat_t)header.format;
+    numFrames = (int)header.numFrames;
+    numChannels = (int)header.numChannels;
+    sampleRate = (int)header.sampleRate;
+
+    // Channels are read front to back
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    return true;
+}
+
+int DiskStream::read(int c, int64_t frame, sample_t* out, int n) const {
+    if (fd < 0 || frame >= numFrames) return 0;
+    n = (int)std::min<int64_t>(n, numFrames - frame);
+
+    if (format == SAMPLE_FLOAT32) {
+        ssize_t r = pread(fd, out, (size_t)n * sizeof(sample_t), offset(c, frame));
+        return (r < 0) ? 0 : (int)(r / sizeof(sample_t));
+    }
+
+    int16_t scratch[convertFrames];
+    int done = 0;
+    while (done < n) {
+        int k = std::min(n - done, (int)convertFrames);
+        ssize_t r = pread(fd, scratch, (size_t)k * sizeof(int16_t), offset(c, frame + done));
+        if (r <= 0) break;
+
+        k = (int)(r / sizeof(int16_t));
+        for (int i = 0; i < k; i++) out[done + i] = scratch[i] * int16Scale;
+        done += k;
+    }
+    return done;
+}
+
+void DiskStream::willNeed(int64_t frame, int n) const {
+    if (fd < 0 || frame >= numFrames) return;
+    n = (int)std::min<int64_t>(n, numFrames - frame);
+
+    size_t sampleSize = (format == SAMPLE_INT16) ? sizeof(int16_t) : sizeof(sample_t);
+    for (int c = 0; c < numChannels; c++) {
+        posix_fadvise(fd, offset(c, frame), (off_t)n * sampleSize, POSIX_FADV_WILLNEED);
+    }
+}
+
+int DiskStream::getNumFrames() const {
+    return numFrames;
+}
+
+int DiskStream::getNumChannels() const {
+    return numChannels;
+}
+
+int DiskStream::getSampleRate() const {
+    return sampleRate;
+}
+
+sampleFormat_t DiskStream::getFormat() const {
+    return format;
+}
+
+off_t DiskStream::offset(int c, int64_t frame) const {
+    size_t sampleSize = (format == SAMPLE_INT16) ? sizeof(int16_t) : sizeof(sample_t);
+    return dataOffset + (off_t)(((int64_t)c * numFrames + frame) * sampleSize);
+}
+
+
+// DiskStreamer class
+
+DiskStreamer::DiskStreamer(int numSlots, int ringSamples) :
+    slots(new Slot[std::max(numSlots, 1)])
+{
+    this->numSlots = std::max(numSlots, 1);
+    this->ringSamples = std::max(ringSamples, (int)maxChannels);
+    underruns = 0;
+    allocated = false;
+    running = false;
+    wakePending = false;
+    wakeFd = eventfd(0, EFD_CLOEXEC);
+
+    for (int i = 0; i < this->numSlots; i++) {
+        slots[i].state = SLOT_FREE;
+        slots[i].startFrame = 0;
+        slots[i].capacity = 0;
+        slots[i].readPos = 0;
+        slots[i].writePos = 0;
+    }
+}
+
+DiskStreamer::~DiskStreamer() {
+    stop();
+    if (wakeFd >= 0) close(wakeFd);
+}
+
+void DiskStreamer::start() {
+    std::lock_guard<std::mutex> lock(threadMutex);
+    if (running || wakeFd < 0) return;
+
+    allocate();
+    running = true;
+    thread = std::thread(&DiskStreamer::ioLoop, this);
+}
+
+void DiskStreamer::stop() {
+    std::lock_guard<std::mutex> lock(threadMutex);
+    if (!running) return;
+
+    running = false;
+    uint64_t one = 1;
+    ssize_t r = write(wakeFd, &one, sizeof(one));
+    (void)r;
+    thread.join();
+}
+
+bool DiskStreamer::isRunning() {
+    return running;
+}
+
+void DiskStreamer::allocate() {
+    if (allocated) return;
+    for (int i = 0; i < numSlots; i++) slots[i].ring.resize(ringSamples);
+    allocated.store(true, std::memory_order_release);
+}
+
+int DiskStreamer::claim(const std::shared_ptr<const DiskStream>& stream, int startFrame) {
+    if (!stream || stream->getNumChannels() > maxChannels) return -1;
+    if (!allocated.load(std::memory_order_acquire)) return -1;
+
+    for (int i = 0; i < numSlots; i++) {
+        Slot& s = slots[i];
+        int expected = SLOT_FREE;
+        if (!s.state.compare_exchange_strong(expected, SLOT_CLAIMED, std::memory_order_acquire)) continue;
+
+        // A free slot holds no stream, so this never frees one
+        s.stream = stream;
+        s.startFrame = startFrame;
+        s.capacity = ringSamples / stream->getNumChannels();
+        s.readPos.store(0, std::memory_order_relaxed);
+        s.writePos.store(0, std::memory_order_relaxed);
+        s.state.store(SLOT_ACTIVE, std::memory_order_release);
+        wake();
+        return i;
+    }
+
+    return -1;
+}
+
+int DiskStreamer::peek(int slot, const sample_t** channels, int n) {
+    Slot& s = slots[slot];
+    int64_t r = s.readPos.load(std::memory_order_relaxed);
+    int64_t w = s.writePos.load(std::memory_order_acquire);
+    if (w <= r) return 0;
+
+    int pos = (int)(r % s.capacity);
+    int k = (int)std::min<int64_t>(std::min(n, s.capacity - pos), w - r);
+
+    int numChannels = s.stream->getNumChannels();
+    for (int c = 0; c < numChannels; c++) channels[c] = s.ring.data() + (size_t)c * s.capacity + pos;
+
+    return k;
+}
+
+void DiskStreamer::advance(int slot, int n) {
+    Slot& s = slots[slot];
+    // Release, so the I/O thread does not overwrite frames still being read
+    int64_t r = s.readPos.load(std::memory_order_relaxed) + n;
+    s.readPos.store(r, std::memory_order_release);
+
+    // Wake the I/O thread once there is room for a read worth making, unless
+    // the whole stream is already in
+    int64_t w = s.writePos.load(std::memory_order_acquire);
+    int64_t length = s.stream->getNumFrames() - (int64_t)s.startFrame;
+    if (w < length && s.capacity - (w - r) >= std::min(minRead, s.capacity / 2)) wake();
+}
+
+void DiskStreamer::release(int slot) {
+    slots[slot].state.store(SLOT_RELEASED, std::memory_order_release);
+    wake();
+}
+
+void DiskStreamer::countUnderrun() {
+    underruns.fetch_add(1, std::memory_order_relaxed);
+}
+
+void DiskStreamer::service() {
+    for (int i = 0; i < numSlots; i++) {
+        Slot& s = slots[i];
+        int state = s.state.load(std::memory_order_acquire);
+
+        if (state == SLOT_RELEASED) {
+            // Dropping the stream may close its file, so it happens here
+            s.stream.reset();
+            s.state.store(SLOT_FREE, std::memory_order_release);
+        } else if (state == SLOT_ACTIVE) {
+            fill(s);
+        }
+    }
+}
+
+uint64_t DiskStreamer::getUnderruns() {
+    return underruns.load();
+}
+
+int DiskStreamer::numActive() {
+    int n = 0;
+    for (int i = 0; i < numSlots; i++) {
+        n += (int)(slots[i].state.load() != SLOT_FREE);
+    }
+    return n;
+}
+
+void DiskStreamer::fill(Slot& s) {
+    const DiskStream& stream = *s.stream;
+    int numChannels = stream.getNumChannels();
+    int64_t length = stream.getNumFrames() - (int64_t)s.startFrame;
+
+    int64_t r = s.readPos.load(std::memory_order_acquire);
+    int64_t w = s.writePos.load(std::memory_order_relaxed);
+
+    // Frames skipped by the audio thread after an underrun are not read
+    if (w < r) {
+        w = r;
+        s.writePos.store(w, std::memory_order_release);
+    }
+
+    int64_t n = std::min<int64_t>(s.capacity - (w - r), length - w);
+    if (n <= 0 || (n < std::min(minRead, s.capacity / 2) && w + n < length)) return;
+
+    while (n > 0) {
+        int pos = (int)(w % s.capacity);
+        int k = (int)std::min<int64_t>(n, s.capacity - pos);
+
+        int got = k;
+        for (int c = 0; c < numChannels; c++) {
+            got = std::min(got, stream.read(c, s.startFrame + w, s.ring.data() + (size_t)c * s.capacity + pos, k));
+        }
+        if (got <= 0) return;
+
+        w += got;
+        n -= got;
+        s.writePos.store(w, std::memory_order_release);
+        if (got < k) return;
+    }
+
+    // Have the next ring's worth on its way from the disk
+    stream.willNeed(s.startFrame + w, s.capacity);
+}
+
+void DiskStreamer::wake() {
+    // One write per pass of the I/O thread at most
+    if (wakePending.exchange(true, std::memory_order_acq_rel)) return;
+
+    uint64_t one = 1;
+    ssize_t r = write(wakeFd, &one, sizeof(one));
+    (void)r;
+}
+
+void DiskStreamer::ioLoop() {
+    blockSignals();
+
+    // Slots claimed or released while stopped are seen on the first pass
+    while (running) {
+        // Cleared before the pass, so anything signalled during it wakes the
+        // thread again
+        wakePending.store(false, std::memory_order_release);
+        service();
+
+        uint64_t count;
+        if (read(wakeFd, &count, sizeof(count)) < 0 && errno != EINTR) break;
+    }
+}
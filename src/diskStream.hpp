@@ -0,0 +1,256 @@
+// File: diskStream.hpp
+#ifndef DRUMPI_DISK_STREAM_H
+#define DRUMPI_DISK_STREAM_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <cstdint>
+
+#include "defs.hpp"
+
+namespace drumpi {
+namespace audio {
+
+/*! Read access to the samples of a cache file, without mapping it.
+Reads use `pread`, so one stream can be read by several voices at once. They
+may block on the disk, so are never made on the audio thread. */
+class DiskStream {
+    public:
+        /*! Constructor. */
+        DiskStream();
+
+        /*! Destructor.
+        Closes the file. */
+        ~DiskStream();
+
+        /*! Opens a cache file, as written by \ref SampleCache.
+        \param cachePath path of the cache file.
+        \return `true` on success. */
+        bool open(std::string cachePath);
+
+        /*! Reads part of a channel as floats.
+        \param c channel index.
+        \param frame frame to start from.
+        \param out buffer to write to.
+        \param n number of frames.
+        \return number of frames read, short at the end of the file or on
+        error. */
+        int read(int c, int64_t frame, sample_t* out, int n) const;
+
+        /*! Asks the kernel to read ahead part of every channel.
+        \param frame frame to start from.
+        \param n number of frames. */
+        void willNeed(int64_t frame, int n) const;
+
+        /*! Returns the number of frames in the file.
+        \return number of frames. */
+        int getNumFrames() const;
+
+        /*! Returns the number of channels.
+        \return number of channels. */
+        int getNumChannels() const;
+
+        /*! Returns the sample rate of the samples.
+        \return sample rate in Hz. */
+        int getSampleRate() const;
+
+        /*! Returns the storage format of the samples.
+        \return \ref sampleFormat_t of the samples. */
+        sampleFormat_t getFormat() const;
+
+    private:
+        /*! Returns the file offset of a sample.
+        \param c channel index.
+        \param frame frame index.
+        \return offset in bytes. */
+        off_t offset(int c, int64_t frame) const;
+
+        /*! File descriptor of the cache file, or -1. */
+        int fd;
+        /*! Byte offset of the sample data. */
+        off_t dataOffset;
+        /*! Storage format of the samples. */
+        sampleFormat_t format;
+        /*! Number of frames. */
+        int numFrames;
+        /*! Number of channels. */
+        int numChannels;
+        /*! Sample rate in Hz. */
+        int sampleRate;
+
+        /*! Frames converted at a time when reading 16-bit samples. */
+        static const int convertFrames = 1024;
+};
+
+
+/*! Refills ring buffers from \ref DiskStream objects for the audio thread.
+Holds a fixed set of slots, each with a preallocated ring buffer. A voice
+claims a slot when it starts a streamed sample and plays from the slot's
+ring once it is past the sample's resident head. A normal-priority I/O
+thread keeps the rings topped up and asks the kernel to read ahead. It
+sleeps until the audio thread signals that a slot was claimed, released or
+has room for a worthwhile read, so an idle streamer costs nothing.
+
+The rings are only allocated when the streamer is first started, and are
+kept until it is destroyed since voices may still be reading them.
+
+The audio thread side, \ref claim, \ref peek, \ref advance and
+\ref release, never blocks, allocates or frees: a voice whose ring runs dry
+plays silence for the missing frames, which are skipped, and the underrun is
+counted. Released slots are recycled, and their streams dropped, by the I/O
+thread. */
+class DiskStreamer {
+    public:
+        /*! Constructor.
+        Allocates neither the rings nor the I/O thread.
+        \param numSlots number of samples that can stream at once.
+        \param ringSamples size of each ring buffer in samples, shared
+        between the channels of the stream. */
+        DiskStreamer(int numSlots = DiskStreamer::defNumSlots, int ringSamples = DiskStreamer::defRingSamples);
+
+        /*! Destructor.
+        Stops the I/O thread. */
+        ~DiskStreamer();
+
+        /*! Allocates the rings, if not done yet, and starts the I/O thread. */
+        void start();
+
+        /*! Stops the I/O thread.
+        Voices still streaming play silence once their rings run dry. */
+        void stop();
+
+        /*! Checks if the I/O thread is running.
+        \return `true` if running. */
+        bool isRunning();
+
+        /*! Allocates the rings, if not done yet. Control side.
+        Called by \ref start; call directly to drive the streamer with
+        \ref service instead of the I/O thread. */
+        void allocate();
+
+        /*! Claims a slot to stream a sample. Audio thread.
+        \param stream stream of the sample.
+        \param startFrame frame of the stream to start the ring from.
+        \return index of the slot, or -1 if none is free, the rings are not
+        allocated or the stream has more than \ref maxChannels channels. */
+        int claim(const std::shared_ptr<const DiskStream>& stream, int startFrame);
+
+        /*! Returns the next samples buffered in a slot. Audio thread.
+        \param slot index of the slot.
+        \param channels array of \ref maxChannels pointers, set to the
+        position of each channel in the ring.
+        \param n number of frames wanted.
+        \return number of contiguous frames available, at most n. */
+        int peek(int slot, const sample_t** channels, int n);
+
+        /*! Consumes frames from a slot. Audio thread.
+        Frames may be consumed beyond those buffered, after an underrun.
+        \param slot index of the slot.
+        \param n number of frames. */
+        void advance(int slot, int n);
+
+        /*! Gives up a slot. Audio thread.
+        \param slot index of the slot. */
+        void release(int slot);
+
+        /*! Counts an underrun. Audio thread. */
+        void countUnderrun();
+
+        /*! Makes one pass over the slots, refilling rings and recycling
+        released slots. Called by the I/O thread, or directly if it is not
+        running. */
+        void service();
+
+        /*! Returns the number of underruns so far.
+        \return number of periods in which a voice ran out of streamed
+        samples, or could not stream. */
+        uint64_t getUnderruns();
+
+        /*! Returns the number of slots in use.
+        \return number of slots. */
+        int numActive();
+
+        /*! Most channels a streamed sample can have. */
+        static const int maxChannels = 8;
+
+    private:
+        /*! State of a slot. */
+        enum SlotState {
+            /*! Free to claim; owned by the audio thread. */
+            SLOT_FREE,
+            /*! Being set up by the audio thread. */
+            SLOT_CLAIMED,
+            /*! Streaming. */
+            SLOT_ACTIVE,
+            /*! Given up, waiting for the I/O thread to recycle it. */
+            SLOT_RELEASED
+        };
+
+        /*! A stream and its ring buffer. */
+        struct Slot {
+            /*! \ref SlotState of the slot. */
+            std::atomic<int> state;
+            /*! Stream being read. */
+            std::shared_ptr<const DiskStream> stream;
+            /*! Frame of the stream at ring position 0. */
+            int startFrame;
+            /*! Frames in the ring for each channel. */
+            int capacity;
+            /*! Planar ring buffer, `capacity` frames per channel. */
+            std::vector<sample_t> ring;
+            /*! Frames consumed by the audio thread. */
+            std::atomic<int64_t> readPos;
+            /*! Frames written by the I/O thread. */
+            std::atomic<int64_t> writePos;
+        };
+
+        /*! Refills one slot's ring. I/O side.
+        \param s the slot. */
+        void fill(Slot& s);
+
+        /*! Wakes the I/O thread, unless a wake is already pending. Audio
+        thread. */
+        void wake();
+
+        /*! I/O thread loop. */
+        void ioLoop();
+
+        /*! The slots. */
+        std::unique_ptr<Slot[]> slots;
+        /*! Number of slots. */
+        int numSlots;
+        /*! Size of each ring in samples. */
+        int ringSamples;
+        /*! Whether the rings are allocated. */
+        std::atomic<bool> allocated;
+
+        /*! Underruns so far. */
+        std::atomic<uint64_t> underruns;
+
+        /*! I/O thread. */
+        std::thread thread;
+        /*! Whether the I/O thread should keep running. */
+        std::atomic<bool> running;
+        /*! Serialises \ref start and \ref stop. */
+        std::mutex threadMutex;
+        /*! Event file descriptor the I/O thread sleeps on. */
+        int wakeFd;
+        /*! Whether a wake has been signalled and not yet acted on. */
+        std::atomic<bool> wakePending;
+
+        /*! Default number of slots. */
+        static const int defNumSlots = 16;
+        /*! Default ring size, 128 KiB of floats per slot. */
+        static const int defRingSamples = 32768;
+        /*! Smallest read worth making before the end of a stream, in frames. */
+        const int minRead = 2048;
+};
+
+} // namespace audio
+} // namespace drumpi
+
+#endif // define DRUMPI_DISK_STREAM_H
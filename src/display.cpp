@@ -15,6 +15,8 @@
 
 #include "display.hpp"
 
+#include <algorithm>
+
 using namespace drumpi;
 
 // Max7219
@@ -178,7 +180,7 @@ void Display::setOneDigit(unsigned int value) {
 
 void Display::setActiveDrums(std::vector<bool> activeDrums, unsigned int page) {
     unsigned int seqIndex = 0;
-    for(unsigned int digit = 0; digit <= getNumDigits(); digit ++) {
+    for(unsigned int digit = 0; digit < getNumDigits(); digit ++) {
         seqIndex = (page*getNumDigits()) + digit;
         if(activeDrums[seqIndex])
             setDigit((getNumDigits()-1) - digit, upperSqAddr, false);
@@ -187,7 +189,7 @@ void Display::setActiveDrums(std::vector<bool> activeDrums, unsigned int page) {
 
 void Display::addLevel(float level) {
     float magLevel = fabs(level);
-    unsigned int maxDigit = magLevel * getNumDigits();
+    unsigned int maxDigit = std::min(magLevel * getNumDigits(), getNumDigits() - 1.f);
 
     for(unsigned int digit = 0; digit <= maxDigit; digit ++) {
         unsigned char currentDigit = getNumDigits() - digit - 1;
@@ -5,58 +5,139 @@
 #include <string>
 #include <iostream>
 #include <fstream>
+#include <cerrno>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <time.h>
 #include "keyboardinput.hpp"
-//#include <sys/time.h>
 
 using namespace drumpi;
 
 KeyboardInput::KeyboardInput() {
 	std::string kbdConf = std::string(DRUMPI_DIR).append("kbd-config.txt");
 	std::string kbdID;
-	std::string kbdPath;
+	std::vector<std::string> devices;
 	std::ifstream kbdConfigFile;
 		
+	// One keyboard per line, as written by scripts/detect_keyboards.bash
 	kbdConfigFile.open (kbdConf, std::ios::in);
-	kbdConfigFile >> kbdID;
-	
-	kbdPath = "/dev/input/by-id/" + kbdID;
-	const char* kbdFilePath = kbdPath.c_str();	//conversion necessary since open() expects a const char
-	//printf("USB Keyboard Path: %s\n", kbdFilePath);
-	
+	while (kbdConfigFile >> kbdID) {
+		devices.push_back("/dev/input/by-id/" + kbdID);
+	}
 	kbdConfigFile.close();
-	
-	fd = open(kbdFilePath, O_RDONLY);
+
+	open(devices);
+}
+
+KeyboardInput::KeyboardInput(std::vector<std::string> devices) {
+	open(devices);
+}
+
+KeyboardInput::~KeyboardInput() {
+	for (int i = 0; i < fds.size(); i++) close(fds[i]);
+	if (wakeFd >= 0) close(wakeFd);
+	if (epollFd >= 0) close(epollFd);
+}
+
+void KeyboardInput::open(std::vector<std::string> devices) {
+	struct epoll_event ee;
+
 	running = 0;
 	testFlag = 0;
-	fdset[0].fd = fd;
-	fdset[0].events = POLLIN;
+	callback = nullptr;
+
+	epollFd = epoll_create1(EPOLL_CLOEXEC);
+	wakeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+
+	ee.events = EPOLLIN;
+	ee.data.fd = wakeFd;
+	epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &ee);
+
+	for (int i = 0; i < devices.size(); i++) {
+		// Non-blocking so each device can be drained without stalling
+		int fd = ::open(devices[i].c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+		if (fd < 0) continue;
+
+		// Stamp events on the clock used for latency measurement
+		int clock = CLOCK_MONOTONIC;
+		monotonic.push_back(ioctl(fd, EVIOCSCLOCKID, &clock) == 0);
+
+		ee.events = EPOLLIN;
+		ee.data.fd = fd;
+		epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ee);
+		fds.push_back(fd);
+	}
 }
 
 void KeyboardInput::pollInput() {
+	struct epoll_event ready[8];
+
 	running = 1;
 	testFlag = 0;
-	//long secs_used, microsecs_used;
-	//struct timeval start, stop;
 	while (running) {
 		testFlag = 1; 	//flag is only set to 1 if while loop starts
 
-		//poll() checks if an input event has occured
-		if (poll(fdset, 1, 0) == 1) {
-			//gettimeofday(&start, NULL);
-			read(fd, &ev, sizeof ev);
-			if (ev.type == EV_KEY && ev.value == 1) {
-				if (ev.code == KEY_ESC) {
+		// Sleep until a keyboard has events or stop() is called
+		int n = epoll_wait(epollFd, ready, 8, -1);
+		if (n < 0) {
+			if (errno == EINTR) continue;
+			break;
+		}
+
+		for (int i = 0; i < n; i++) {
+			if (ready[i].data.fd == wakeFd) {
+				// stop() was called, possibly before this loop started
+				uint64_t count;
+				ssize_t r = read(wakeFd, &count, sizeof(count));
+				(void)r;
+				running = 0;
+				break;
+			}
+
+			if (!readEvents(ready[i].data.fd)) {
+				// Unplugged; stop watching it
+				epoll_ctl(epollFd, EPOLL_CTL_DEL, ready[i].data.fd, NULL);
+			}
+		}
+	}
+}
+
+bool KeyboardInput::readEvents(int fd) {
+	bool stamped = false;
+	for (int i = 0; i < fds.size(); i++) {
+		if (fds[i] == fd) stamped = monotonic[i];
+	}
+
+	while (true) {
+		// Read as many events as are waiting, up to a batch at a time
+		ssize_t r = read(fd, events, sizeof(events));
+		if (r < 0) return errno == EAGAIN || errno == EINTR;
+		if (r == 0) return false;
+
+		int n = r / sizeof(struct input_event);
+		for (int i = 0; i < n; i++) {
+			if (events[i].type == EV_KEY && events[i].value == 1) {
+				if (events[i].code == KEY_ESC) {
 					tcflush(STDIN_FILENO, TCIFLUSH);
-					callback->running = false;
+					callback->quit();
 				}
-				//printf("\n%d key pressed\n", ev.code);
-				callback->interpretKeyPress(ev.code);
-				//gettimeofday(&stop, NULL);
-				//secs_used = (stop.tv_sec - start.tv_sec);
-				//microsecs_used = ((secs_used*1000000000.0) + stop.tv_usec) - (start.tv_usec);	// in microseconds
-				//printf("%ld\n", microsecs_used);	//print time taken between event detection and return of callback
+				callback->inputTime = stamped ?
+					events[i].time.tv_sec * 1000000000ULL + events[i].time.tv_usec * 1000ULL : 0;
+				callback->interpretKeyPress(events[i].code);
 			}
 		}
+
+		if (n < eventBatch) return true;
+	}
+}
+
+void KeyboardInput::stop() {
+	uint64_t one = 1;
+
+	running = 0;
+	if (wakeFd >= 0) {
+		ssize_t r = write(wakeFd, &one, sizeof(one));
+		(void)r;
 	}
 }
 
@@ -65,7 +146,11 @@ void KeyboardInput::connectCallback(ApplicationCallback* app) {
 }
 
 int KeyboardInput::getFileDescriptor() {
-   	return fd;
+	return fds.empty() ? -1 : fds[0];
+}
+
+int KeyboardInput::getNumDevices() {
+	return fds.size();
 }
 
 int KeyboardInput::getTestFlag() {
@@ -6,38 +6,54 @@
 #define KEYBOARDINPUT_H
 
 #include <termios.h>
-#include <poll.h>
+#include <sys/epoll.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <linux/input.h>
 #include <stdio.h>
+#include <string>
+#include <vector>
+#include <atomic>
 
 #include "defs.hpp"
 #include "applicationcallback.hpp"
 
 namespace drumpi {
 
-/*! Class for monitoring a keyboard device file and detecting keyboard presses. */
+/*! Class for monitoring keyboard device files and detecting keyboard presses. */
 class KeyboardInput {
 
 public:
 
 	/*! \brief Constructor.
 	 *
-	 * The constructor detects and opens the
-	 * device file for the keyboard input device.
+	 * The constructor opens the device file of every keyboard
+	 * listed in `kbd-config.txt`, one device ID per line.
 	 */
     KeyboardInput();
 
+	/*! \brief Constructor.
+	 *
+	 * Opens the given device files.
+	 * \param devices paths of the input device files.
+	 */
+    KeyboardInput(std::vector<std::string> devices);
+
+    /*! Destructor. Closes the device files. */
+    ~KeyboardInput();
+
     /*!
-     * \brief Polls the keyboard input for events.
+     * \brief Waits for keyboard events.
      *
-     * This method monitors the keyboard device file
-     * with a polling loop and calls the \ref Application object
-     * to interpret the key press and perform an action
-     * when a key press is detected.
+     * This method sleeps in `epoll_wait` until a keyboard device
+     * file has events, reads them in batches and calls the
+     * \ref Application object to interpret each key press.
+     * It returns when \ref stop is called.
      */
     void pollInput();
+
+    /*! Makes \ref pollInput return. Safe to call from any thread. */
+    void stop();
     
     /*! 
      * \brief Sets the \ref Application object called when a keyboard event occurs.
@@ -47,28 +63,51 @@ public:
      * */
     void connectCallback(ApplicationCallback* app);
 
-    /*! \returns file descriptor \ref fd of the input device. */
+    /*! \returns file descriptor of the first input device, or -1 if none opened. */
     int getFileDescriptor();
 
+    /*! \returns number of input devices open. */
+    int getNumDevices();
+
     /*! \returns \ref testFlag. */
     int getTestFlag();
 
     /*! Running flag used to end the input polling loop. */
-    int running;
+    std::atomic<int> running;
 
     /*! Callback class called by KeyboardInput when a keyboard event occurs. */
     ApplicationCallback* callback;
 
 private:
 
-    /*! Event handler containing information about keyboard input events. */
-    struct input_event ev;
+    /*! Opens the device files and sets up the epoll set.
+     * \param devices paths of the input device files.
+     */
+    void open(std::vector<std::string> devices);
+
+    /*! Reads and interprets all waiting events from a device.
+     * \param fd file descriptor of the device.
+     * \returns `false` if the device has gone away.
+     */
+    bool readEvents(int fd);
+
+    /*! Maximum number of events read per system call. */
+    static const int eventBatch = 64;
+
+    /*! Buffer of keyboard input events read from a device. */
+    struct input_event events[eventBatch];
+
+    /*! File descriptors of the keyboard device files. */
+    std::vector<int> fds;
+
+    /*! Whether each device stamps its events with `CLOCK_MONOTONIC`. */
+    std::vector<bool> monotonic;
 
-    /*! Array of pollfd structs checked by poll() system call. */
-    struct pollfd fdset[1];
+    /*! Epoll instance watching the devices and \ref wakeFd. */
+    int epollFd;
 
-    /*! File descriptor for the keyboard device file. */
-    int fd;
+    /*! Eventfd written by \ref stop to wake \ref pollInput. */
+    int wakeFd;
 
     /*! Flag to check \ref pollInput has been called successfully. */
     int testFlag;
@@ -1,17 +1,20 @@
 //keyboardthread.cpp
 
 #include "keyboardthread.hpp"
+#include "threads.hpp"
 #include <stdio.h>
 
 using namespace drumpi;
 
 void KeyboardThread::run() {
+	blockSignals();
+
 	//printf("Keyboard thread has been started.\n");
 	kbdIn.pollInput();
 }
 
 int KeyboardThread::stop() {
-	kbdIn.running = 0;
+	kbdIn.stop();
 	this->join();
 	return 0;
 }
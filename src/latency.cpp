@@ -0,0 +1,120 @@
+// File: latency.cpp
+#include "latency.hpp"
+
+#include <algorithm>
+
+#include <time.h>
+
+using namespace drumpi;
+using namespace audio;
+
+uint64_t audio::monotonicTime() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+
+// LatencyHistogram class
+
+LatencyHistogram::LatencyHistogram() {
+    reset();
+}
+
+void LatencyHistogram::record(int64_t ns) {
+    uint64_t us = (ns > 0) ? ns / 1000 : 0;
+
+    buckets[bucketOf(us)].fetch_add(1, std::memory_order_relaxed);
+    total.fetch_add(1, std::memory_order_relaxed);
+    sum.fetch_add(us, std::memory_order_relaxed);
+
+    uint64_t prev = longest.load(std::memory_order_relaxed);
+    while (us > prev && !longest.compare_exchange_weak(prev, us, std::memory_order_relaxed)) {}
+}
+
+uint64_t LatencyHistogram::count() const {
+    return total.load(std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::percentile(double p) const {
+    uint64_t n = 0;
+    for (int i = 0; i < numBuckets; i++) n += buckets[i].load(std::memory_order_relaxed);
+    if (n == 0) return 0;
+
+    // Rank of the wanted duration, counting from 1
+    uint64_t rank = (uint64_t)(p * n);
+    if (rank < 1) rank = 1;
+    if (rank > n) rank = n;
+
+    uint64_t seen = 0;
+    for (int i = 0; i < numBuckets; i++) {
+        seen += buckets[i].load(std::memory_order_relaxed);
+        if (seen >= rank) return std::min(valueOf(i), max());
+    }
+
+    return max();
+}
+
+uint64_t LatencyHistogram::max() const {
+    return longest.load(std::memory_order_relaxed);
+}
+
+double LatencyHistogram::mean() const {
+    uint64_t n = count();
+    return n ? double(sum.load(std::memory_order_relaxed)) / n : 0.0;
+}
+
+void LatencyHistogram::reset() {
+    for (int i = 0; i < numBuckets; i++) buckets[i].store(0, std::memory_order_relaxed);
+    total = 0;
+    sum = 0;
+    longest = 0;
+}
+
+void LatencyHistogram::dump(std::ostream& os, const char* name) const {
+    os << name << ": n=" << count();
+    if (count()) {
+        os << " mean=" << (uint64_t)mean() << "us"
+           << " p50=" << percentile(0.5) << "us"
+           << " p90=" << percentile(0.9) << "us"
+           << " p99=" << percentile(0.99) << "us"
+           << " p99.9=" << percentile(0.999) << "us"
+           << " max=" << max() << "us";
+    }
+    os << std::endl;
+}
+
+int LatencyHistogram::bucketOf(uint64_t us) {
+    if (us < linearBuckets) return us;
+
+    // Top five bits of the duration pick the bucket within its power of two
+    int msb = 63 - __builtin_clzll(us);
+    int top = us >> (msb - 4);
+    int bucket = linearBuckets + (msb - 5) * subBuckets + (top - subBuckets);
+
+    return std::min(bucket, numBuckets - 1);
+}
+
+uint64_t LatencyHistogram::valueOf(int bucket) {
+    if (bucket < linearBuckets) return bucket;
+
+    // Upper bound of the bucket, so percentiles never understate
+    int msb = 5 + (bucket - linearBuckets) / subBuckets;
+    uint64_t top = subBuckets + (bucket - linearBuckets) % subBuckets;
+    return ((top + 1) << (msb - 4)) - 1;
+}
+
+
+// LatencyStats struct
+
+void LatencyStats::dump(std::ostream& os) const {
+    inputToTrigger.dump(os, "input -> trigger");
+    triggerToOutput.dump(os, "trigger -> output");
+    inputToOutput.dump(os, "input -> output");
+}
+
+void LatencyStats::reset() {
+    inputToTrigger.reset();
+    triggerToOutput.reset();
+    inputToOutput.reset();
+}
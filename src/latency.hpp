@@ -0,0 +1,113 @@
+// File: latency.hpp
+#ifndef DRUMPI_LATENCY_H
+#define DRUMPI_LATENCY_H
+
+#include <array>
+#include <atomic>
+#include <ostream>
+#include <cstdint>
+
+#include "defs.hpp"
+
+namespace drumpi {
+namespace audio {
+
+/*! Returns the current `CLOCK_MONOTONIC` time.
+The clock used for all latency timestamps, shared with the kernel input
+event timestamps and Jack's frame timing.
+\return time in nanoseconds. */
+uint64_t monotonicTime();
+
+
+/*! Lock-free histogram of durations.
+Buckets are exact below 32 us and then 16 per power of two, so percentiles are
+within about 6% at any scale. Recording never allocates or locks, so it is
+safe on the real-time thread. */
+class LatencyHistogram {
+    public:
+        /*! Constructor. */
+        LatencyHistogram();
+
+        /*! Records a duration. Negative durations are recorded as zero.
+        \param ns duration in nanoseconds. */
+        void record(int64_t ns);
+
+        /*! Returns the number of durations recorded.
+        \return number of durations. */
+        uint64_t count() const;
+
+        /*! Returns a percentile of the recorded durations.
+        \param p percentile as a fraction, e.g. 0.99.
+        \return duration in microseconds, or 0 if nothing was recorded. */
+        uint64_t percentile(double p) const;
+
+        /*! Returns the longest recorded duration.
+        \return duration in microseconds. */
+        uint64_t max() const;
+
+        /*! Returns the mean recorded duration.
+        \return duration in microseconds. */
+        double mean() const;
+
+        /*! Removes all recorded durations.
+        Not atomic with respect to concurrent \ref record calls. */
+        void reset();
+
+        /*! Writes a one-line summary.
+        \param os stream to write to.
+        \param name label for the line. */
+        void dump(std::ostream& os, const char* name) const;
+
+    private:
+        /*! Returns the bucket holding a duration.
+        \param us duration in microseconds.
+        \return bucket index. */
+        static int bucketOf(uint64_t us);
+
+        /*! Returns a representative duration for a bucket.
+        \param bucket bucket index.
+        \return duration in microseconds. */
+        static uint64_t valueOf(int bucket);
+
+        /*! Number of exact buckets. */
+        static const int linearBuckets = 32;
+        /*! Buckets per power of two above the exact buckets. */
+        static const int subBuckets = 16;
+        /*! Total number of buckets, covering up to about 2^40 us. */
+        static const int numBuckets = linearBuckets + (40 - 5) * subBuckets;
+
+        /*! Bucket counts. */
+        std::array<std::atomic<uint64_t>, numBuckets> buckets;
+        /*! Number of durations recorded. */
+        std::atomic<uint64_t> total;
+        /*! Sum of the recorded durations in microseconds. */
+        std::atomic<uint64_t> sum;
+        /*! Longest recorded duration in microseconds. */
+        std::atomic<uint64_t> longest;
+};
+
+
+/*! Key-to-sound latency measurements.
+Each key press is stamped three times: by the kernel when the input event
+arrives, when \ref PlaybackEngine::trigger is called, and with the time at
+which the period holding the drum's first sample starts playing. */
+struct LatencyStats {
+    /*! Input event to trigger call, i.e. keyboard handling. */
+    LatencyHistogram inputToTrigger;
+    /*! Trigger call to first sample output, i.e. queueing and buffering. */
+    LatencyHistogram triggerToOutput;
+    /*! Input event to first sample output. */
+    LatencyHistogram inputToOutput;
+
+    /*! Writes a summary of every histogram.
+    \param os stream to write to. */
+    void dump(std::ostream& os) const;
+
+    /*! Removes all recorded latencies. */
+    void reset();
+};
+
+} // namespace audio
+} // namespace drumpi
+
+#endif // define DRUMPI_LATENCY_H
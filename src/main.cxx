@@ -8,9 +8,15 @@
  * @date April 2021
  */
 #include "application.hpp"
+#include "timerThread.hpp"
 
 #include <iostream>
 #include <functional>
+#include <string>
+#include <csignal>
+#include <cstdlib>
+#include <cerrno>
+#include <climits>
 
 using namespace drumpi;
 
@@ -21,27 +27,100 @@ std::function<void(int)> shutdownHandler;
 Calls \ref shutdownHandler. */
 void signalHandler(int signal) { shutdownHandler(signal); }
 
+/*! Parses a whole command line argument as a number.
+\param arg the argument.
+\param value set to the number on success.
+\return `false` if the argument is not a number, or out of range. */
+bool parseFloat(const char* arg, float& value) {
+    char* end;
+    errno = 0;
+    float v = strtof(arg, &end);
+    if (end == arg || *end != '\0' || errno == ERANGE) return false;
+    value = v;
+    return true;
+}
+
+/*! Parses a whole command line argument as an integer.
+\param arg the argument.
+\param value set to the integer on success.
+\return `false` if the argument is not an integer, or out of range. */
+bool parseInt(const char* arg, int& value) {
+    char* end;
+    errno = 0;
+    long v = strtol(arg, &end, 10);
+    if (end == arg || *end != '\0' || errno == ERANGE || v < INT_MIN || v > INT_MAX) return false;
+    value = (int)v;
+    return true;
+}
+
 /*! Main function of execution. */
 int main(int argc, char* argv[]){
 
     std::cout << std::endl << PROJECT_NAME << " v" << PROJECT_VERSION << std::endl;
 
-    Application* appPtr;
+    Application* appPtr = nullptr;
     signal(SIGINT, signalHandler);
     signal(SIGQUIT, signalHandler);
     signal(SIGTERM, signalHandler);
     signal(SIGHUP, signalHandler);
     signal(SIGKILL, signalHandler);
     signal(SIGTSTP, signalHandler);
+    signal(SIGUSR1, signalHandler);
     shutdownHandler = [&](int signal) {
+        if (!appPtr) return;
+
+        // SIGUSR1 prints the latency and audio thread statistics
+        if (signal == SIGUSR1) {
+            appPtr->requestStats();
+            return;
+        }
+
         std::cout << "DrumPi: caught signal " << signal << std::endl;
-        appPtr->running = false;
+        appPtr->quit();
     };
 
+    // Audio output, `--null-audio` runs without a Jack server,
+    // `--direct-outs` gives each drum its own pair of ports and
+    // `--int16-samples` halves the memory used by samples and
+    // `--stream SECONDS` streams samples longer than SECONDS from disk
+    audio::audioBackendType_t backend = audio::BACKEND_JACK;
+    bool directOuts = false;
+    audio::sampleFormat_t format = audio::SAMPLE_FLOAT32;
+    float streamSeconds = 0.f;
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) == "--null-audio") backend = audio::BACKEND_NULL;
+        if (std::string(argv[i]) == "--direct-outs") directOuts = true;
+        if (std::string(argv[i]) == "--int16-samples") format = audio::SAMPLE_INT16;
+        if (std::string(argv[i]) == "--stream" && i + 1 < argc) {
+            if (!parseFloat(argv[++i], streamSeconds)) {
+                std::cout << "DrumPi: --stream takes a length in seconds" << std::endl;
+                return 1;
+            }
+        }
+    }
+
+    // Timer thread, `--timer-priority N` runs the clocks at SCHED_FIFO
+    // priority N and `--timer-cpu N` pins them to CPU N
+    clock::TimerThread& timers = clock::TimerThread::instance();
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) == "--timer-priority" && i + 1 < argc) {
+            int priority;
+            if (!parseInt(argv[++i], priority) || !timers.setPriority(priority)) {
+                std::cout << "DrumPi: could not set timer thread priority" << std::endl;
+            }
+        }
+        if (std::string(argv[i]) == "--timer-cpu" && i + 1 < argc) {
+            int cpu;
+            if (!parseInt(argv[++i], cpu) || !timers.setAffinity(cpu)) {
+                std::cout << "DrumPi: could not set timer thread CPU" << std::endl;
+            }
+        }
+    }
+
     Application app;
     appPtr = &app;
 
-    app.setup();
+    app.setup(backend, directOuts, format, streamSeconds);
     app.run();
 
     return 0;
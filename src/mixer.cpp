@@ -0,0 +1,268 @@
+// File: mixer.cpp
+#include "mixer.hpp"
+
+#include <algorithm>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    #include <arm_neon.h>
+    #define DRUMPI_MIXER_NEON
+#elif defined(__AVX__)
+    #include <immintrin.h>
+    #define DRUMPI_MIXER_AVX
+#elif defined(__SSE__)
+    #include <xmmintrin.h>
+    #define DRUMPI_MIXER_SSE
+#endif
+
+// Integer conversions on x86 need SSE2, baseline on x86-64
+#if (defined(DRUMPI_MIXER_AVX) || defined(DRUMPI_MIXER_SSE)) && defined(__SSE2__)
+    #include <emmintrin.h>
+    #define DRUMPI_MIXER_SSE2
+#endif
+
+// Keep the scalar references scalar so they remain a fair baseline
+#if defined(__GNUC__) && !defined(__clang__)
+    #define DRUMPI_NO_VECTORIZE __attribute__((optimize("no-tree-vectorize")))
+#else
+    #define DRUMPI_NO_VECTORIZE
+#endif
+
+using namespace drumpi;
+using namespace audio;
+
+void audio::mixGain(sample_t* out, const sample_t* in, float gain, int n) {
+    int i = 0;
+
+#if defined(DRUMPI_MIXER_NEON)
+    float32x4_t g = vdupq_n_f32(gain);
+    for (; i + 8 <= n; i += 8) {
+        float32x4_t a0 = vld1q_f32(out + i);
+        float32x4_t a1 = vld1q_f32(out + i + 4);
+        a0 = vmlaq_f32(a0, vld1q_f32(in + i), g);
+        a1 = vmlaq_f32(a1, vld1q_f32(in + i + 4), g);
+        vst1q_f32(out + i, a0);
+        vst1q_f32(out + i + 4, a1);
+    }
+#elif defined(DRUMPI_MIXER_AVX)
+    __m256 g = _mm256_set1_ps(gain);
+    for (; i + 8 <= n; i += 8) {
+        __m256 a = _mm256_loadu_ps(out + i);
+        a = _mm256_add_ps(a, _mm256_mul_ps(_mm256_loadu_ps(in + i), g));
+        _mm256_storeu_ps(out + i, a);
+    }
+#elif defined(DRUMPI_MIXER_SSE)
+    __m128 g = _mm_set1_ps(gain);
+    for (; i + 8 <= n; i += 8) {
+        __m128 a0 = _mm_loadu_ps(out + i);
+        __m128 a1 = _mm_loadu_ps(out + i + 4);
+        a0 = _mm_add_ps(a0, _mm_mul_ps(_mm_loadu_ps(in + i), g));
+        a1 = _mm_add_ps(a1, _mm_mul_ps(_mm_loadu_ps(in + i + 4), g));
+        _mm_storeu_ps(out + i, a0);
+        _mm_storeu_ps(out + i + 4, a1);
+    }
+#endif
+
+    // Remainder
+    mixGainScalar(out + i, in + i, gain, n - i);
+}
+
+DRUMPI_NO_VECTORIZE void audio::mixGainScalar(sample_t* out, const sample_t* in, float gain, int n) {
+    for (int i = 0; i < n; i++) {
+        out[i] += in[i] * gain;
+    }
+}
+
+void audio::mixGainInt16(sample_t* out, const int16_t* in, float gain, int n) {
+    int i = 0;
+
+#if defined(DRUMPI_MIXER_NEON)
+    float32x4_t g = vdupq_n_f32(gain);
+    for (; i + 8 <= n; i += 8) {
+        int16x8_t s = vld1q_s16(in + i);
+        float32x4_t f0 = vcvtq_f32_s32(vmovl_s16(vget_low_s16(s)));
+        float32x4_t f1 = vcvtq_f32_s32(vmovl_s16(vget_high_s16(s)));
+        vst1q_f32(out + i, vmlaq_f32(vld1q_f32(out + i), f0, g));
+        vst1q_f32(out + i + 4, vmlaq_f32(vld1q_f32(out + i + 4), f1, g));
+    }
+#elif defined(DRUMPI_MIXER_SSE2)
+    __m128 g = _mm_set1_ps(gain);
+    for (; i + 8 <= n; i += 8) {
+        __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        // Sign-extend each half to 32 bits by unpacking into the high words
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16);
+        __m128 a0 = _mm_add_ps(_mm_loadu_ps(out + i), _mm_mul_ps(_mm_cvtepi32_ps(lo), g));
+        __m128 a1 = _mm_add_ps(_mm_loadu_ps(out + i + 4), _mm_mul_ps(_mm_cvtepi32_ps(hi), g));
+        _mm_storeu_ps(out + i, a0);
+        _mm_storeu_ps(out + i + 4, a1);
+    }
+#endif
+
+    // Remainder
+    mixGainInt16Scalar(out + i, in + i, gain, n - i);
+}
+
+DRUMPI_NO_VECTORIZE void audio::mixGainInt16Scalar(sample_t* out, const int16_t* in, float gain, int n) {
+    for (int i = 0; i < n; i++) {
+        out[i] += in[i] * gain;
+    }
+}
+
+void audio::mixGainRamp(sample_t* out, const sample_t* in, float gain, float step, int n) {
+    int i = 0;
+
+    // The gain of each lane is recomputed from its index rather than
+    // accumulated, so long ramps do not drift
+#if defined(DRUMPI_MIXER_NEON)
+    float32x4_t g0 = vdupq_n_f32(gain);
+    float32x4_t s = vdupq_n_f32(step);
+    const float lanes[4] = {0.f, 1.f, 2.f, 3.f};
+    float32x4_t idx = vld1q_f32(lanes);
+    float32x4_t four = vdupq_n_f32(4.f);
+    for (; i + 8 <= n; i += 8) {
+        float32x4_t idx1 = vaddq_f32(idx, four);
+        float32x4_t a0 = vld1q_f32(out + i);
+        float32x4_t a1 = vld1q_f32(out + i + 4);
+        a0 = vmlaq_f32(a0, vld1q_f32(in + i), vmlaq_f32(g0, idx, s));
+        a1 = vmlaq_f32(a1, vld1q_f32(in + i + 4), vmlaq_f32(g0, idx1, s));
+        vst1q_f32(out + i, a0);
+        vst1q_f32(out + i + 4, a1);
+        idx = vaddq_f32(idx1, four);
+    }
+#elif defined(DRUMPI_MIXER_AVX)
+    __m256 g0 = _mm256_set1_ps(gain);
+    __m256 s = _mm256_set1_ps(step);
+    __m256 idx = _mm256_setr_ps(0.f, 1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f);
+    __m256 eight = _mm256_set1_ps(8.f);
+    for (; i + 8 <= n; i += 8) {
+        __m256 g = _mm256_add_ps(g0, _mm256_mul_ps(idx, s));
+        __m256 a = _mm256_loadu_ps(out + i);
+        a = _mm256_add_ps(a, _mm256_mul_ps(_mm256_loadu_ps(in + i), g));
+        _mm256_storeu_ps(out + i, a);
+        idx = _mm256_add_ps(idx, eight);
+    }
+#elif defined(DRUMPI_MIXER_SSE)
+    __m128 g0 = _mm_set1_ps(gain);
+    __m128 s = _mm_set1_ps(step);
+    __m128 idx = _mm_setr_ps(0.f, 1.f, 2.f, 3.f);
+    __m128 four = _mm_set1_ps(4.f);
+    for (; i + 8 <= n; i += 8) {
+        __m128 idx1 = _mm_add_ps(idx, four);
+        __m128 a0 = _mm_loadu_ps(out + i);
+        __m128 a1 = _mm_loadu_ps(out + i + 4);
+        a0 = _mm_add_ps(a0, _mm_mul_ps(_mm_loadu_ps(in + i), _mm_add_ps(g0, _mm_mul_ps(idx, s))));
+        a1 = _mm_add_ps(a1, _mm_mul_ps(_mm_loadu_ps(in + i + 4), _mm_add_ps(g0, _mm_mul_ps(idx1, s))));
+        _mm_storeu_ps(out + i, a0);
+        _mm_storeu_ps(out + i + 4, a1);
+        idx = _mm_add_ps(idx1, four);
+    }
+#endif
+
+    // Remainder
+    mixGainRampScalar(out + i, in + i, gain + i * step, step, n - i);
+}
+
+DRUMPI_NO_VECTORIZE void audio::mixGainRampScalar(sample_t* out, const sample_t* in, float gain, float step,
+    int n)
+{
+    for (int i = 0; i < n; i++) {
+        out[i] += in[i] * (gain + i * step);
+    }
+}
+
+void audio::mixGainRampInt16(sample_t* out, const int16_t* in, float gain, float step, int n) {
+    int i = 0;
+
+#if defined(DRUMPI_MIXER_NEON)
+    float32x4_t g0 = vdupq_n_f32(gain);
+    float32x4_t s = vdupq_n_f32(step);
+    const float lanes[4] = {0.f, 1.f, 2.f, 3.f};
+    float32x4_t idx = vld1q_f32(lanes);
+    float32x4_t four = vdupq_n_f32(4.f);
+    for (; i + 8 <= n; i += 8) {
+        float32x4_t idx1 = vaddq_f32(idx, four);
+        int16x8_t x = vld1q_s16(in + i);
+        float32x4_t f0 = vcvtq_f32_s32(vmovl_s16(vget_low_s16(x)));
+        float32x4_t f1 = vcvtq_f32_s32(vmovl_s16(vget_high_s16(x)));
+        vst1q_f32(out + i, vmlaq_f32(vld1q_f32(out + i), f0, vmlaq_f32(g0, idx, s)));
+        vst1q_f32(out + i + 4, vmlaq_f32(vld1q_f32(out + i + 4), f1, vmlaq_f32(g0, idx1, s)));
+        idx = vaddq_f32(idx1, four);
+    }
+#elif defined(DRUMPI_MIXER_SSE2)
+    __m128 g0 = _mm_set1_ps(gain);
+    __m128 s = _mm_set1_ps(step);
+    __m128 idx = _mm_setr_ps(0.f, 1.f, 2.f, 3.f);
+    __m128 four = _mm_set1_ps(4.f);
+    for (; i + 8 <= n; i += 8) {
+        __m128 idx1 = _mm_add_ps(idx, four);
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+        __m128 g1 = _mm_add_ps(g0, _mm_mul_ps(idx, s));
+        __m128 g2 = _mm_add_ps(g0, _mm_mul_ps(idx1, s));
+        _mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(out + i), _mm_mul_ps(_mm_cvtepi32_ps(lo), g1)));
+        _mm_storeu_ps(out + i + 4, _mm_add_ps(_mm_loadu_ps(out + i + 4), _mm_mul_ps(_mm_cvtepi32_ps(hi), g2)));
+        idx = _mm_add_ps(idx1, four);
+    }
+#endif
+
+    // Remainder
+    mixGainRampInt16Scalar(out + i, in + i, gain + i * step, step, n - i);
+}
+
+DRUMPI_NO_VECTORIZE void audio::mixGainRampInt16Scalar(sample_t* out, const int16_t* in, float gain, float step,
+    int n)
+{
+    for (int i = 0; i < n; i++) {
+        out[i] += in[i] * (gain + i * step);
+    }
+}
+
+void audio::fanOut(sample_t* const* outs, int nOuts, const sample_t* in, int n) {
+    int i = 0;
+
+#if defined(DRUMPI_MIXER_NEON)
+    for (; i + 4 <= n; i += 4) {
+        float32x4_t a = vld1q_f32(in + i);
+        for (int j = 0; j < nOuts; j++) vst1q_f32(outs[j] + i, a);
+    }
+#elif defined(DRUMPI_MIXER_AVX)
+    for (; i + 8 <= n; i += 8) {
+        __m256 a = _mm256_loadu_ps(in + i);
+        for (int j = 0; j < nOuts; j++) _mm256_storeu_ps(outs[j] + i, a);
+    }
+#elif defined(DRUMPI_MIXER_SSE)
+    for (; i + 4 <= n; i += 4) {
+        __m128 a = _mm_loadu_ps(in + i);
+        for (int j = 0; j < nOuts; j++) _mm_storeu_ps(outs[j] + i, a);
+    }
+#endif
+
+    // Remainder
+    for (; i < n; i++) {
+        for (int j = 0; j < nOuts; j++) outs[j][i] = in[i];
+    }
+}
+
+DRUMPI_NO_VECTORIZE void audio::fanOutScalar(sample_t* const* outs, int nOuts, const sample_t* in, int n) {
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < nOuts; j++) outs[j][i] = in[i];
+    }
+}
+
+void audio::panGains(float pan, float& left, float& right) {
+    left = std::min(1.f, 1.f - pan);
+    right = std::min(1.f, 1.f + pan);
+}
+
+const char* audio::mixerKernelName() {
+#if defined(DRUMPI_MIXER_NEON)
+    return "NEON";
+#elif defined(DRUMPI_MIXER_AVX)
+    return "AVX";
+#elif defined(DRUMPI_MIXER_SSE)
+    return "SSE";
+#else
+    return "scalar";
+#endif
+}
@@ -0,0 +1,94 @@
+// File: mixer.hpp
+#ifndef DRUMPI_MIXER_H
+#define DRUMPI_MIXER_H
+
+#include <cstdint>
+
+#include "defs.hpp"
+
+namespace drumpi {
+namespace audio {
+
+/*! Adds a buffer, scaled by a gain, into another buffer.
+Vectorised with NEON, AVX or SSE depending on the target, see
+\ref mixerKernelName.
+\param out buffer to add to.
+\param in buffer to add.
+\param gain linear gain applied to `in`.
+\param n number of samples. */
+void mixGain(sample_t* out, const sample_t* in, float gain, int n);
+
+/*! Scalar reference implementation of \ref mixGain. */
+void mixGainScalar(sample_t* out, const sample_t* in, float gain, int n);
+
+/*! Adds a buffer of 16-bit samples, converted and scaled by a gain, into a
+buffer.
+The conversion is folded into the mix, so 16-bit sample data is read at
+half the bandwidth of float data and never expanded in memory.
+\param out buffer to add to.
+\param in buffer to add.
+\param gain linear gain applied to `in`, including any scaling from the
+integer range, e.g. \ref int16Scale.
+\param n number of samples. */
+void mixGainInt16(sample_t* out, const int16_t* in, float gain, int n);
+
+/*! Scalar reference implementation of \ref mixGainInt16. */
+void mixGainInt16Scalar(sample_t* out, const int16_t* in, float gain, int n);
+
+/*! Adds a buffer, scaled by a linear gain ramp, into another buffer.
+Sample `i` is scaled by `gain + i * step`, so a gain change is spread over
+the buffer instead of stepping at its start. Vectorised like \ref mixGain.
+\param out buffer to add to.
+\param in buffer to add.
+\param gain linear gain applied to the first sample.
+\param step change in gain per sample.
+\param n number of samples. */
+void mixGainRamp(sample_t* out, const sample_t* in, float gain, float step, int n);
+
+/*! Scalar reference implementation of \ref mixGainRamp. */
+void mixGainRampScalar(sample_t* out, const sample_t* in, float gain, float step, int n);
+
+/*! Adds a buffer of 16-bit samples, converted and scaled by a linear gain
+ramp, into a buffer.
+\param out buffer to add to.
+\param in buffer to add.
+\param gain linear gain applied to the first sample, including any scaling
+from the integer range.
+\param step change in gain per sample, on the same scale.
+\param n number of samples. */
+void mixGainRampInt16(sample_t* out, const int16_t* in, float gain, float step, int n);
+
+/*! Scalar reference implementation of \ref mixGainRampInt16. */
+void mixGainRampInt16Scalar(sample_t* out, const int16_t* in, float gain, float step, int n);
+
+/*! Scale from the 16-bit integer range to [-1, 1). */
+const float int16Scale = 1.f / 32768.f;
+
+/*! Copies a buffer to several output buffers, reading it only once.
+Repeats the main pair on output ports past the first two.
+\param outs array of output buffers.
+\param nOuts number of output buffers.
+\param in buffer to copy.
+\param n number of samples. */
+void fanOut(sample_t* const* outs, int nOuts, const sample_t* in, int n);
+
+/*! Scalar reference implementation of \ref fanOut. */
+void fanOutScalar(sample_t* const* outs, int nOuts, const sample_t* in, int n);
+
+/*! Calculates the gains of a left and right output for a pan position.
+Uses a balance law: the centre leaves both sides at unity, so a centred mono
+drum sounds as it did before panning, and panning attenuates the far side.
+\param pan pan position, from -1 (left) to 1 (right).
+\param left set to the gain of the left output.
+\param right set to the gain of the right output. */
+void panGains(float pan, float& left, float& right);
+
+/*! Returns the name of the instruction set the mixing kernels were built
+for.
+\return "NEON", "AVX", "SSE" or "scalar". */
+const char* mixerKernelName();
+
+} // namespace audio
+} // namespace drumpi
+
+#endif // define DRUMPI_MIXER_H
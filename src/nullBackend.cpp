@@ -0,0 +1,112 @@
+// File: nullBackend.cpp
+#include "nullBackend.hpp"
+#include "latency.hpp"
+#include "threads.hpp"
+
+#include <chrono>
+
+using namespace drumpi;
+using namespace audio;
+
+NullBackend::NullBackend(int sampleRate, int bufferSize, int nOutPorts, bool realTime) {
+    this->sampleRate = sampleRate;
+    this->bufferSize = bufferSize;
+    this->realTime = realTime;
+
+    buffers.resize(nOutPorts, std::vector<sample_t>(bufferSize));
+    outBuffers.resize(nOutPorts);
+    for (int i = 0; i < nOutPorts; i++) {
+        outBuffers[i] = buffers[i].data();
+    }
+
+    callback = nullptr;
+    numPeriods = 0;
+    running = false;
+    open = true;
+}
+
+NullBackend::~NullBackend() {
+    stop();
+}
+
+audioError_t NullBackend::start(AudioCallback& callback) {
+    if (!open) return CLIENT_OPEN_FAILED;
+    if (running) return NO_ERROR;
+
+    this->callback = &callback;
+    callback.prepare(sampleRate, bufferSize);
+
+    numPeriods = 0;
+    stats.reset();
+    running = true;
+    thread.reset(new std::thread(&NullBackend::process, this));
+
+    return NO_ERROR;
+}
+
+audioError_t NullBackend::stop(bool closeClient) {
+    running = false;
+    if (thread) {
+        thread->join();
+        thread = nullptr;
+    }
+
+    if (closeClient) open = false;
+
+    return NO_ERROR;
+}
+
+bool NullBackend::isOpen() {
+    return open;
+}
+
+bool NullBackend::isRunning() {
+    return running;
+}
+
+int NullBackend::getSampleRate() {
+    return sampleRate;
+}
+
+int NullBackend::getBufferSize() {
+    return bufferSize;
+}
+
+AudioStatsSnapshot NullBackend::getStats() {
+    return stats.read();
+}
+
+uint64_t NullBackend::getNumPeriods() {
+    return numPeriods.load(std::memory_order_relaxed);
+}
+
+void NullBackend::process() {
+    // Like an audio server thread, never run signal handlers here
+    blockSignals();
+
+    std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+    uint64_t startNs = monotonicTime();
+    uint64_t budgetNs = (bufferSize * 1000000000ULL) / sampleRate;
+    uint64_t frames = 0;
+
+    while (running) {
+        // Output of this period would start once the previous one has played
+        callback->setOutputTime(startNs + ((frames + bufferSize) * 1000000000ULL) / sampleRate);
+
+        uint64_t periodStart = monotonicTime();
+        callback->render(outBuffers.data(), outBuffers.size(), bufferSize);
+        uint64_t periodEnd = monotonicTime();
+
+        stats.recordPeriod(periodEnd - periodStart, budgetNs);
+        numPeriods.fetch_add(1, std::memory_order_relaxed);
+        frames += bufferSize;
+
+        // Finishing after this period was due to play is an xrun
+        if (realTime && periodEnd > startNs + (frames * 1000000000ULL) / sampleRate) stats.recordXrun();
+
+        if (realTime) {
+            // Deadlines are derived from the frame count so they do not drift
+            std::this_thread::sleep_until(startTime + std::chrono::nanoseconds((frames * 1000000000ULL) / sampleRate));
+        }
+    }
+}
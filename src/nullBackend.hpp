@@ -0,0 +1,116 @@
+// File: nullBackend.hpp
+#ifndef DRUMPI_NULL_BACKEND_H
+#define DRUMPI_NULL_BACKEND_H
+
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <cstdint>
+
+#include "defs.hpp"
+#include "audio.hpp"
+
+namespace drumpi {
+namespace audio {
+
+/*! Audio backend that discards its output.
+Calls the \ref AudioCallback from its own thread at the configured period and
+rate, or as fast as possible, so latency and throughput can be measured
+without a Jack server or audio hardware. */
+class NullBackend : public AudioBackend {
+    public:
+        /*! Constructor.
+        \param sampleRate simulated sample rate in Hz. Default 48000.
+        \param bufferSize simulated period size in frames. Default 128.
+        \param nOutPorts number of output buffers. Default 2.
+        \param realTime if `true` periods are paced to the sample rate,
+        otherwise they run back to back. */
+        NullBackend(int sampleRate = NullBackend::defSampleRate, int bufferSize = NullBackend::defBufferSize,
+            int nOutPorts = NullBackend::defNumOutPorts, bool realTime = true);
+
+        /*! Destructor.
+        Stops the processing thread. */
+        ~NullBackend();
+
+        /*! Starts the processing thread.
+        \param callback \ref AudioCallback object to fetch output samples from.
+        \return error code. */
+        audioError_t start(AudioCallback& callback) override;
+
+        /*! Stops the processing thread.
+        \param closeClient whether to also close the backend.
+        \return error code. */
+        audioError_t stop(bool closeClient = true) override;
+
+        /*! Check if the backend is open.
+        \return `true` if the backend is open. */
+        bool isOpen() override;
+
+        /*! Check if the processing thread is running.
+        \return `true` if running. */
+        bool isRunning() override;
+
+        /*! Returns the simulated sample rate.
+        \return sample rate in Hz. */
+        int getSampleRate() override;
+
+        /*! Returns the simulated period size.
+        \return period size in frames. */
+        int getBufferSize() override;
+
+        /*! Returns the callback timing statistics.
+        A period that finishes after its deadline counts as an xrun.
+        \return the statistics. */
+        AudioStatsSnapshot getStats() override;
+
+        /*! Returns the number of periods processed since starting.
+        \return number of periods. */
+        uint64_t getNumPeriods();
+
+    private:
+        /*! Processing thread loop. */
+        void process();
+
+        /*! Pointer to the \ref AudioCallback object that fetches output
+        samples. */
+        AudioCallback* callback;
+
+        /*! Processing thread. */
+        std::unique_ptr<std::thread> thread;
+
+        /*! Output buffer storage. */
+        std::vector<std::vector<sample_t>> buffers;
+        /*! Output buffer pointers passed to the callback. */
+        std::vector<sample_t*> outBuffers;
+
+        /*! Simulated sample rate. */
+        int sampleRate;
+        /*! Simulated period size. */
+        int bufferSize;
+        /*! Whether periods are paced to the sample rate. */
+        bool realTime;
+
+        /*! Number of periods processed. */
+        std::atomic<uint64_t> numPeriods;
+
+        /*! Callback timing statistics. */
+        AudioStats stats;
+
+        /*! Backend open status. */
+        bool open;
+        /*! Processing thread running status. */
+        std::atomic<bool> running;
+
+        /*! Default sample rate. */
+        static const int defSampleRate = 48000;
+        /*! Default period size. */
+        static const int defBufferSize = 128;
+        /*! Default number of output ports. */
+        static const int defNumOutPorts = 2;
+};
+
+} // namespace audio
+} // namespace drumpi
+
+#endif // define DRUMPI_NULL_BACKEND_H
@@ -1,15 +1,84 @@
 #include "playback.hpp"
+#include "mixer.hpp"
+#include "threads.hpp"
 #include "math.h"
 
+#include <algorithm>
+#include <chrono>
+
 using namespace drumpi;
 using namespace audio;
 
-PlaybackEngine::PlaybackEngine() {
+// EventList class
+
+EventList::EventList() {
+    clear();
+}
+
+bool EventList::add(int offset, drumID_t drum, int velocity) {
+    if (numEvents >= capacity) return false;
+
+    events[numEvents].offset = offset;
+    events[numEvents].drum = drum;
+    events[numEvents].velocity = (uint8_t)velocity;
+    numEvents++;
+    return true;
+}
+
+int EventList::size() {
+    return numEvents;
+}
+
+const ScheduledEvent& EventList::operator[](int i) {
+    return events[i];
+}
+
+void EventList::clear() {
+    numEvents = 0;
+}
+
+void EventList::sort() {
+    // Insertion sort: lists are short and usually already in order
+    for (int i = 1; i < numEvents; i++) {
+        ScheduledEvent e = events[i];
+        int j = i - 1;
+        while (j >= 0 && events[j].offset > e.offset) {
+            events[j + 1] = events[j];
+            j--;
+        }
+        events[j + 1] = e;
+    }
+}
+
+
+// PlaybackEngine class
+
+PlaybackEngine::PlaybackEngine(int numVoices) :
+    voices(numVoices)
+{
     masterVol = masterVolDef;
+    rtMasterVol = masterVol;
+    numActiveVoices = 0;
+    stealPolicy = voices.getStealPolicy();
+    frameTime = 0;
+    sampleRate = sampleRateDef;
+    sampleFormat = SAMPLE_FLOAT32;
+    streamThreshold = 0.f;
+    scheduler = nullptr;
+    schedulerUses = 0;
+    bank = nullptr;
+    rtBank = nullptr;
+    numPeriods = 0;
+    rtOutputTime = 0;
+    directOuts = false;
+    rtDirectOuts = false;
 
     for (int i = 0; i < NUM_DRUMS; i++) {
         isTriggered[i] = false;
         volumes[i] = volumeDef;
+        rtVolumes[i] = volumes[i];
+        pans[i] = 0;
+        rtPans[i] = 0.f;
     }
 
     // Calculate volume lookup table
@@ -17,45 +86,172 @@ PlaybackEngine::PlaybackEngine() {
         float x = float(i) / 100.f;
         volumeTable[i] = x * powf(10.f, x - 1.f);
     }
+
+    // Bank loader
+    requestedBank = 0;
+    requestedType = SOURCE_PREGENERATED;
+    requestPending = false;
+    preloadBank = 0;
+    preloadType = SOURCE_PREGENERATED;
+    preloadPending = false;
+    loaderRunning = true;
+    loading = false;
+    loadStatus = SOURCE_READY;
+    loader = std::thread(&PlaybackEngine::loaderLoop, this);
+
+    // Ramp volume and pan changes instead of stepping them
+    voices.setSmoothing(smoothingTime * sampleRate);
+
+    // Streamed samples, through a streamer started only while streaming is on
+    voices.setStreamer(&streamer);
 }
 
-std::vector<sample_t> PlaybackEngine::getSamples(int nSamples) {
-    // Create temporary buffer for source returns
-    std::vector<sample_t> temp(nSamples);
+PlaybackEngine::~PlaybackEngine() {
+    {
+        std::lock_guard<std::mutex> lock(loaderMutex);
+        loaderRunning = false;
+    }
+    loaderCond.notify_one();
+    loader.join();
 
-    // Clear object buffer and set the size
-    buffer.clear();
+    // The audio callback has stopped by now, so everything can go
+    for (int i = 0; i < retiredBanks.size(); i++) delete retiredBanks[i].bank;
+    delete bank.load();
+}
+
+std::vector<sample_t> PlaybackEngine::getSamples(int nSamples) {
     buffer.resize(nSamples);
 
-    for (int i = 0; i < NUM_DRUMS; i++) { // For each drum...
-        if (isTriggered[i]) {
-            // Get samples from the source
-            temp = sources[i]->getSamples(nSamples);
+    sample_t* out = buffer.data();
+    render(&out, 1, nSamples);
 
-            // Copy additively into object buffer
-            // Take volumes into account at this stage
-            float vol = volumeTable[masterVol] * volumeTable[volumes[i]];
-            for (int j = 0; j < nSamples; j++) {
-                buffer[j] += temp[j] * vol;
-            }
+    return buffer;
+}
+
+void PlaybackEngine::render(sample_t* const* outs, int nOuts, int nFrames) {
+    if (nOuts < 1) return;
+
+    uint64_t now = frameTime.load(std::memory_order_relaxed);
+
+    // Hold one bank for the whole period
+    rtBank = bank.load();
+
+    // Apply changes from the control threads before mixing
+    applyCommands();
+
+    // Collect the triggers falling in this period
+    // The count is odd while the scheduler is in use, for setScheduler
+    events.clear();
+    schedulerUses.fetch_add(1);
+    EventScheduler* s = scheduler.load();
+    if (s) s->schedule(now, nFrames, sampleRate.load(std::memory_order_relaxed), events);
+    schedulerUses.fetch_add(1);
+    events.sort();
+
+    // Mix into the main pair, and the direct outputs if on. Ports past the
+    // direct outputs are silent.
+    bool direct = rtDirectOuts && nOuts >= numDirectOuts;
+    int nMain = std::min(nOuts, 2);
+    int nMix = direct ? (int)numDirectOuts : nMain;
 
-            // Check source status
-            // If finished, untrigger the source
-            if (sources[i]->getStatus() == SOURCE_FINISHED) untrigger((drumID_t)i);
+    for (int i = 0; i < (direct ? nOuts : nMix); i++) {
+        std::fill(outs[i], outs[i] + nFrames, 0.f);
+    }
+
+    // Split the period at each trigger so drums start on the exact frame
+    int pos = 0;
+    int e = 0;
+    while (pos < nFrames) {
+        while (e < events.size() && events[e].offset <= pos) {
+            startDrum(events[e].drum, events[e].velocity);
+            e++;
         }
+
+        int end = (e < events.size()) ? std::min(events[e].offset, nFrames) : nFrames;
+        mix(outs, nMain, nMix, pos, end - pos);
+        pos = end;
     }
 
-    return buffer;
+    // Without direct outputs every further pair repeats the main pair
+    if (!direct && nOuts > 2) {
+        sample_t* extra[numDirectOuts];
+        for (int side = 0; side < 2; side++) {
+            int k = 0;
+            for (int i = 2 + side; i < nOuts; i += 2) {
+                extra[k++] = outs[i];
+                if (k == numDirectOuts || i + 2 >= nOuts) {
+                    fanOut(extra, k, outs[side], nFrames);
+                    k = 0;
+                }
+            }
+        }
+    }
+
+    numActiveVoices.store(voices.numActive(), std::memory_order_relaxed);
+    frameTime.store(now + nFrames, std::memory_order_release);
+
+    // Done with rtBank
+    numPeriods.fetch_add(1);
 }
 
-void PlaybackEngine::trigger(drumID_t drum) {
-    if (sources[drum]->getStatus() == SOURCE_ACTIVE) sources[drum]->reset();
+void PlaybackEngine::prepare(int sampleRate, int bufferSize) {
+    if (sampleRate <= 0 || sampleRate == this->sampleRate) return;
+
+    this->sampleRate = sampleRate;
+    voices.setSmoothing(smoothingTime * sampleRate);
+
+    // Banks loaded at the old rate would play detuned
+    reload();
+}
+
+void PlaybackEngine::setOutputTime(uint64_t ns) {
+    rtOutputTime = ns;
+}
+
+int PlaybackEngine::getSampleRate() {
+    return sampleRate;
+}
+
+void PlaybackEngine::setScheduler(EventScheduler* s) {
+    scheduler.store(s);
+
+    // Wait out a period that may have loaded the old scheduler. Any later
+    // one sees the new pointer.
+    uint64_t uses = schedulerUses.load();
+    if (uses % 2 == 0) return;
+    while (schedulerUses.load() == uses) std::this_thread::yield();
+}
+
+void PlaybackEngine::mix(sample_t* const* outs, int nMain, int nOuts, int offset, int nFrames) {
+    // Take volumes into account at this stage
+    for (int i = 0; i < NUM_DRUMS; i++) {
+        directGains[i] = volumeTable[rtVolumes[i]];
+        gains[i] = volumeTable[rtMasterVol] * directGains[i];
+    }
+
+    // Point at this section of each output
+    sample_t* section[numDirectOuts];
+    for (int i = 0; i < nOuts; i++) section[i] = outs[i] + offset;
+
+    voices.mix(
+        section, nMain, nFrames, gains.data(), rtPans.data(),
+        (nOuts > nMain) ? section + 2 : nullptr, directGains.data()
+    );
+
+    // Clear the display flag of any drum that has finished
+    for (int i = 0; i < NUM_DRUMS; i++) {
+        if (isTriggered[i] && !voices.isActive((drumID_t)i)) isTriggered[i] = false;
+    }
+}
+
+void PlaybackEngine::trigger(drumID_t drum, uint64_t inputTime, int velocity) {
     isTriggered[drum] = true;
+    post(CMD_TRIGGER, drum, velocity, inputTime);
 }
 
 void PlaybackEngine::untrigger(drumID_t drum) {
     isTriggered[drum] = false;
-    sources[drum]->reset();
+    post(CMD_UNTRIGGER, drum);
 }
 
 std::vector<drumID_t> PlaybackEngine::getActive() {
@@ -70,18 +266,22 @@ std::vector<drumID_t> PlaybackEngine::getActive() {
 
 void PlaybackEngine::volumeUp(drumID_t drum) {
     volumes[drum] = std::min(volumes[drum] + volumeStep, 100);
+    post(CMD_DRUM_VOLUME, drum, volumes[drum]);
 }
 
 void PlaybackEngine::volumeUp() {
     masterVol = std::min(masterVol + volumeStep, 100);
+    post(CMD_MASTER_VOLUME, DRUM_1, masterVol);
 }
 
 void PlaybackEngine::volumeDown(drumID_t drum) {
     volumes[drum] = std::max(volumes[drum] - volumeStep, 0);
+    post(CMD_DRUM_VOLUME, drum, volumes[drum]);
 }
 
 void PlaybackEngine::volumeDown() {
     masterVol = std::max(masterVol - volumeStep, 0);
+    post(CMD_MASTER_VOLUME, DRUM_1, masterVol);
 }
 
 int PlaybackEngine::getVolume(drumID_t drum) {
@@ -92,40 +292,374 @@ int PlaybackEngine::getVolume() {
     return masterVol;
 }
 
+void PlaybackEngine::setPan(drumID_t drum, int pan) {
+    pans[drum] = std::max(std::min(pan, 100), -100);
+    post(CMD_DRUM_PAN, drum, pans[drum]);
+}
+
+int PlaybackEngine::getPan(drumID_t drum) {
+    return pans[drum];
+}
+
+void PlaybackEngine::setDirectOuts(bool on) {
+    directOuts = on;
+    post(CMD_DIRECT_OUTS, DRUM_1, on);
+}
+
+bool PlaybackEngine::getDirectOuts() {
+    return directOuts;
+}
+
 sampleSourceStatus_t PlaybackEngine::loadBank(int bank, sampleSourceType_t type) {
-    sampleSourceStatus_t status, retStat;
-    retStat = SOURCE_READY;
+    std::shared_ptr<const DrumBank> b;
+
+    sampleSourceStatus_t status = buildBank(bank, type, b);
+    if (status != SOURCE_READY) return status;
+
+    // Publish a copy; the cached bank shares its sources and samples
+    publish(new DrumBank(*b));
+    return SOURCE_READY;
+}
+
+void PlaybackEngine::requestBank(int bank, sampleSourceType_t type) {
+    {
+        std::lock_guard<std::mutex> lock(loaderMutex);
+        requestedBank = bank;
+        requestedType = type;
+        requestPending = true;
+        loading = true;
+    }
+    loaderCond.notify_one();
+}
 
-    for(int i = 0; i < NUM_DRUMS; i++) {
-        status = setSource((drumID_t)i, bank, type);
-        if (status != SOURCE_READY) retStat = status;
+void PlaybackEngine::preloadAround(int bank, sampleSourceType_t type) {
+    {
+        std::lock_guard<std::mutex> lock(loaderMutex);
+        preloadBank = bank;
+        preloadType = type;
+        preloadPending = true;
     }
+    loaderCond.notify_one();
+}
+
+void PlaybackEngine::setSampleFormat(sampleFormat_t format) {
+    if (sampleFormat.exchange(format) != format) reload();
+}
+
+sampleFormat_t PlaybackEngine::getSampleFormat() {
+    return sampleFormat;
+}
+
+void PlaybackEngine::setStreamThreshold(float seconds) {
+    seconds = std::max(seconds, 0.f);
+
+    // The new bank can stream from its first trigger, and the I/O thread
+    // only runs while streaming is on
+    if (seconds > 0.f) streamer.start();
+    if (streamThreshold.exchange(seconds) != seconds) reload();
+    if (seconds == 0.f) streamer.stop();
+}
+
+float PlaybackEngine::getStreamThreshold() {
+    return streamThreshold;
+}
+
+DiskStreamer& PlaybackEngine::getStreamer() {
+    return streamer;
+}
+
+BankCache& PlaybackEngine::getBankCache() {
+    return cache;
+}
+
+bool PlaybackEngine::isLoading() {
+    return loading;
+}
 
-    return retStat;
+sampleSourceStatus_t PlaybackEngine::getLoadStatus() {
+    return loadStatus;
+}
+
+int PlaybackEngine::getBank() {
+    std::lock_guard<std::mutex> lock(bankMutex);
+    DrumBank* b = bank.load();
+    return b ? b->id : -1;
 }
 
 sampleSourceStatus_t PlaybackEngine::setSource(drumID_t drum, int bank, sampleSourceType_t type) {
-    sampleSourceStatus_t status;
+    std::shared_ptr<SampleSource> source = makeSource(drum, bank, type);
+    if (!source) return SOURCE_ERROR;
 
-    switch (type) {
-        case SOURCE_GENERALISED:
-        default:
-            status = SOURCE_ERROR;
-            break;
-        
-        case SOURCE_PREGENERATED:
-            sources[drum].reset(new AudioClip(library.getFilepath(drum, bank, type)));
-            status = sources[drum]->getStatus();
-            break;
+    sampleSourceStatus_t status = source->getStatus();
+    if (status != SOURCE_READY) return status;
+
+    // Copy the current bank, replacing one drum
+    std::unique_ptr<DrumBank> b(new DrumBank());
+    {
+        std::lock_guard<std::mutex> lock(bankMutex);
+        DrumBank* current = this->bank.load();
+        if (current) *b = *current;
+        else b->id = bank;
     }
+    b->sources[drum] = source;
+    b->data[drum] = source->getData();
 
+    publish(b.release());
     return status;
 }
 
 sampleSourceStatus_t PlaybackEngine::getSourceStatus(drumID_t drum) {
-    return sources[drum]->getStatus();
+    std::lock_guard<std::mutex> lock(bankMutex);
+    DrumBank* b = bank.load();
+    if (!b || !b->sources[drum]) return SOURCE_ERROR;
+    return b->sources[drum]->getStatus();
 }
 
 sampleSourceType_t PlaybackEngine::getSourceType(drumID_t drum) {
-    return sources[drum]->getType();
-}
\ No newline at end of file
+    std::lock_guard<std::mutex> lock(bankMutex);
+    DrumBank* b = bank.load();
+    if (!b || !b->sources[drum]) return SOURCE_PREGENERATED;
+    return b->sources[drum]->getType();
+}
+
+void PlaybackEngine::collect() {
+    std::lock_guard<std::mutex> lock(bankMutex);
+    uint64_t period = numPeriods.load();
+
+    // Free banks the audio thread has finished with, keeping their samples
+    // until no voice is playing them
+    for (int i = 0; i < retiredBanks.size();) {
+        if (period >= retiredBanks[i].period) {
+            DrumBank* b = retiredBanks[i].bank;
+            for (int j = 0; j < NUM_DRUMS; j++) {
+                if (b->data[j]) retiredData.push_back(b->data[j]);
+            }
+            delete b;
+            retiredBanks.erase(retiredBanks.begin() + i);
+        } else {
+            i++;
+        }
+    }
+
+    // Release samples held by nothing else
+    for (int i = 0; i < retiredData.size();) {
+        if (retiredData[i].use_count() == 1) {
+            retiredData.erase(retiredData.begin() + i);
+        } else {
+            i++;
+        }
+    }
+}
+
+sampleSourceStatus_t PlaybackEngine::buildBank(int bank, sampleSourceType_t type, std::shared_ptr<const DrumBank>& out) {
+    out = cache.find(bank, type);
+    if (out) return SOURCE_READY;
+
+    std::shared_ptr<DrumBank> b = std::make_shared<DrumBank>();
+    b->id = bank;
+
+    // Build the whole bank before anything can see it
+    for (int i = 0; i < NUM_DRUMS; i++) {
+        b->sources[i] = makeSource((drumID_t)i, bank, type);
+        if (!b->sources[i]) return SOURCE_ERROR;
+
+        sampleSourceStatus_t status = b->sources[i]->getStatus();
+        if (status != SOURCE_READY) return status;
+
+        b->data[i] = b->sources[i]->getData();
+    }
+
+    cache.insert(b, type);
+    out = b;
+    return SOURCE_READY;
+}
+
+std::shared_ptr<SampleSource> PlaybackEngine::makeSource(drumID_t drum, int bank, sampleSourceType_t type) {
+    switch (type) {
+        case SOURCE_PREGENERATED:
+            if (streamThreshold > 0.f) {
+                return std::make_shared<StreamedClip>(library.getFilepath(drum, bank, type), sampleRate.load(),
+                    sampleFormat.load(), (int)(streamThreshold * sampleRate.load()));
+            }
+            return std::make_shared<AudioClip>(library.getFilepath(drum, bank, type), sampleRate.load(), sampleFormat.load());
+
+        case SOURCE_GENERALISED:
+        default:
+            return nullptr;
+    }
+}
+
+void PlaybackEngine::reload() {
+    cache.clear();
+
+    int id;
+    sampleSourceType_t type = SOURCE_PREGENERATED;
+    {
+        std::lock_guard<std::mutex> lock(bankMutex);
+        DrumBank* b = bank.load();
+        if (!b) return;
+
+        id = b->id;
+        if (b->sources[DRUM_1]) type = b->sources[DRUM_1]->getType();
+    }
+
+    requestBank(id, type);
+}
+
+void PlaybackEngine::publish(DrumBank* b) {
+    std::lock_guard<std::mutex> lock(bankMutex);
+
+    DrumBank* old = bank.exchange(b);
+    if (!old) return;
+
+    // A period in progress may still be reading the old bank; once the
+    // period count moves past this value it cannot be
+    RetiredBank r;
+    r.bank = old;
+    r.period = numPeriods.load() + 1;
+    retiredBanks.push_back(r);
+}
+
+void PlaybackEngine::loaderLoop() {
+    blockSignals();
+
+    std::unique_lock<std::mutex> lock(loaderMutex);
+    std::shared_ptr<const DrumBank> b;
+
+    while (loaderRunning) {
+        loaderCond.wait_for(lock, std::chrono::milliseconds(collectInterval),
+            [this] { return requestPending || preloadPending || !loaderRunning; });
+
+        if (requestPending) {
+            int id = requestedBank;
+            sampleSourceType_t t = requestedType;
+            requestPending = false;
+
+            // Load without holding the lock so new requests are not blocked
+            lock.unlock();
+            loadStatus = loadBank(id, t);
+            lock.lock();
+
+            if (!requestPending) loading = false;
+
+            // Get the neighbours ready for the next step
+            preloadBank = id;
+            preloadType = t;
+            preloadPending = true;
+        }
+
+        // Preload one neighbour at a time so requests are served promptly
+        if (preloadPending && !requestPending) {
+            int id = preloadBank;
+            sampleSourceType_t t = preloadType;
+            preloadPending = false;
+
+            lock.unlock();
+            if (!cache.contains(id + 1, t)) buildBank(id + 1, t, b);
+            lock.lock();
+
+            if (!requestPending && id > 0) {
+                lock.unlock();
+                if (!cache.contains(id - 1, t)) buildBank(id - 1, t, b);
+                lock.lock();
+            }
+            b = nullptr;
+        }
+
+        lock.unlock();
+        collect();
+        lock.lock();
+    }
+}
+
+void PlaybackEngine::setStealPolicy(voiceStealPolicy_t policy) {
+    stealPolicy = policy;
+    post(CMD_STEAL_POLICY, DRUM_1, policy);
+}
+
+voiceStealPolicy_t PlaybackEngine::getStealPolicy() {
+    return stealPolicy;
+}
+
+int PlaybackEngine::getNumVoices() {
+    return voices.size();
+}
+
+int PlaybackEngine::getNumActiveVoices() {
+    return numActiveVoices.load(std::memory_order_relaxed);
+}
+
+uint64_t PlaybackEngine::getFrameTime() {
+    return frameTime.load(std::memory_order_acquire);
+}
+
+LatencyStats& PlaybackEngine::getLatencyStats() {
+    return latency;
+}
+
+void PlaybackEngine::post(playbackCommandType_t type, drumID_t drum, int value, uint64_t inputTime) {
+    PlaybackCommand cmd;
+    cmd.type = type;
+    cmd.drum = drum;
+    cmd.value = value;
+    cmd.frame = getFrameTime();
+    cmd.time = monotonicTime();
+    cmd.inputTime = inputTime;
+
+    // If the queue is full the audio thread has stalled; drop the command
+    commands.push(cmd);
+}
+
+void PlaybackEngine::applyCommands() {
+    PlaybackCommand cmd;
+
+    while (commands.pop(cmd)) {
+        switch (cmd.type) {
+            case CMD_TRIGGER:
+                startDrum(cmd.drum, cmd.value);
+                measure(cmd);
+                break;
+
+            case CMD_UNTRIGGER:
+                voices.stop(cmd.drum);
+                break;
+
+            case CMD_DRUM_VOLUME:
+                rtVolumes[cmd.drum] = cmd.value;
+                break;
+
+            case CMD_MASTER_VOLUME:
+                rtMasterVol = cmd.value;
+                break;
+
+            case CMD_STEAL_POLICY:
+                voices.setStealPolicy((voiceStealPolicy_t)cmd.value);
+                break;
+
+            case CMD_DRUM_PAN:
+                rtPans[cmd.drum] = cmd.value / 100.f;
+                break;
+
+            case CMD_DIRECT_OUTS:
+                rtDirectOuts = cmd.value != 0;
+                break;
+        }
+    }
+}
+
+void PlaybackEngine::startDrum(drumID_t drum, int velocity) {
+    if (!rtBank) return;
+    voices.start(drum, rtBank->data[drum], (float)velocity / MAX_VELOCITY);
+    isTriggered[drum] = true;
+}
+
+void PlaybackEngine::measure(const PlaybackCommand& cmd) {
+    // Commands start at the top of the period, so play at the output time
+    if (rtOutputTime == 0) return;
+
+    latency.triggerToOutput.record((int64_t)(rtOutputTime - cmd.time));
+    if (cmd.inputTime) {
+        latency.inputToTrigger.record((int64_t)(cmd.time - cmd.inputTime));
+        latency.inputToOutput.record((int64_t)(rtOutputTime - cmd.inputTime));
+    }
+}
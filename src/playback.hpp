@@ -5,31 +5,183 @@
 #include <vector>
 #include <memory>
 #include <array>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <cstdint>
 
 #include "defs.hpp"
 #include "audio.hpp"
 #include "sampleSource.hpp"
 #include "audioLibrary.hpp"
+#include "commandQueue.hpp"
+#include "voice.hpp"
+#include "diskStream.hpp"
+#include "bankCache.hpp"
+#include "latency.hpp"
 
 namespace drumpi {
 namespace audio {
 
+/*! Command passed from a control thread to the audio thread. */
+struct PlaybackCommand {
+    /*! Type of command. */
+    playbackCommandType_t type;
+    /*! Drum affected by the command, if any. */
+    drumID_t drum;
+    /*! Command argument, e.g. a volume. */
+    int value;
+    /*! Engine frame time at which the command was issued. */
+    uint64_t frame;
+    /*! Monotonic time in ns at which the command was issued. */
+    uint64_t time;
+    /*! Monotonic time in ns of the input event behind the command, or 0. */
+    uint64_t inputTime;
+};
+
+/*! A drum trigger placed at a frame offset within a period. */
+struct ScheduledEvent {
+    /*! Frame offset of the trigger from the start of the period. */
+    int offset;
+    /*! Drum to trigger. */
+    drumID_t drum;
+    /*! Velocity of the trigger, from 1 to \ref MAX_VELOCITY. */
+    uint8_t velocity;
+};
+
+/*! Fixed-capacity list of \ref ScheduledEvent objects.
+Filled by an \ref EventScheduler on the audio thread, so never allocates. */
+class EventList {
+    public:
+        /*! Constructor. */
+        EventList();
+
+        /*! Adds an event to the list.
+        \param offset frame offset of the trigger within the period.
+        \param drum \ref drumID_t of the drum to trigger.
+        \param velocity velocity of the trigger, from 1 to \ref MAX_VELOCITY.
+        \return `false` if the list is full and the event was dropped. */
+        bool add(int offset, drumID_t drum, int velocity = MAX_VELOCITY);
+
+        /*! Returns the number of events in the list.
+        \return number of events. */
+        int size();
+
+        /*! Returns the event at the given index.
+        \param i index of the event.
+        \return the event. */
+        const ScheduledEvent& operator[](int i);
+
+        /*! Removes all events from the list. */
+        void clear();
+
+        /*! Sorts the events into ascending offset order.
+        Stable, so events at the same offset keep the order they were added. */
+        void sort();
+
+        /*! Maximum number of events per period. */
+        static const int capacity = 256;
+
+    private:
+        /*! Event storage. */
+        std::array<ScheduledEvent, capacity> events;
+        /*! Number of events in use. */
+        int numEvents;
+};
+
+/*! Abstract class for objects that place triggers in audio time.
+A scheduler registered with a \ref PlaybackEngine is asked for its events at
+the start of each period, and the engine starts each drum at the exact frame
+requested. */
+class EventScheduler {
+    public:
+        /*! Called on the audio thread at the start of each period.
+        Must not allocate, lock or block.
+        \param frame engine frame time of the first frame of the period.
+        \param nFrames number of frames in the period.
+        \param sampleRate engine sample rate in Hz.
+        \param events list to add triggers falling within the period to. */
+        virtual void schedule(uint64_t frame, int nFrames, int sampleRate, EventList& events) = 0;
+};
+
 /*! Sample handling class.
 Manages audio clips for sending to output.
-An instance of this class is used as the callback class for the \ref JackClient. */
+An instance of this class is used as the callback class for the \ref JackClient.
+
+Control methods (\ref trigger, \ref volumeUp etc.) may be called from any
+thread. They post commands to a lock-free queue that the audio thread drains
+at the top of each period, so the mix never sees a half-applied change.
+
+Recently used banks are kept in a \ref BankCache, and the loader thread
+preloads the banks either side of each requested bank, so stepping through
+banks rarely touches the disk. Banks are swapped in with a single atomic
+pointer store. A replaced bank is
+retired, and only freed once the audio thread has finished a period without
+it and no voice still plays its samples, so a bank change never frees memory
+the audio thread is reading, nor makes it free any. */
 class PlaybackEngine : public AudioCallback {
     public:
-        /*! Constructor. */
-        PlaybackEngine();
+        /*! Constructor.
+        \param numVoices number of voices to preallocate. */
+        PlaybackEngine(int numVoices = PlaybackEngine::defNumVoices);
+
+        /*! Destructor.
+        Stops the loader thread and frees all banks. */
+        ~PlaybackEngine();
 
         /*! Retrieves samples.
+        Allocates; intended for testing and offline use. The real-time path
+        is \ref render.
         \param nSamples number of samples to return.
         \return a buffer of samples. */
-        std::vector<sample_t> getSamples(int nSamples) override;
+        std::vector<sample_t> getSamples(int nSamples);
+
+        /*! Mixes the active drums straight into the output buffers.
+        The main mix is stereo: mono drums are panned across the first two
+        buffers and the channels of a multichannel drum alternate between
+        them. With one buffer the mix is folded down to mono. Further
+        buffers repeat the main pair, even ones the left and odd ones the
+        right. With direct outputs on, and at least \ref numDirectOuts
+        buffers, drum `d` is instead written, unpanned and without the master
+        volume, to buffers `2 + 2d` and `3 + 2d`, and any buffers past those
+        are silent.
+        Voices mix straight from shared sample data, so this never allocates.
+        Volume and pan changes are ramped over a few milliseconds.
+        \param outs array of output buffers, each of length nFrames.
+        \param nOuts number of output buffers.
+        \param nFrames number of frames to write to each buffer. */
+        void render(sample_t* const* outs, int nOuts, int nFrames) override;
+
+        /*! Sets the sample rate used for scheduling and loading.
+        Samples are resampled to this rate as they load. If it changes the
+        bank cache is emptied and the current bank reloaded.
+        \param sampleRate server sample rate in Hz.
+        \param bufferSize server period size in frames. */
+        void prepare(int sampleRate, int bufferSize) override;
+
+        /*! Records when the period about to be rendered will be played.
+        \param ns `CLOCK_MONOTONIC` time in nanoseconds. */
+        void setOutputTime(uint64_t ns) override;
+
+        /*! Returns the sample rate used for scheduling.
+        \return sample rate in Hz. */
+        int getSampleRate();
+
+        /*! Sets the \ref EventScheduler asked for triggers each period.
+        Waits for the audio thread to finish with the old scheduler, so it
+        may be destroyed once this returns. Not to be called from the audio
+        thread. Pass `nullptr` to remove the scheduler.
+        \param s pointer to the scheduler, or `nullptr`. */
+        void setScheduler(EventScheduler* s);
 
         /*! Adds the specified drum to the output stream.
-        \param drum \ref drumID_t of the drum to add. */
-        void trigger(drumID_t drum);
+        \param drum \ref drumID_t of the drum to add.
+        \param inputTime monotonic time in ns of the input event causing the
+        trigger, if known, for latency measurement.
+        \param velocity velocity of the hit, from 1 to \ref MAX_VELOCITY,
+        scaling the drum's gain in proportion. */
+        void trigger(drumID_t drum, uint64_t inputTime = 0, int velocity = MAX_VELOCITY);
 
         /*! Removes the specified drum sample from the output.
         \param drum \ref drumID_t of the drum to remove. */
@@ -63,47 +215,337 @@ class PlaybackEngine : public AudioCallback {
         \return current master volume. */
         int getVolume();
 
+        /*! Sets the pan position of the passed drum.
+        \param drum \ref drumID_t of the drum to be affected.
+        \param pan pan position, from -100 (left) to 100 (right). */
+        void setPan(drumID_t drum, int pan);
+
+        /*! Returns the pan position of the passed drum.
+        \param drum \ref drumID_t of the drum to query.
+        \return pan position, from -100 (left) to 100 (right). */
+        int getPan(drumID_t drum);
+
+        /*! Turns the per-drum direct outputs on or off.
+        See \ref render for the output layout.
+        \param on `true` to write each drum to its own pair of outputs. */
+        void setDirectOuts(bool on);
+
+        /*! Checks if the per-drum direct outputs are on.
+        \return `true` if on. */
+        bool getDirectOuts();
+
+        /*! Number of output buffers used with direct outputs on: a main
+        stereo pair, then a stereo pair per drum. */
+        static const int numDirectOuts = 2 + 2 * NUM_DRUMS;
+
         /*! Loads a bank of drums of a homogenous \ref sampleSourceType_t.
-        Equivalent to calling \ref setSource for each drum with the given arguments.
+        Takes the bank from the cache, or loads it on the calling thread,
+        then publishes the bank if every drum
+        loaded. On failure the current bank stays in place.
         \param bank ID of the bank of drums to load from.
-        \param type \ref sampleSourceType_t of sources to load. */
+        \param type \ref sampleSourceType_t of sources to load.
+        \return \ref SOURCE_READY if the bank was published. */
         sampleSourceStatus_t loadBank(int bank, sampleSourceType_t type);
 
+        /*! Requests a bank be loaded on the loader thread.
+        Returns immediately. If several requests arrive while a bank is
+        loading only the latest is loaded.
+        \param bank ID of the bank of drums to load from.
+        \param type \ref sampleSourceType_t of sources to load. */
+        void requestBank(int bank, sampleSourceType_t type);
+
+        /*! Requests the banks either side of a bank be preloaded into the
+        cache on the loader thread.
+        \param bank ID of the bank whose neighbours to preload.
+        \param type \ref sampleSourceType_t of sources to load. */
+        void preloadAround(int bank, sampleSourceType_t type);
+
+        /*! Sets the format samples are stored in from now on.
+        \ref SAMPLE_INT16 halves the memory of each bank. If the format
+        changes the bank cache is emptied and the current bank reloaded.
+        \param format \ref sampleFormat_t to load samples in. */
+        void setSampleFormat(sampleFormat_t format);
+
+        /*! Returns the format samples are loaded in.
+        \return \ref sampleFormat_t of loaded samples. */
+        sampleFormat_t getSampleFormat();
+
+        /*! Sets how long a sample must be to be streamed from disk.
+        Longer samples keep only their head in memory and are played
+        through the engine's \ref DiskStreamer, whose I/O thread only runs
+        while the threshold is above 0. If the threshold changes the bank
+        cache is emptied and the current bank reloaded.
+        \param seconds length in seconds, or 0 to load every sample whole. */
+        void setStreamThreshold(float seconds);
+
+        /*! Returns how long a sample must be to be streamed from disk.
+        \return length in seconds, or 0 if streaming is off. */
+        float getStreamThreshold();
+
+        /*! Returns the streamer playing long samples from disk.
+        \return reference to the streamer. */
+        DiskStreamer& getStreamer();
+
+        /*! Returns the cache of recently used banks.
+        \return reference to the cache. */
+        BankCache& getBankCache();
+
+        /*! Checks if the loader thread has a bank request outstanding.
+        \return `true` while a requested bank is loading. */
+        bool isLoading();
+
+        /*! Returns the status of the last bank load to finish.
+        \return \ref SOURCE_READY if it was published. */
+        sampleSourceStatus_t getLoadStatus();
+
+        /*! Returns the ID of the bank currently playing.
+        \return bank ID, or -1 if no bank is loaded. */
+        int getBank();
+
         /*! Sets the source for the specified drum.
+        Publishes a copy of the current bank with the one drum replaced, if
+        it loaded.
         \param drum \ref drumID_t of the drum to set the type for.
         \param bank ID of the bank of drums to load from.
         \param type \ref sampleSourceType_t of source to load. */
         sampleSourceStatus_t setSource(drumID_t drum, int bank, sampleSourceType_t type);
 
         /*! Returns the source \ref sampleSourceStatus_t of the given drum.
-        \return source status. */
+        \return source status, or \ref SOURCE_ERROR if no bank is loaded. */
         sampleSourceStatus_t getSourceStatus(drumID_t drum);
 
         /*! Returns the source \ref sampleSourceType_t for the given drum. 
         \return source type. */
         sampleSourceType_t getSourceType(drumID_t drum);
+
+        /*! Frees retired banks and samples that are no longer in use.
+        Called periodically by the loader thread. */
+        void collect();
+
+        /*! Sets the policy for choosing a voice to reuse when all voices are
+        playing.
+        \param policy \ref voiceStealPolicy_t to use. */
+        void setStealPolicy(voiceStealPolicy_t policy);
+
+        /*! Returns the voice stealing policy.
+        \return current \ref voiceStealPolicy_t. */
+        voiceStealPolicy_t getStealPolicy();
+
+        /*! Returns the number of voices in the pool.
+        \return number of voices. */
+        int getNumVoices();
+
+        /*! Returns the number of voices playing at the end of the last period.
+        \return number of active voices. */
+        int getNumActiveVoices();
+
+        /*! Returns the number of frames rendered since construction.
+        \return engine frame time. */
+        uint64_t getFrameTime();
+
+        /*! Returns the key-to-sound latency measurements.
+        Triggers are measured when the audio thread starts them, if the
+        backend reports output times.
+        \return reference to the measurements. */
+        LatencyStats& getLatencyStats();
     
     private:
         /*! Library manager for the audio sources. */
         AudioLibrary library;
 
-        /*! Buffer of samples to allow rapid transfer to Jack. */
+        /*! Buffer of samples returned by \ref getSamples. */
         std::vector<sample_t> buffer;
 
-        /*! \ref SampleSource object pointers. */
-        std::array<std::unique_ptr<SampleSource>, NUM_DRUMS> sources;
-        /*! Switches to store whether each source is being played. */
-        std::array<bool, NUM_DRUMS> isTriggered;
+        /*! Refills the voices' ring buffers for streamed samples. Declared
+        before \ref voices, which hold its slots. */
+        DiskStreamer streamer;
+        /*! Voices playing the drums' sample data. Audio thread only. */
+        VoicePool voices;
+        /*! Linear gain of each drum, including master volume. Audio thread
+        only. */
+        std::array<float, NUM_DRUMS> gains;
+        /*! Linear gain of each drum on its direct outputs. Audio thread
+        only. */
+        std::array<float, NUM_DRUMS> directGains;
+        /*! Number of voices playing at the end of the last period. */
+        std::atomic<int> numActiveVoices;
+        /*! Voice stealing policy. Control side. */
+        voiceStealPolicy_t stealPolicy;
+
+        /*! Default number of voices. */
+        static const int defNumVoices = 32;
+
+        /*! Builds a bank, or takes it from the cache. Control side.
+        \param bank ID of the bank of drums to load from.
+        \param type \ref sampleSourceType_t of sources to load.
+        \param out set to the bank on success.
+        \return \ref SOURCE_READY if every drum loaded. */
+        sampleSourceStatus_t buildBank(int bank, sampleSourceType_t type, std::shared_ptr<const DrumBank>& out);
+
+        /*! Loads a source. Control side.
+        \param drum \ref drumID_t of the drum to load.
+        \param bank ID of the bank of drums to load from.
+        \param type \ref sampleSourceType_t of source to load.
+        \return the source, or `nullptr` for unsupported types. */
+        std::shared_ptr<SampleSource> makeSource(drumID_t drum, int bank, sampleSourceType_t type);
+
+        /*! Empties the bank cache and requests the current bank again, after
+        a change to how samples are loaded. Control side. */
+        void reload();
 
-        /*! Current master volume as a percentage. */
+        /*! Publishes a bank to the audio thread and retires the old one.
+        \param b bank to publish, owned by the engine from now on. */
+        void publish(DrumBank* b);
+
+        /*! Loader thread loop. */
+        void loaderLoop();
+
+        /*! Recently used banks. */
+        BankCache cache;
+
+        /*! Bank played by the audio thread. */
+        std::atomic<DrumBank*> bank;
+        /*! Bank in use for the current period. Audio thread only. */
+        DrumBank* rtBank;
+        /*! Number of periods rendered, used to tell when the audio thread can
+        no longer be reading a retired bank. */
+        std::atomic<uint64_t> numPeriods;
+
+        /*! A bank waiting to be freed. */
+        struct RetiredBank {
+            /*! The bank. */
+            DrumBank* bank;
+            /*! Value of \ref numPeriods after which the bank is unused. */
+            uint64_t period;
+        };
+        /*! Banks replaced but possibly still read by the audio thread. */
+        std::vector<RetiredBank> retiredBanks;
+        /*! Sample data of freed banks, released once no voice holds it, so
+        the audio thread never drops the last reference. */
+        std::vector<std::shared_ptr<const SampleData>> retiredData;
+        /*! Guards \ref bank against concurrent publishers and control side
+        readers, and the retire lists. Never taken by the audio thread. */
+        std::mutex bankMutex;
+
+        /*! Bank loader thread. */
+        std::thread loader;
+        /*! Guards the loader request. */
+        std::mutex loaderMutex;
+        /*! Wakes the loader thread. */
+        std::condition_variable loaderCond;
+        /*! Requested bank ID. */
+        int requestedBank;
+        /*! Requested source type. */
+        sampleSourceType_t requestedType;
+        /*! Whether a request is waiting for the loader thread. */
+        bool requestPending;
+        /*! Bank whose neighbours are to be preloaded. */
+        int preloadBank;
+        /*! Source type of the banks to preload. */
+        sampleSourceType_t preloadType;
+        /*! Whether a preload is waiting for the loader thread. */
+        bool preloadPending;
+        /*! Whether the loader thread should keep running. */
+        bool loaderRunning;
+        /*! Whether a request is waiting or loading. */
+        std::atomic<bool> loading;
+        /*! Status of the last finished bank load. */
+        std::atomic<sampleSourceStatus_t> loadStatus;
+
+        /*! Interval between collections of retired banks, in milliseconds. */
+        const int collectInterval = 100;
+        /*! Switches to store whether each source is being played.
+        Set by control threads on trigger and cleared by the audio thread when
+        a source finishes, for display purposes. */
+        std::array<std::atomic<bool>, NUM_DRUMS> isTriggered;
+
+        /*! Current master volume as a percentage. Control side. */
         int masterVol;
-        /*! Current drum volumes as percentages. */
+        /*! Current drum volumes as percentages. Control side. */
         std::array<int, NUM_DRUMS> volumes;
 
+        /*! Queue of commands waiting to be applied by the audio thread. */
+        CommandQueue<PlaybackCommand, 256> commands;
+
+        /*! Posts a command to the audio thread.
+        \param type \ref playbackCommandType_t of the command.
+        \param drum \ref drumID_t of the drum affected.
+        \param value command argument.
+        \param inputTime monotonic time in ns of the input event behind the
+        command, or 0. */
+        void post(playbackCommandType_t type, drumID_t drum = DRUM_1, int value = 0, uint64_t inputTime = 0);
+
+        /*! Records the latency of a trigger command. Audio thread only.
+        \param cmd the trigger command. */
+        void measure(const PlaybackCommand& cmd);
+
+        /*! Applies all queued commands. Audio thread only. */
+        void applyCommands();
+
+        /*! Starts playback of a drum from the beginning. Audio thread only.
+        \param drum \ref drumID_t of the drum to start.
+        \param velocity velocity of the hit, from 1 to \ref MAX_VELOCITY. */
+        void startDrum(drumID_t drum, int velocity = MAX_VELOCITY);
+
+        /*! Mixes the playing drums into a section of the outputs.
+        Audio thread only.
+        \param outs output buffers, of which the first `nMain` take the main
+        mix and the rest, if any, are the direct outputs.
+        \param nMain number of main outputs.
+        \param nOuts total number of outputs.
+        \param offset frame offset of the section.
+        \param nFrames number of frames to mix. */
+        void mix(sample_t* const* outs, int nMain, int nOuts, int offset, int nFrames);
+
+        /*! Scheduler for sample-accurate triggers, if any. */
+        std::atomic<EventScheduler*> scheduler;
+        /*! Incremented before and after the audio thread uses the
+        \ref scheduler, so odd while it may be using it. */
+        std::atomic<uint64_t> schedulerUses;
+        /*! Events placed in the current period by the \ref scheduler. */
+        EventList events;
+
+        /*! Sample rate used for scheduling and loading. */
+        std::atomic<int> sampleRate;
+        /*! Format samples are loaded in. */
+        std::atomic<sampleFormat_t> sampleFormat;
+        /*! Length in seconds above which samples are streamed, or 0. */
+        std::atomic<float> streamThreshold;
+        /*! Default sample rate, as used by `start_jackd.bash`. */
+        const int sampleRateDef = 48000;
+
+        /*! Master volume as a percentage. Audio side. */
+        int rtMasterVol;
+        /*! Drum volumes as percentages. Audio side. */
+        std::array<int, NUM_DRUMS> rtVolumes;
+
+        /*! Drum pan positions, -100 to 100. Control side. */
+        std::array<int, NUM_DRUMS> pans;
+        /*! Drum pan positions, -1 to 1. Audio side. */
+        std::array<float, NUM_DRUMS> rtPans;
+        /*! Whether direct outputs are on. Control side. */
+        bool directOuts;
+        /*! Whether direct outputs are on. Audio side. */
+        bool rtDirectOuts;
+
+        /*! Number of frames rendered since construction. */
+        std::atomic<uint64_t> frameTime;
+
+        /*! Time at which the current period will be played, or 0 if the
+        backend does not say. Audio thread only. */
+        uint64_t rtOutputTime;
+        /*! Key-to-sound latency measurements. */
+        LatencyStats latency;
+
         /*! Lookup table for exponential volume control.
         Indexed as a percentage. */
         std::array<float, 101> volumeTable;
 
+        /*! Time constant of the voices' volume and pan smoothing, in
+        seconds. Master and drum volumes reach each voice as one gain, so
+        both are smoothed. */
+        const float smoothingTime = 0.005f;
+
         /*! Default master volume. */
         const int masterVolDef = 75;
         /*! Default drum volume. */
@@ -0,0 +1,172 @@
+/**
+ * @file render.cxx
+ * @brief Offline renderer for the DrumPi.
+ *
+ * Runs the \ref drumpi::audio::PlaybackEngine and \ref drumpi::Sequencer
+ * against a virtual frame clock, as fast as the CPU allows, and writes the
+ * result to a wave file. Doubles as a deterministic regression harness and a
+ * throughput benchmark.
+ */
+#include "playback.hpp"
+#include "sequencer.hpp"
+
+#include <AudioFile.h>
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <memory>
+
+using namespace drumpi;
+
+/*! Prints the command line usage. */
+void printUsage(const char* name) {
+    std::cout << "Usage: " << name << " <pattern file> <output.wav> [options]" << std::endl;
+    std::cout << "  --bank N     drum bank to load (default 1)" << std::endl;
+    std::cout << "  --bpm N      step rate in BPM (default 480)" << std::endl;
+    std::cout << "  --bars N     number of times to play the pattern (default 4)" << std::endl;
+    std::cout << "  --rate N     sample rate in Hz (default 48000)" << std::endl;
+    std::cout << "  --block N    frames per period (default 128)" << std::endl;
+    std::cout << "  --tail N     seconds to render after the last step (default 2)" << std::endl;
+}
+
+/*! Loads a pattern file into a new \ref Sequencer.
+Each non-comment line is a drum, each character a step: 'x' is a hit.
+\param filepath path of the pattern file.
+\return the loaded \ref Sequencer, or `nullptr` on error. */
+std::shared_ptr<Sequencer> loadPattern(std::string filepath) {
+    std::ifstream file(filepath);
+    std::vector<std::string> lines;
+    std::string line;
+    int numSteps = 0;
+
+    if (!file.is_open()) return nullptr;
+
+    while (std::getline(file, line) && lines.size() < NUM_DRUMS) {
+        if (line.empty() || line[0] == '#') continue;
+        lines.push_back(line);
+        if (line.size() > numSteps) numSteps = line.size();
+    }
+
+    if (numSteps == 0) return nullptr;
+
+    std::shared_ptr<Sequencer> seq(new Sequencer(numSteps));
+    for (int i = 0; i < lines.size(); i++) { // For each drum...
+        for (int j = 0; j < lines[i].size(); j++) { // For each step...
+            if (lines[i][j] == 'x' || lines[i][j] == 'X') seq->add((drumID_t)i, j);
+        }
+    }
+
+    return seq;
+}
+
+/*! Main function of execution. */
+int main(int argc, char* argv[]) {
+    int bank = 1;
+    int bpm = 480;
+    int bars = 4;
+    int sampleRate = 48000;
+    int blockSize = 128;
+    double tail = 2.;
+
+    if (argc < 3) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    std::string patternPath = argv[1];
+    std::string outputPath = argv[2];
+
+    for (int i = 3; i + 1 < argc; i += 2) {
+        std::string opt = argv[i];
+        if (opt == "--bank") bank = atoi(argv[i + 1]);
+        else if (opt == "--bpm") bpm = atoi(argv[i + 1]);
+        else if (opt == "--bars") bars = atoi(argv[i + 1]);
+        else if (opt == "--rate") sampleRate = atoi(argv[i + 1]);
+        else if (opt == "--block") blockSize = atoi(argv[i + 1]);
+        else if (opt == "--tail") tail = atof(argv[i + 1]);
+        else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (bpm <= 0 || bars <= 0 || sampleRate <= 0 || blockSize <= 0) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    std::shared_ptr<Sequencer> seq = loadPattern(patternPath);
+    if (!seq) {
+        std::cerr << "Could not load pattern " << patternPath << std::endl;
+        return 1;
+    }
+
+    audio::PlaybackEngine engine;
+    engine.prepare(sampleRate, blockSize);
+    if (engine.loadBank(bank, audio::SOURCE_PREGENERATED) != audio::SOURCE_READY) {
+        std::cerr << "Could not load bank " << bank << std::endl;
+        return 1;
+    }
+
+    SequencerScheduler scheduler(seq);
+    scheduler.setRateBPM(bpm);
+    engine.setScheduler(&scheduler);
+
+    // Frames until the step after the last one, plus the decay tail
+    int numSteps = seq->getNumSteps() * bars;
+    uint64_t seqFrames = (uint64_t)std::ceil((numSteps - 1) * (60. * sampleRate / bpm)) + 1;
+    uint64_t totalFrames = seqFrames + (uint64_t)(tail * sampleRate);
+
+    AudioFile<audio::sample_t> file;
+    file.setSampleRate(sampleRate);
+    file.setBitDepth(16);
+    file.setAudioBufferSize(2, totalFrames);
+
+    std::vector<audio::sample_t> l(blockSize), r(blockSize);
+    audio::sample_t* outs[2] = {l.data(), r.data()};
+
+    scheduler.start();
+
+    auto start = std::chrono::steady_clock::now();
+
+    uint64_t pos = 0;
+    while (pos < totalFrames) {
+        int n = (int)std::min<uint64_t>(blockSize, totalFrames - pos);
+
+        // End a period exactly where the sequence ends, then stop the
+        // sequencer, so the output does not depend on the block size
+        if (pos < seqFrames) {
+            n = (int)std::min<uint64_t>(n, seqFrames - pos);
+        } else {
+            scheduler.stop();
+        }
+
+        engine.render(outs, 2, n);
+
+        std::copy(l.begin(), l.begin() + n, file.samples[0].begin() + pos);
+        std::copy(r.begin(), r.begin() + n, file.samples[1].begin() + pos);
+        pos += n;
+    }
+
+    auto end = std::chrono::steady_clock::now();
+
+    engine.setScheduler(nullptr);
+
+    double rendered = double(totalFrames) / sampleRate;
+    double wall = std::chrono::duration<double>(end - start).count();
+
+    if (!file.save(outputPath)) {
+        std::cerr << "Could not write " << outputPath << std::endl;
+        return 1;
+    }
+
+    std::cout << "Rendered " << rendered << " s of audio in " << wall << " s ("
+        << rendered / wall << "x real time)" << std::endl;
+
+    return 0;
+}
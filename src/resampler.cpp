@@ -0,0 +1,99 @@
+// File: resampler.cpp
+#include "resampler.hpp"
+
+#include <cmath>
+#include <algorithm>
+
+using namespace drumpi;
+using namespace audio;
+
+Resampler::Resampler(int fromRate, int toRate, int halfTaps) {
+    // Reduce the ratio
+    long long a = fromRate, b = toRate;
+    while (b != 0) {
+        long long r = a % b;
+        a = b;
+        b = r;
+    }
+    long long g = a;
+    up = toRate / g;
+    down = fromRate / g;
+    numPhases = (int)std::min<long long>(up, (long long)maxPhases);
+
+    // Lower the cutoff to the output Nyquist frequency when downsampling,
+    // widening the filter to keep the same transition band
+    double cutoff = std::min(1.0, double(up) / double(down));
+    int half = (int)std::ceil(halfTaps / cutoff);
+    numTaps = 2 * half;
+
+    table.resize((size_t)numPhases * numTaps);
+    double norm = besselI0(kaiserBeta);
+
+    for (int p = 0; p < numPhases; p++) {
+        double frac = double(p) / numPhases;
+        float* row = table.data() + (size_t)p * numTaps;
+        double sum = 0.0;
+
+        for (int k = 0; k < numTaps; k++) {
+            // Distance of the tap from the output position, in input samples
+            double t = k - half + 1 - frac;
+            double x = t / half;
+            double w = (std::fabs(x) < 1.0) ? besselI0(kaiserBeta * std::sqrt(1.0 - x * x)) / norm : 0.0;
+            double s = (t == 0.0) ? 1.0 : std::sin(M_PI * cutoff * t) / (M_PI * cutoff * t);
+            row[k] = (float)(cutoff * s * w);
+            sum += row[k];
+        }
+
+        // Unity gain at DC for every phase
+        for (int k = 0; k < numTaps; k++) row[k] = (float)(row[k] / sum);
+    }
+}
+
+std::vector<sample_t> Resampler::process(const sample_t* in, int nIn) {
+    int nOut = getOutputLength(nIn);
+    std::vector<sample_t> out(nOut);
+    int half = numTaps / 2;
+
+    for (int n = 0; n < nOut; n++) {
+        // Position of the output sample in input samples, as ip + rem/up
+        long long pos = (long long)n * down;
+        long long ip = pos / up;
+        long long phase = ((pos % up) * numPhases + up / 2) / up;
+        if (phase == numPhases) {
+            ip++;
+            phase = 0;
+        }
+
+        const float* row = table.data() + (size_t)phase * numTaps;
+        long long first = ip - half + 1;
+        int k0 = (int)std::max<long long>(0, -first);
+        int k1 = (int)std::min<long long>(numTaps, nIn - first);
+
+        float acc = 0.f;
+        for (int k = k0; k < k1; k++) {
+            acc += in[first + k] * row[k];
+        }
+        out[n] = acc;
+    }
+
+    return out;
+}
+
+int Resampler::getOutputLength(int nIn) {
+    return (int)(((long long)nIn * up + down - 1) / down);
+}
+
+double Resampler::besselI0(double x) {
+    // Power series; converges quickly for the window's arguments
+    double sum = 1.0;
+    double term = 1.0;
+    double q = x * x / 4.0;
+
+    for (int k = 1; k < 64; k++) {
+        term *= q / (double(k) * k);
+        sum += term;
+        if (term < sum * 1e-12) break;
+    }
+
+    return sum;
+}
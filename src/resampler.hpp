@@ -0,0 +1,70 @@
+// File: resampler.hpp
+#ifndef DRUMPI_RESAMPLER_H
+#define DRUMPI_RESAMPLER_H
+
+#include <vector>
+
+#include "defs.hpp"
+
+namespace drumpi {
+namespace audio {
+
+/*! Offline sample rate converter.
+A polyphase windowed-sinc filter: the conversion ratio is reduced to `L/M`,
+and a Kaiser-windowed sinc is tabulated at `L` fractional phases, so each
+output sample is a dot product with one row of the table. When downsampling
+the cutoff is lowered to the output Nyquist frequency to avoid aliasing.
+
+Intended for load time, not the audio thread: it allocates. */
+class Resampler {
+    public:
+        /*! Constructor.
+        Builds the filter table.
+        \param fromRate sample rate of the input in Hz.
+        \param toRate sample rate of the output in Hz.
+        \param halfTaps filter half-length in input samples at unity ratio.
+        Default 32. */
+        Resampler(int fromRate, int toRate, int halfTaps = Resampler::defHalfTaps);
+
+        /*! Resamples a block of samples.
+        The input is treated as silent outside the block.
+        \param in input samples.
+        \param nIn number of input samples.
+        \return the resampled samples. */
+        std::vector<sample_t> process(const sample_t* in, int nIn);
+
+        /*! Returns the number of output samples for an input length.
+        \param nIn number of input samples.
+        \return number of output samples. */
+        int getOutputLength(int nIn);
+
+    private:
+        /*! Evaluates the zeroth-order modified Bessel function of the first
+        kind, for the Kaiser window.
+        \param x argument.
+        \return I0(x). */
+        static double besselI0(double x);
+
+        /*! Interpolation factor of the reduced ratio. */
+        long long up;
+        /*! Decimation factor of the reduced ratio. */
+        long long down;
+        /*! Number of phases in the table. */
+        int numPhases;
+        /*! Number of taps in each phase. */
+        int numTaps;
+        /*! Filter table, `numPhases` rows of `numTaps` coefficients. */
+        std::vector<float> table;
+
+        /*! Default filter half-length. */
+        static const int defHalfTaps = 32;
+        /*! Largest number of phases tabulated; finer phases are rounded. */
+        static const int maxPhases = 1024;
+        /*! Kaiser window shape, about 90 dB of stopband rejection. */
+        const double kaiserBeta = 9.0;
+};
+
+} // namespace audio
+} // namespace drumpi
+
+#endif // define DRUMPI_RESAMPLER_H
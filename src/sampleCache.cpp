@@ -0,0 +1,335 @@
+// File: sampleCache.cpp
+#include "sampleCache.hpp"
+
+#include <cstring>
+#include <cstdio>
+#include <cmath>
+#include <algorithm>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstddef>
+
+#include <AudioFile.h>
+
+#include "resampler.hpp"
+
+using namespace drumpi;
+using namespace audio;
+
+// MappedFile class
+
+MappedFile::MappedFile() {
+    base = nullptr;
+    length = 0;
+}
+
+MappedFile::~MappedFile() {
+    if (base) munmap(base, length);
+}
+
+bool MappedFile::open(std::string filepath) {
+    struct stat st;
+
+    int fd = ::open(filepath.data(), O_RDONLY);
+    if (fd < 0) return false;
+
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return false;
+    }
+
+    void* p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) return false;
+
+    base = p;
+    length = st.st_size;
+    return true;
+}
+
+const void* MappedFile::data() const {
+    return base;
+}
+
+size_t MappedFile::size() const {
+    return length;
+}
+
+
+// SampleCache class
+
+const std::string SampleCache::extension = ".dpc";
+
+SampleCache::SampleCache() {
+}
+
+std::shared_ptr<const SampleData> SampleCache::load(std::string filepath, int sampleRate, sampleFormat_t format) {
+    struct stat st;
+
+    if (stat(filepath.data(), &st) != 0) return nullptr;
+
+    uint64_t sourceSize = st.st_size;
+    int64_t sourceMtime = (int64_t)st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+    std::string cachePath = getCachePath(filepath, sampleRate, format);
+
+    // Fast path: map an up-to-date cache file
+    std::shared_ptr<const SampleData> data = map(cachePath, filepath, sampleRate, format, sourceSize, sourceMtime);
+    if (data) return data;
+
+    // Slow path: decode the source file
+    std::vector<sample_t> samples;
+    int numChannels;
+    if (!build(filepath, cachePath, sampleRate, format, sourceSize, sourceMtime, samples, numChannels)) return nullptr;
+
+    // Map the new cache file, or fall back to the decoded samples if the
+    // cache could not be written, e.g. on a read-only filesystem
+    data = map(cachePath, filepath, sampleRate, format, sourceSize, sourceMtime);
+    if (data) return data;
+
+    if (format == SAMPLE_INT16) return std::make_shared<const SampleData>(toInt16(samples), sampleRate, numChannels);
+    return std::make_shared<const SampleData>(std::move(samples), sampleRate, numChannels);
+}
+
+std::string SampleCache::prepare(std::string filepath, int sampleRate, sampleFormat_t format) {
+    struct stat st;
+    _SampleCacheHeader header;
+
+    if (stat(filepath.data(), &st) != 0) return "";
+
+    uint64_t sourceSize = st.st_size;
+    int64_t sourceMtime = (int64_t)st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+    std::string cachePath = getCachePath(filepath, sampleRate, format);
+
+    if (check(cachePath, filepath, sampleRate, format, sourceSize, sourceMtime, header)) return cachePath;
+
+    std::vector<sample_t> samples;
+    int numChannels;
+    if (!build(filepath, cachePath, sampleRate, format, sourceSize, sourceMtime, samples, numChannels)) return "";
+
+    if (check(cachePath, filepath, sampleRate, format, sourceSize, sourceMtime, header)) return cachePath;
+    return "";
+}
+
+bool SampleCache::build(std::string filepath, std::string cachePath, int& sampleRate, sampleFormat_t format,
+    uint64_t sourceSize, int64_t sourceMtime, std::vector<sample_t>& samples, int& numChannels)
+{
+    uint64_t sourceHash;
+    if (!hashFile(filepath, sourceHash)) return false;
+
+    int fileRate;
+    if (!decode(filepath, samples, fileRate, numChannels)) return false;
+    if (sampleRate <= 0) sampleRate = fileRate;
+
+    // Resample each channel if needed
+    if (sampleRate != fileRate) {
+        int numFrames = samples.size() / numChannels;
+        Resampler resampler(fileRate, sampleRate);
+        std::vector<sample_t> resampled;
+        resampled.reserve((size_t)resampler.getOutputLength(numFrames) * numChannels);
+        for (int c = 0; c < numChannels; c++) {
+            std::vector<sample_t> channel = resampler.process(samples.data() + (size_t)c * numFrames, numFrames);
+            resampled.insert(resampled.end(), channel.begin(), channel.end());
+        }
+        samples.swap(resampled);
+    }
+
+    // A failed write only costs the fast path next time
+    write(cachePath, samples, sampleRate, numChannels, format, sourceSize, sourceMtime, sourceHash);
+    return true;
+}
+
+bool SampleCache::decode(std::string filepath, std::vector<sample_t>& samples, int& sampleRate, int& numChannels) {
+    // WAV files are decoded in bulk straight into the planar layout
+    WaveReader<sample_t> reader;
+    if (reader.open(filepath)) {
+        int numFrames = reader.getNumSamplesPerChannel();
+        sampleRate = reader.getSampleRate();
+        numChannels = reader.getNumChannels();
+
+        samples.resize((size_t)numFrames * numChannels);
+        std::vector<sample_t*> channels(numChannels);
+        for (int c = 0; c < numChannels; c++) channels[c] = samples.data() + (size_t)c * numFrames;
+
+        // A truncated file keeps the frames that were there
+        int n = reader.read(channels.data(), numFrames);
+        if (n < numFrames) {
+            for (int c = 1; c < numChannels; c++) {
+                std::copy(channels[c], channels[c] + n, samples.data() + (size_t)c * n);
+            }
+            samples.resize((size_t)n * numChannels);
+        }
+
+        return sampleRate > 0;
+    }
+
+    // Anything else, e.g. AIFF
+    AudioFile<sample_t> file;
+    file.shouldLogErrorsToConsole(false);
+    if (!file.load(filepath)) return false;
+
+    sampleRate = file.getSampleRate();
+    numChannels = file.getNumChannels();
+    if (numChannels < 1 || sampleRate <= 0) return false;
+
+    int numFrames = file.getNumSamplesPerChannel();
+    samples.clear();
+    samples.reserve((size_t)numFrames * numChannels);
+    for (int c = 0; c < numChannels; c++) {
+        samples.insert(samples.end(), file.samples[c].begin(), file.samples[c].begin() + numFrames);
+    }
+
+    return true;
+}
+
+std::string SampleCache::getCachePath(std::string filepath, int sampleRate, sampleFormat_t format) {
+    if (sampleRate > 0) filepath += "." + std::to_string(sampleRate);
+    if (format == SAMPLE_INT16) filepath += ".i16";
+    return filepath + extension;
+}
+
+std::vector<int16_t> SampleCache::toInt16(const std::vector<sample_t>& samples) {
+    std::vector<int16_t> v(samples.size());
+    for (size_t i = 0; i < samples.size(); i++) {
+        float x = std::round(samples[i] * 32768.f);
+        v[i] = (int16_t)std::max(-32768.f, std::min(32767.f, x));
+    }
+    return v;
+}
+
+bool SampleCache::hashFile(std::string filepath, uint64_t& hash) {
+    MappedFile file;
+    if (!file.open(filepath)) return false;
+
+    const unsigned char* p = static_cast<const unsigned char*>(file.data());
+    hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < file.size(); i++) {
+        hash = (hash ^ p[i]) * 1099511628211ULL;
+    }
+
+    return true;
+}
+
+bool SampleCache::readHeader(int fd, _SampleCacheHeader& header) {
+    struct stat st;
+
+    if (fstat(fd, &st) != 0) return false;
+    if (pread(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header)) return false;
+
+    // Reject foreign, outdated or truncated files
+    if (memcmp(header.magic, "DPSC", 4) != 0) return false;
+    if (header.version != version || header.numChannels < 1 || header.sampleRate == 0) return false;
+    if (header.format != SAMPLE_FLOAT32 && header.format != SAMPLE_INT16) return false;
+
+    size_t sampleSize = (header.format == SAMPLE_INT16) ? sizeof(int16_t) : sizeof(sample_t);
+    return header.dataOffset + (header.numFrames * header.numChannels * sampleSize) <= (uint64_t)st.st_size;
+}
+
+bool SampleCache::check(std::string cachePath, std::string filepath, int sampleRate, sampleFormat_t format,
+    uint64_t sourceSize, int64_t sourceMtime, _SampleCacheHeader& header)
+{
+    int fd = ::open(cachePath.data(), O_RDONLY);
+    if (fd < 0) return false;
+
+    bool ok = readHeader(fd, header);
+    close(fd);
+
+    // Reject files for another rate or format, or a stale source
+    if (!ok || header.format != (uint32_t)format) return false;
+    if (sampleRate > 0 && header.sampleRate != (uint32_t)sampleRate) return false;
+    if (header.sourceSize != sourceSize) return false;
+
+    // Touched but perhaps not changed: compare contents, and restamp the
+    // cache so the next load takes the fast path
+    if (header.sourceMtime != sourceMtime) {
+        uint64_t sourceHash;
+        if (!hashFile(filepath, sourceHash) || sourceHash != header.sourceHash) return false;
+
+        fd = ::open(cachePath.data(), O_WRONLY);
+        if (fd >= 0) {
+            pwrite(fd, &sourceMtime, sizeof(sourceMtime), offsetof(_SampleCacheHeader, sourceMtime));
+            close(fd);
+        }
+        header.sourceMtime = sourceMtime;
+    }
+
+    return true;
+}
+
+std::shared_ptr<const SampleData> SampleCache::map(std::string cachePath, std::string filepath, int sampleRate,
+    sampleFormat_t format, uint64_t sourceSize, int64_t sourceMtime)
+{
+    std::shared_ptr<MappedFile> file(new MappedFile());
+    _SampleCacheHeader header;
+
+    if (!check(cachePath, filepath, sampleRate, format, sourceSize, sourceMtime, header)) return nullptr;
+    if (!file->open(cachePath)) return nullptr;
+
+    // Replaced between the check and the mapping
+    size_t sampleSize = (format == SAMPLE_INT16) ? sizeof(int16_t) : sizeof(sample_t);
+    if (file->size() < sizeof(header)) return nullptr;
+    if (memcmp(file->data(), &header, offsetof(_SampleCacheHeader, sourceMtime)) != 0) return nullptr;
+    if (header.dataOffset + (header.numFrames * header.numChannels * sampleSize) > file->size()) return nullptr;
+
+    const char* samples = static_cast<const char*>(file->data()) + header.dataOffset;
+
+    if (format == SAMPLE_INT16) {
+        return std::make_shared<const SampleData>(reinterpret_cast<const int16_t*>(samples),
+            (int)header.numFrames, (int)header.sampleRate, file, (int)header.numChannels);
+    }
+    return std::make_shared<const SampleData>(reinterpret_cast<const sample_t*>(samples),
+        (int)header.numFrames, (int)header.sampleRate, file, (int)header.numChannels);
+}
+
+bool SampleCache::write(std::string cachePath, const std::vector<sample_t>& samples, int sampleRate,
+    int numChannels, sampleFormat_t format, uint64_t sourceSize, int64_t sourceMtime, uint64_t sourceHash)
+{
+    _SampleCacheHeader header;
+    std::vector<char> padding(dataOffset - sizeof(header), 0);
+    std::string tempPath = cachePath + ".XXXXXX";
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "DPSC", 4);
+    header.version = version;
+    header.format = format;
+    header.numChannels = numChannels;
+    header.sampleRate = sampleRate;
+    header.dataOffset = dataOffset;
+    header.numFrames = samples.size() / numChannels;
+    header.sourceSize = sourceSize;
+    header.sourceMtime = sourceMtime;
+    header.sourceHash = sourceHash;
+
+    // A temporary file of its own, so concurrent writers of the same cache,
+    // in this process or another, never truncate or rename each other's
+    int fd = mkstemp(&tempPath[0]);
+    if (fd < 0) return false;
+    fchmod(fd, 0644);
+
+    FILE* f = fdopen(fd, "wb");
+    if (!f) {
+        close(fd);
+        remove(tempPath.data());
+        return false;
+    }
+
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1;
+    ok = ok && fwrite(padding.data(), 1, padding.size(), f) == padding.size();
+    if (format == SAMPLE_INT16) {
+        std::vector<int16_t> v = toInt16(samples);
+        ok = ok && fwrite(v.data(), sizeof(int16_t), v.size(), f) == v.size();
+    } else if (!samples.empty()) {
+        ok = ok && fwrite(samples.data(), sizeof(sample_t), samples.size(), f) == samples.size();
+    }
+    ok = (fclose(f) == 0) && ok;
+
+    if (!ok || rename(tempPath.data(), cachePath.data()) != 0) {
+        remove(tempPath.data());
+        return false;
+    }
+
+    return true;
+}
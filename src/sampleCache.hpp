@@ -0,0 +1,219 @@
+// File: sampleCache.hpp
+#ifndef DRUMPI_SAMPLE_CACHE_H
+#define DRUMPI_SAMPLE_CACHE_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+
+#include "defs.hpp"
+#include "sampleSource.hpp"
+
+namespace drumpi {
+namespace audio {
+
+/*! Header of a sample cache file.
+Followed, at `dataOffset`, by `numFrames * numChannels` raw samples, one
+channel after another. */
+struct _SampleCacheHeader {
+    /*! File identifier, "DPSC". */
+    char magic[4];
+    /*! Cache format version. */
+    uint32_t version;
+    /*! Sample format, a \ref sampleFormat_t. */
+    uint32_t format;
+    /*! Number of planar channels. */
+    uint32_t numChannels;
+    /*! Sample rate in Hz. */
+    uint32_t sampleRate;
+    /*! Byte offset of the sample data from the start of the file. */
+    uint32_t dataOffset;
+    /*! Number of frames. */
+    uint64_t numFrames;
+    /*! Size of the source file when the cache was made. */
+    uint64_t sourceSize;
+    /*! Modification time of the source file when the cache was made, in ns. */
+    int64_t sourceMtime;
+    /*! FNV-1a hash of the source file's contents. */
+    uint64_t sourceHash;
+};
+
+
+/*! Read-only memory mapping of a file.
+The mapping is released when the object is destroyed. */
+class MappedFile {
+    public:
+        /*! Constructor. */
+        MappedFile();
+
+        /*! Destructor.
+        Unmaps the file. */
+        ~MappedFile();
+
+        /*! Maps the whole of a file into memory.
+        Page tables are populated up front, so reading the mapping does not
+        fault on the audio thread.
+        \param filepath path of the file to map.
+        \return `true` on success. */
+        bool open(std::string filepath);
+
+        /*! Returns the start of the mapping.
+        \return pointer to the mapped bytes, or `nullptr` if not mapped. */
+        const void* data() const;
+
+        /*! Returns the size of the mapping.
+        \return size in bytes. */
+        size_t size() const;
+
+    private:
+        /*! Start of the mapping. */
+        void* base;
+        /*! Size of the mapping in bytes. */
+        size_t length;
+};
+
+
+/*! Cache of pre-decoded samples.
+The first load of a wave file decodes it and writes the raw samples, with a
+small header, to a cache file beside it. Later loads `mmap` the cache file
+instead of parsing the wave file, so switching banks is nearly free.
+
+Samples can be loaded at a target sample rate, in which case they are
+resampled with a \ref Resampler before caching, and in a target
+\ref sampleFormat_t. Each rate and format has its own cache file. A cache file is keyed by the hash of its source's contents: a
+change of size rebuilds it, and a change of modification time alone, e.g.
+from copying the bank, only re-hashes the source. */
+class SampleCache {
+    public:
+        /*! Constructor. */
+        SampleCache();
+
+        /*! Loads all channels of an audio file, via the cache.
+        \param filepath path of the audio file.
+        \param sampleRate rate in Hz to resample to, or 0 to keep the file's
+        own rate.
+        \param format \ref sampleFormat_t to store the samples in.
+        \return the sample data, or `nullptr` if the file could not be loaded. */
+        std::shared_ptr<const SampleData> load(std::string filepath, int sampleRate = 0,
+            sampleFormat_t format = SAMPLE_FLOAT32);
+
+        /*! Makes sure an up-to-date cache file exists for an audio file,
+        without mapping it, e.g. so it can be streamed by a \ref DiskStream.
+        \param filepath path of the audio file.
+        \param sampleRate rate in Hz to resample to, or 0 to keep the file's
+        own rate.
+        \param format \ref sampleFormat_t to store the samples in.
+        \return path of the cache file, or an empty string if it could not be
+        made. */
+        std::string prepare(std::string filepath, int sampleRate = 0, sampleFormat_t format = SAMPLE_FLOAT32);
+
+        /*! Returns the path of the cache file for an audio file.
+        \param filepath path of the audio file.
+        \param sampleRate target sample rate in Hz, or 0 for the file's own.
+        \param format \ref sampleFormat_t of the cached samples.
+        \return path of the cache file. */
+        std::string getCachePath(std::string filepath, int sampleRate = 0, sampleFormat_t format = SAMPLE_FLOAT32);
+
+        /*! Hashes the contents of a file.
+        \param filepath path of the file.
+        \param hash set to the 64-bit FNV-1a hash of the file.
+        \return `true` on success. */
+        static bool hashFile(std::string filepath, uint64_t& hash);
+
+        /*! Reads and checks the header of an open cache file.
+        \param fd file descriptor of the cache file.
+        \param header set to the header.
+        \return `true` if the file is a cache file of the current version
+        holding all the samples its header describes. */
+        static bool readHeader(int fd, _SampleCacheHeader& header);
+
+        /*! Extension appended to audio file paths to name their cache files. */
+        static const std::string extension;
+
+    private:
+        /*! Checks a cache file is valid for its source.
+        If only the modification time differs the source is hashed, and a
+        matching cache file is restamped rather than rebuilt.
+        \param cachePath path of the cache file.
+        \param filepath path of the source file.
+        \param sampleRate required sample rate in Hz, or 0 for any.
+        \param format required \ref sampleFormat_t.
+        \param sourceSize current size of the source file.
+        \param sourceMtime current modification time of the source file in ns.
+        \param header set to the cache file's header.
+        \return `true` if the cache file can be used. */
+        bool check(std::string cachePath, std::string filepath, int sampleRate, sampleFormat_t format,
+            uint64_t sourceSize, int64_t sourceMtime, _SampleCacheHeader& header);
+
+        /*! Maps a cache file, if \ref check passes.
+        \param cachePath path of the cache file.
+        \param filepath path of the source file.
+        \param sampleRate required sample rate in Hz, or 0 for any.
+        \param format required \ref sampleFormat_t.
+        \param sourceSize current size of the source file.
+        \param sourceMtime current modification time of the source file in ns.
+        \return the sample data, or `nullptr` if missing or stale. */
+        std::shared_ptr<const SampleData> map(std::string cachePath, std::string filepath, int sampleRate,
+            sampleFormat_t format, uint64_t sourceSize, int64_t sourceMtime);
+
+        /*! Decodes and resamples an audio file, and writes its cache file.
+        The samples are returned even if the cache file could not be
+        written.
+        \param filepath path of the audio file.
+        \param cachePath path of the cache file.
+        \param sampleRate rate in Hz to resample to, or 0 to keep the file's
+        own; set to the rate of the samples.
+        \param format \ref sampleFormat_t to write the samples in.
+        \param sourceSize size of the source file.
+        \param sourceMtime modification time of the source file in ns.
+        \param samples set to the planar samples.
+        \param numChannels set to the number of channels.
+        \return `true` if the file was decoded. */
+        bool build(std::string filepath, std::string cachePath, int& sampleRate, sampleFormat_t format,
+            uint64_t sourceSize, int64_t sourceMtime, std::vector<sample_t>& samples, int& numChannels);
+
+        /*! Writes a cache file.
+        Written to a uniquely named temporary file and renamed into place, so
+        a reader never sees a partial file and concurrent writers never
+        clash.
+        \param cachePath path of the cache file.
+        \param samples planar samples to write.
+        \param sampleRate sample rate of the samples in Hz.
+        \param numChannels number of channels in samples.
+        \param format \ref sampleFormat_t to write the samples in.
+        \param sourceSize size of the source file.
+        \param sourceMtime modification time of the source file in ns.
+        \param sourceHash hash of the source file.
+        \return `true` on success. */
+        bool write(std::string cachePath, const std::vector<sample_t>& samples, int sampleRate,
+            int numChannels, sampleFormat_t format, uint64_t sourceSize, int64_t sourceMtime, uint64_t sourceHash);
+
+        /*! Decodes an audio file into planar channels.
+        WAV files are decoded in bulk by a `WaveReader`; other formats fall
+        back to `AudioFile`.
+        \param filepath path of the audio file.
+        \param samples set to the planar samples.
+        \param sampleRate set to the file's sample rate in Hz.
+        \param numChannels set to the file's number of channels.
+        \return `true` on success. */
+        static bool decode(std::string filepath, std::vector<sample_t>& samples, int& sampleRate, int& numChannels);
+
+        /*! Converts samples to 16-bit integers, rounding and clipping.
+        \param samples samples to convert.
+        \return the converted samples. */
+        static std::vector<int16_t> toInt16(const std::vector<sample_t>& samples);
+
+        /*! Current cache format version.
+        Version 1 files held only the first channel, version 2 had no source
+        hash. */
+        static const uint32_t version = 3;
+        /*! Byte offset of the sample data in cache files. */
+        static const uint32_t dataOffset = 64;
+};
+
+} // namespace audio
+} // namespace drumpi
+
+#endif // define DRUMPI_SAMPLE_CACHE_H
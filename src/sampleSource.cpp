@@ -1,15 +1,143 @@
 #include "sampleSource.hpp"
 
-#include <AudioFile.h>
+#include <algorithm>
+
+#include "sampleCache.hpp"
+#include "diskStream.hpp"
+#include "mixer.hpp"
 
 using namespace drumpi;
 using namespace audio;
 
+// class SampleData
+
+SampleData::SampleData(std::vector<sample_t>&& samples, int sampleRate, int numChannels,
+    std::shared_ptr<const DiskStream> stream) :
+    storage(std::move(samples)), stream(stream)
+{
+    this->samples = storage.data();
+    format = SAMPLE_FLOAT32;
+    this->numChannels = std::max(numChannels, 1);
+    numFrames = storage.size() / this->numChannels;
+    this->sampleRate = sampleRate;
+}
+
+SampleData::SampleData(const sample_t* samples, int numFrames, int sampleRate, std::shared_ptr<const void> owner,
+    int numChannels) :
+    owner(owner)
+{
+    this->samples = samples;
+    format = SAMPLE_FLOAT32;
+    this->numFrames = numFrames;
+    this->numChannels = std::max(numChannels, 1);
+    this->sampleRate = sampleRate;
+}
+
+SampleData::SampleData(std::vector<int16_t>&& samples, int sampleRate, int numChannels) :
+    storageInt16(std::move(samples))
+{
+    this->samples = storageInt16.data();
+    format = SAMPLE_INT16;
+    this->numChannels = std::max(numChannels, 1);
+    numFrames = storageInt16.size() / this->numChannels;
+    this->sampleRate = sampleRate;
+}
+
+SampleData::SampleData(const int16_t* samples, int numFrames, int sampleRate, std::shared_ptr<const void> owner,
+    int numChannels) :
+    owner(owner)
+{
+    this->samples = samples;
+    format = SAMPLE_INT16;
+    this->numFrames = numFrames;
+    this->numChannels = std::max(numChannels, 1);
+    this->sampleRate = sampleRate;
+}
+
+const sample_t* SampleData::data() const {
+    return channel(0);
+}
+
+const sample_t* SampleData::channel(int c) const {
+    if (format != SAMPLE_FLOAT32) return nullptr;
+    return static_cast<const sample_t*>(samples) + (size_t)c * numFrames;
+}
+
+const int16_t* SampleData::channelInt16(int c) const {
+    if (format != SAMPLE_INT16) return nullptr;
+    return static_cast<const int16_t*>(samples) + (size_t)c * numFrames;
+}
+
+void SampleData::mix(int c, int offset, sample_t* out, float gain, int n, float step) const {
+    if (step != 0.f) {
+        if (format == SAMPLE_INT16) {
+            mixGainRampInt16(out, channelInt16(c) + offset, gain * int16Scale, step * int16Scale, n);
+        } else {
+            mixGainRamp(out, channel(c) + offset, gain, step, n);
+        }
+    } else if (format == SAMPLE_INT16) {
+        mixGainInt16(out, channelInt16(c) + offset, gain * int16Scale, n);
+    } else {
+        mixGain(out, channel(c) + offset, gain, n);
+    }
+}
+
+void SampleData::read(int c, int offset, sample_t* out, int n) const {
+    if (format == SAMPLE_INT16) {
+        const int16_t* in = channelInt16(c) + offset;
+        for (int i = 0; i < n; i++) out[i] = in[i] * int16Scale;
+    } else {
+        std::copy(channel(c) + offset, channel(c) + offset + n, out);
+    }
+}
+
+sampleFormat_t SampleData::getFormat() const {
+    return format;
+}
+
+size_t SampleData::getBytes() const {
+    size_t sampleSize = (format == SAMPLE_INT16) ? sizeof(int16_t) : sizeof(sample_t);
+    return (size_t)numFrames * numChannels * sampleSize;
+}
+
+int SampleData::size() const {
+    return numFrames;
+}
+
+int SampleData::getLength() const {
+    return stream ? stream->getNumFrames() : numFrames;
+}
+
+const std::shared_ptr<const DiskStream>& SampleData::getStream() const {
+    return stream;
+}
+
+int SampleData::getNumChannels() const {
+    return numChannels;
+}
+
+bool SampleData::empty() const {
+    return numFrames == 0;
+}
+
+int SampleData::getSampleRate() const {
+    return sampleRate;
+}
+
+
+// class SampleSource
+
 SampleSource::SampleSource() {
     status = SOURCE_ERROR;
     type = SOURCE_GENERALISED;
 }
 
+std::vector<sample_t> SampleSource::getSamples(int nSamples) {
+    std::vector<sample_t> b(nSamples);
+    render(b.data(), nSamples);
+    return b;
+}
+
 sampleSourceStatus_t SampleSource::getStatus() {
     return status;
 }
@@ -21,17 +149,17 @@ sampleSourceType_t SampleSource::getType() {
 
 // class AudioClip
 
-AudioClip::AudioClip(std::string filepath) {
+AudioClip::AudioClip(std::string filepath, int sampleRate, sampleFormat_t format) {
     type = SOURCE_PREGENERATED;
+    numSamples = 0;
+    this->sampleRate = sampleRate;
+    this->format = format;
     loadFile(filepath);
 
-    numSamples = clip.size();
-
     reset();
 }
 
-std::vector<sample_t> AudioClip::getSamples(int nSamples) {
-    std::vector<sample_t> b(nSamples);
+void AudioClip::render(sample_t* buffer, int nSamples) {
     bool endFlag = false;
     // Number of samples to copy
     int nSamplesCopy = nSamples;
@@ -43,20 +171,16 @@ std::vector<sample_t> AudioClip::getSamples(int nSamples) {
         nSamplesCopy = samplesRemaining();
     }
 
-    for (int i = 0; i < nSamplesCopy; i++) {
-        // Copy samples from clip
-        b[i] = clip[playhead];
-        playhead++;
+    // Copy samples from clip
+    if (nSamplesCopy > 0) {
+        clip->read(0, playhead, buffer, nSamplesCopy);
+        playhead += nSamplesCopy;
     }
 
-    for (int i = nSamplesCopy; i < nSamples; i++) {
-        // Fill remainder of buffer with zeros if needed
-        b[i] = 0.f;
-    }
+    // Fill remainder of buffer with zeros if needed
+    std::fill(buffer + nSamplesCopy, buffer + nSamples, 0.f);
 
     if (endFlag) status = SOURCE_FINISHED;
-
-    return b;
 }
 
 void AudioClip::reset() {
@@ -65,7 +189,7 @@ void AudioClip::reset() {
 }
 
 void AudioClip::updateStatus() {
-    if (clip.empty()) {
+    if (!clip || clip->empty()) {
         status = SOURCE_ERROR;
         return;
     }
@@ -81,32 +205,131 @@ void AudioClip::updateStatus() {
     }
 }
 
+std::shared_ptr<const SampleData> AudioClip::getData() {
+    return clip;
+}
+
 void AudioClip::hardReset() {
     loadFile(filepath);
     reset();
 }
 
 void AudioClip::loadFile(std::string filepath) {
-    AudioFile<sample_t> file;
-    bool loaded;
-    
+    SampleCache cache;
+
     this->filepath = filepath;
 
     status = SOURCE_LOADING;
 
-    file.shouldLogErrorsToConsole(false);
-    loaded = file.load(this->filepath);
+    // Decoded and resampled once, then memory-mapped from the cache
+    clip = cache.load(this->filepath, sampleRate, format);
 
-    if (!loaded) {
+    if (!clip) {
+        numSamples = 0;
         status = SOURCE_ERROR;
         return;
     }
 
-    clip = file.samples[0];
-    numSamples = clip.size();
+    numSamples = clip->size();
     status = SOURCE_READY;
 }
 
 int AudioClip::samplesRemaining() {
     return numSamples - playhead;
-}
\ No newline at end of file
+}
+
+// class StreamedClip
+
+StreamedClip::StreamedClip(std::string filepath, int sampleRate, sampleFormat_t format, int minFrames,
+    int headFrames)
+{
+    type = SOURCE_PREGENERATED;
+    this->sampleRate = sampleRate;
+    this->format = format;
+    this->minFrames = minFrames;
+    this->headFrames = std::max(headFrames, 1);
+    loadFile(filepath);
+
+    reset();
+}
+
+void StreamedClip::render(sample_t* buffer, int nSamples) {
+    int n = 0;
+
+    if (clip) {
+        int length = clip->getLength();
+        n = std::max(0, std::min(nSamples, length - playhead));
+
+        // Head from memory, the rest from disk
+        int nHead = std::max(0, std::min(n, clip->size() - playhead));
+        if (nHead > 0) clip->read(0, playhead, buffer, nHead);
+        if (n > nHead) {
+            int got = clip->getStream()->read(0, playhead + nHead, buffer + nHead, n - nHead);
+            n = nHead + got;
+        }
+        playhead += n;
+    }
+
+    std::fill(buffer + n, buffer + nSamples, 0.f);
+    status = (clip && playhead < clip->getLength()) ? SOURCE_ACTIVE : SOURCE_FINISHED;
+}
+
+void StreamedClip::reset() {
+    playhead = 0;
+    updateStatus();
+}
+
+void StreamedClip::updateStatus() {
+    if (!clip || clip->empty()) {
+        status = SOURCE_ERROR;
+    } else if (playhead == 0) {
+        status = SOURCE_READY;
+    } else if (playhead < clip->getLength()) {
+        status = SOURCE_ACTIVE;
+    } else {
+        status = SOURCE_FINISHED;
+    }
+}
+
+std::shared_ptr<const SampleData> StreamedClip::getData() {
+    return clip;
+}
+
+bool StreamedClip::isStreamed() {
+    return clip && clip->getStream();
+}
+
+void StreamedClip::loadFile(std::string filepath) {
+    SampleCache cache;
+
+    this->filepath = filepath;
+    status = SOURCE_LOADING;
+    clip.reset();
+
+    // Stream from the cache file if it can be made and the clip is long
+    std::shared_ptr<DiskStream> stream;
+    std::string cachePath = cache.prepare(filepath, sampleRate, format);
+    if (!cachePath.empty()) {
+        stream = std::make_shared<DiskStream>();
+        if (!stream->open(cachePath) || stream->getNumFrames() <= std::max(minFrames, headFrames)
+            || stream->getNumChannels() > DiskStreamer::maxChannels)
+        {
+            stream.reset();
+        }
+    }
+
+    if (!stream) {
+        clip = cache.load(filepath, sampleRate, format);
+    } else {
+        // The head is small, so kept as floats whatever the cache format
+        int numChannels = stream->getNumChannels();
+        std::vector<sample_t> head((size_t)headFrames * numChannels);
+        bool ok = true;
+        for (int c = 0; c < numChannels; c++) {
+            ok = ok && stream->read(c, 0, head.data() + (size_t)c * headFrames, headFrames) == headFrames;
+        }
+        if (ok) clip = std::make_shared<const SampleData>(std::move(head), stream->getSampleRate(), numChannels, stream);
+    }
+
+    status = clip ? SOURCE_READY : SOURCE_ERROR;
+}
@@ -4,12 +4,154 @@
 
 #include <string>
 #include <vector>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
 
 #include "defs.hpp"
 
 namespace drumpi {
 namespace audio {
 
+class DiskStream;
+
+/*! Immutable block of decoded samples.
+Shared between a source and any voices playing it, so retriggering a drum
+never copies its samples. The samples are either owned by the object or
+borrowed from another owner, such as a memory-mapped cache file.
+
+Channels are stored planar, one after another, so each channel is contiguous
+for the vectorised mix kernels. Samples are stored as floats or, to halve
+the memory of a bank, as 16-bit integers; \ref mix converts them on the
+fly.
+
+A long sample may hold only its head in memory, with the rest read from a
+\ref DiskStream as it plays. */
+class SampleData {
+    public:
+        /*! Constructor.
+        \param samples decoded planar samples, moved into the object.
+        \param sampleRate sample rate of the samples in Hz.
+        \param numChannels number of channels in samples.
+        \param stream stream of the whole sample, if samples is only its
+        head, or `nullptr`. */
+        SampleData(std::vector<sample_t>&& samples, int sampleRate, int numChannels = 1,
+            std::shared_ptr<const DiskStream> stream = nullptr);
+
+        /*! Constructor for samples held elsewhere.
+        \param samples pointer to the first sample of the first channel.
+        \param numFrames number of samples in each channel.
+        \param sampleRate sample rate of the samples in Hz.
+        \param owner object keeping the samples alive.
+        \param numChannels number of planar channels. */
+        SampleData(const sample_t* samples, int numFrames, int sampleRate, std::shared_ptr<const void> owner,
+            int numChannels = 1);
+
+        /*! Constructor for 16-bit samples.
+        \param samples planar samples, moved into the object.
+        \param sampleRate sample rate of the samples in Hz.
+        \param numChannels number of channels in samples. */
+        SampleData(std::vector<int16_t>&& samples, int sampleRate, int numChannels = 1);
+
+        /*! Constructor for 16-bit samples held elsewhere.
+        \param samples pointer to the first sample of the first channel.
+        \param numFrames number of samples in each channel.
+        \param sampleRate sample rate of the samples in Hz.
+        \param owner object keeping the samples alive.
+        \param numChannels number of planar channels. */
+        SampleData(const int16_t* samples, int numFrames, int sampleRate, std::shared_ptr<const void> owner,
+            int numChannels = 1);
+
+        /*! Returns a pointer to the first sample of the first channel.
+        \return pointer to the samples, or `nullptr` unless the format is
+        \ref SAMPLE_FLOAT32. */
+        const sample_t* data() const;
+
+        /*! Returns a pointer to the first sample of a channel.
+        \param c channel index, less than \ref getNumChannels.
+        \return pointer to the channel's samples, or `nullptr` unless the
+        format is \ref SAMPLE_FLOAT32. */
+        const sample_t* channel(int c) const;
+
+        /*! Returns a pointer to the first sample of a 16-bit channel.
+        \param c channel index, less than \ref getNumChannels.
+        \return pointer to the channel's samples, or `nullptr` unless the
+        format is \ref SAMPLE_INT16. */
+        const int16_t* channelInt16(int c) const;
+
+        /*! Adds part of a channel, scaled by a gain, into a buffer.
+        Converts 16-bit samples as it goes. Never allocates.
+        \param c channel index.
+        \param offset frame to start from.
+        \param out buffer to add to.
+        \param gain linear gain to apply to the first frame.
+        \param n number of frames.
+        \param step change in gain per frame, for a ramp. */
+        void mix(int c, int offset, sample_t* out, float gain, int n, float step = 0.f) const;
+
+        /*! Copies part of a channel into a buffer as floats.
+        \param c channel index.
+        \param offset frame to start from.
+        \param out buffer to write to.
+        \param n number of frames. */
+        void read(int c, int offset, sample_t* out, int n) const;
+
+        /*! Returns the storage format of the samples.
+        \return \ref sampleFormat_t of the samples. */
+        sampleFormat_t getFormat() const;
+
+        /*! Returns the memory taken by the samples.
+        \return size in bytes. */
+        size_t getBytes() const;
+
+        /*! Returns the number of samples in each channel held in memory.
+        \return number of frames. */
+        int size() const;
+
+        /*! Returns the length of the whole sample, including any part left
+        on disk.
+        \return number of frames. */
+        int getLength() const;
+
+        /*! Returns the stream of a sample that is not wholly in memory.
+        \return the stream, or `nullptr` if every frame is in memory. */
+        const std::shared_ptr<const DiskStream>& getStream() const;
+
+        /*! Returns the number of channels.
+        \return number of channels. */
+        int getNumChannels() const;
+
+        /*! Checks if there are no samples.
+        \return `true` if empty. */
+        bool empty() const;
+
+        /*! Returns the sample rate of the samples.
+        \return sample rate in Hz. */
+        int getSampleRate() const;
+
+    private:
+        /*! Float sample storage, if owned. */
+        std::vector<sample_t> storage;
+        /*! 16-bit sample storage, if owned. */
+        std::vector<int16_t> storageInt16;
+        /*! Owner of the samples, if borrowed. */
+        std::shared_ptr<const void> owner;
+        /*! Stream of the rest of the sample, if streamed. */
+        std::shared_ptr<const DiskStream> stream;
+
+        /*! Pointer to the first sample. */
+        const void* samples;
+        /*! Storage format of the samples. */
+        sampleFormat_t format;
+        /*! Number of samples in each channel. */
+        int numFrames;
+        /*! Number of channels. */
+        int numChannels;
+        /*! Sample rate in Hz. */
+        int sampleRate;
+};
+
+
 /*! Abstract class for sample retieval. */
 class SampleSource {
     public:
@@ -17,9 +159,16 @@ class SampleSource {
         SampleSource();
 
         /*! Returns a buffer of samples.
+        Allocates; use \ref render on the real-time thread.
         \param nSamples number of samples to be returned.
         \return a sample buffer of length nSamples. */
-        virtual std::vector<sample_t> getSamples(int nSamples) = 0;
+        std::vector<sample_t> getSamples(int nSamples);
+
+        /*! Writes samples into a caller-provided buffer.
+        Must not allocate, as it is called from the real-time thread.
+        \param buffer buffer of at least nSamples samples to write to.
+        \param nSamples number of samples to be written. */
+        virtual void render(sample_t* buffer, int nSamples) = 0;
 
         /*! Resets the source to initial conditions. */
         virtual void reset() = 0;
@@ -27,6 +176,10 @@ class SampleSource {
         /*! Updates the status of the source. */
         virtual void updateStatus() = 0;
 
+        /*! Returns the source's sample data, for sharing with voices.
+        \return pointer to the sample data, or `nullptr` if there is none. */
+        virtual std::shared_ptr<const SampleData> getData() = 0;
+
         /*! Returns the status of the source.
         \return status code of source. */
         sampleSourceStatus_t getStatus();
@@ -59,13 +212,17 @@ class SampleSourceFile : public SampleSource {
 class AudioClip : public SampleSourceFile {
     public:
         /*! Class constructor.
-        \param filepath the absolute file path of an audio file. */
-        AudioClip(std::string filepath);
+        \param filepath the absolute file path of an audio file.
+        \param sampleRate rate in Hz to resample the clip to when it is
+        loaded, or 0 to keep the file's own rate.
+        \param format \ref sampleFormat_t to store the clip in. */
+        AudioClip(std::string filepath, int sampleRate = 0, sampleFormat_t format = SAMPLE_FLOAT32);
 
-        /*! Returns a buffer of samples.
-        \param nSamples number of samples to be returned.
-        \return a sample buffer of length nSamples. */
-        std::vector<sample_t> getSamples(int nSamples) override;
+        /*! Writes samples into a caller-provided buffer.
+        Zero-pads the buffer once the end of the clip is reached.
+        \param buffer buffer of at least nSamples samples to write to.
+        \param nSamples number of samples to be written. */
+        void render(sample_t* buffer, int nSamples) override;
 
         /*! Halts playback and returns playhead to start of clip. */
         void reset() override;
@@ -73,6 +230,10 @@ class AudioClip : public SampleSourceFile {
         /*! Updates the status of the source. */
         void updateStatus() override;
 
+        /*! Returns the clip's sample data, for sharing with voices.
+        \return pointer to the sample data, or `nullptr` if loading failed. */
+        std::shared_ptr<const SampleData> getData() override;
+
         /*! Like \ref reset but the clip is completely re-loaded.
         Not recommended for real-time use, but may be useful to recover from
         errors. */
@@ -84,7 +245,12 @@ class AudioClip : public SampleSourceFile {
         void loadFile(std::string filepath) override;
 
         /*! Container for the audio clip. */
-        std::vector<sample_t> clip;
+        std::shared_ptr<const SampleData> clip;
+
+        /*! Rate the clip is resampled to, or 0 for the file's own. */
+        int sampleRate;
+        /*! Format the clip is stored in. */
+        sampleFormat_t format;
 
         /*! Number of samples in the audio clip. */
         int numSamples;
@@ -95,6 +261,68 @@ class AudioClip : public SampleSourceFile {
         int samplesRemaining();
 };
 
+
+/*! Handler class for long samples streamed from disk.
+Only the first \ref getHeadFrames frames are kept in memory; voices play
+the rest from ring buffers refilled by a \ref DiskStreamer. Samples no
+longer than the streaming threshold are loaded whole, as by \ref AudioClip. */
+class StreamedClip : public SampleSourceFile {
+    public:
+        /*! Class constructor.
+        \param filepath the absolute file path of an audio file.
+        \param sampleRate rate in Hz to resample the clip to when it is
+        loaded, or 0 to keep the file's own rate.
+        \param format \ref sampleFormat_t the clip is cached in.
+        \param minFrames clips longer than this many frames are streamed.
+        \param headFrames number of frames kept in memory when streaming. */
+        StreamedClip(std::string filepath, int sampleRate = 0, sampleFormat_t format = SAMPLE_FLOAT32,
+            int minFrames = StreamedClip::defHeadFrames, int headFrames = StreamedClip::defHeadFrames);
+
+        /*! Writes samples into a caller-provided buffer.
+        Reads the streamed part straight from disk, so is only for offline
+        use; voices play streamed clips through a \ref DiskStreamer.
+        \param buffer buffer of at least nSamples samples to write to.
+        \param nSamples number of samples to be written. */
+        void render(sample_t* buffer, int nSamples) override;
+
+        /*! Halts playback and returns playhead to start of clip. */
+        void reset() override;
+
+        /*! Updates the status of the source. */
+        void updateStatus() override;
+
+        /*! Returns the clip's sample data, for sharing with voices.
+        \return pointer to the sample data, or `nullptr` if loading failed. */
+        std::shared_ptr<const SampleData> getData() override;
+
+        /*! Checks if the clip is streamed.
+        \return `true` if only its head is in memory. */
+        bool isStreamed();
+
+        /*! Default number of frames kept in memory. */
+        static const int defHeadFrames = 8192;
+
+    private:
+        /*! Loads the specified file.
+        \param filepath file path of the file to load. */
+        void loadFile(std::string filepath) override;
+
+        /*! Head of the clip, or all of it, with the stream of the rest. */
+        std::shared_ptr<const SampleData> clip;
+
+        /*! Rate the clip is resampled to, or 0 for the file's own. */
+        int sampleRate;
+        /*! Format the clip is cached in. */
+        sampleFormat_t format;
+        /*! Shortest clip streamed, in frames. */
+        int minFrames;
+        /*! Frames kept in memory when streaming. */
+        int headFrames;
+
+        /*! The number of samples of playback elapsed. */
+        int playhead;
+};
+
 } // namespace audio
 } // namespace drumpi
 
@@ -1,8 +1,11 @@
 // File: sequencer.cpp
 
 #include <memory>
+#include <algorithm>
+#include <cmath>
 
 #include "sequencer.hpp"
+#include "song.hpp"
 
 using namespace drumpi;
 
@@ -13,51 +16,76 @@ _SequenceStep::_SequenceStep() {
 }
 
 void _SequenceStep::add(drumID_t id) {
-    switches[id] = true;
+    mask |= 1u << id;
 }
 
 void _SequenceStep::remove(drumID_t id) {
-    switches[id] = false;
+    mask &= ~(1u << id);
 }
 
 void _SequenceStep::toggle(drumID_t id) {
-    switches[id] = !switches[id];
+    mask ^= 1u << id;
 }
 
 bool _SequenceStep::isActive(drumID_t id) {
-    return switches[id];
+    return (mask >> id) & 1u;
 }
 
 int _SequenceStep::numActive() {
-    int n = 0;
-    for (int i = 0; i < switches.size(); i++) {
-        n += (int)switches[i];
-    }
-    return n;
+    return __builtin_popcount(mask);
 }
 
 std::vector<drumID_t> _SequenceStep::getActive() {
     std::vector<drumID_t> active;
-    active.reserve(NUM_DRUMS);
-    for (int i = 0; i < switches.size(); i++) {
-        if (isActive((drumID_t)i)) {
-            active.push_back((drumID_t)i);
-        }
+    active.reserve(numActive());
+    for (uint32_t m = mask; m; m &= m - 1) {
+        active.push_back((drumID_t)__builtin_ctz(m));
     }
-    active.shrink_to_fit();
     return active;
 }
 
+uint32_t _SequenceStep::getMask() {
+    return mask;
+}
+
+void _SequenceStep::setVelocity(drumID_t id, int velocity) {
+    velocities[id] = (uint8_t)std::min(std::max(velocity, 1), MAX_VELOCITY);
+}
+
+int _SequenceStep::getVelocity(drumID_t id) {
+    return velocities[id];
+}
+
+void _SequenceStep::setProbability(drumID_t id, int percent) {
+    probabilities[id] = (uint8_t)std::min(std::max(percent, 0), 100);
+}
+
+int _SequenceStep::getProbability(drumID_t id) {
+    return probabilities[id];
+}
+
+void _SequenceStep::setOffset(drumID_t id, int frames) {
+    offsets[id] = (int16_t)std::min(std::max(frames, INT16_MIN), INT16_MAX);
+}
+
+int _SequenceStep::getOffset(drumID_t id) {
+    return offsets[id];
+}
+
 void _SequenceStep::clear() {
-    for (int i = 0; i < switches.size(); i++) {
-        switches[i] = false;
-    }
+    mask = 0;
+    velocities.fill(MAX_VELOCITY);
+    probabilities.fill(100);
+    offsets.fill(0);
 }
 
 
 // Sequencer class
 
 Sequencer::Sequencer(const int numSteps) {
+    swing = 50.f;
+    setSeed(defSeed);
+    steps.resize(maxSteps);
     setNumSteps(numSteps);
     reset();
 }
@@ -82,17 +110,19 @@ std::vector<drumID_t> Sequencer::getActive() {
 }
 
 std::vector<bool> Sequencer::getSteps(drumID_t drumID) {
-    std::vector<bool> v(numSteps);
-    for (int i = 0; i < numSteps; i++) {
+    int n = numSteps;
+    std::vector<bool> v(n);
+    for (int i = 0; i < n; i++) {
         v[i] = steps[i].isActive(drumID);
     }
     return v;
 }
 
 std::vector<std::vector<bool>> Sequencer::getSequence() {
+    int n = numSteps;
     std::vector<std::vector<bool>> pattern;
-    pattern.resize(numSteps);
-    for (int i = 0; i < numSteps; i++) {
+    pattern.resize(n);
+    for (int i = 0; i < n; i++) {
         // For each _SequenceStep...
         pattern[i].resize(NUM_DRUMS);
         for (int j = 0; j < NUM_DRUMS; j++) {
@@ -103,17 +133,57 @@ std::vector<std::vector<bool>> Sequencer::getSequence() {
     return pattern;
 }
 
+uint32_t Sequencer::getMask(int step) {
+    return steps[step].getMask();
+}
+
+uint32_t Sequencer::getHits(int step) {
+    _SequenceStep& s = steps[step];
+    uint32_t hits = s.getMask();
+
+    for (uint32_t m = hits; m; m &= m - 1) {
+        drumID_t id = (drumID_t)__builtin_ctz(m);
+        int p = s.getProbability(id);
+
+        // Certain hits draw nothing, so adding one leaves the others alone
+        if (p < 100 && (int)(nextRandom() % 100) >= p) hits &= ~(1u << id);
+    }
+
+    return hits;
+}
+
+void Sequencer::setSeed(uint32_t seed) {
+    // Xorshift never leaves zero
+    if (seed == 0) seed = defSeed;
+    this->seed = seed;
+    random = seed;
+}
+
+uint32_t Sequencer::getSeed() {
+    return seed;
+}
+
 int Sequencer::getStepNum() {
     return stepNum;
 }
 
+void Sequencer::setStepNum(int step) {
+    stepNum = step;
+    currentStep = &steps[std::max(step, 0)];
+}
+
+int Sequencer::getNumSteps() {
+    return numSteps;
+}
+
 void Sequencer::clear() {
-    for (int i = 0; i < numSteps; i++) {
+    for (int i = 0; i < maxSteps; i++) {
         steps[i].clear();
     }
 }
 
 void Sequencer::reset(bool clearSteps) {
+    random = seed;
     stepNum = -1;
     step();
     stepNum = -1;
@@ -144,9 +214,47 @@ void Sequencer::toggle(drumID_t drum) {
     toggle(drum, stepNum);
 }
 
+void Sequencer::setVelocity(drumID_t drum, int step, int velocity) {
+    steps[step].setVelocity(drum, velocity);
+}
+
+int Sequencer::getVelocity(drumID_t drum, int step) {
+    return steps[step].getVelocity(drum);
+}
+
+void Sequencer::setProbability(drumID_t drum, int step, int percent) {
+    steps[step].setProbability(drum, percent);
+}
+
+int Sequencer::getProbability(drumID_t drum, int step) {
+    return steps[step].getProbability(drum);
+}
+
+void Sequencer::setSwing(float percent) {
+    swing = std::min(std::max(percent, 50.f), 75.f);
+}
+
+float Sequencer::getSwing() {
+    return swing;
+}
+
+void Sequencer::setOffset(drumID_t drum, int step, int frames) {
+    steps[step].setOffset(drum, std::min(std::max(frames, -maxOffset), (int)maxOffset));
+}
+
+int Sequencer::getOffset(drumID_t drum, int step) {
+    return steps[step].getOffset(drum);
+}
+
+uint32_t Sequencer::nextRandom() {
+    random ^= random << 13;
+    random ^= random >> 17;
+    random ^= random << 5;
+    return random;
+}
+
 void Sequencer::setNumSteps(int n) {
-    numSteps = n;
-    steps.resize(numSteps);
+    numSteps = std::min(std::max(n, 1), (int)maxSteps);
 }
 
 void Sequencer::_updateStepID() {
@@ -159,19 +267,202 @@ void Sequencer::_updateStepPtr() {
 }
 
 
+// SequencerScheduler class
+
+SequencerScheduler::SequencerScheduler(std::shared_ptr<Sequencer> s) {
+    seq = s;
+    active = false;
+    bpm = 480.;
+    running = false;
+    nextStepFrame = 0.;
+    nextStep = 0;
+    barLine = false;
+    numPending = 0;
+    song = nullptr;
+    current = seq.get();
+    playing = nullptr;
+}
+
+void SequencerScheduler::schedule(uint64_t frame, int nFrames, int sampleRate, audio::EventList& events) {
+    if (!active.load(std::memory_order_acquire)) {
+        running = false;
+        return;
+    }
+
+    if (!running) {
+        // First step on the first frame of this period
+        running = true;
+        nextStepFrame = (double)frame;
+        numPending = 0;
+        barLine = false;
+
+        // A song starts from the top of its chain, a lone pattern from
+        // where it was left
+        Song* s = song.load(std::memory_order_acquire);
+        Sequencer* first = s ? s->restart() : nullptr;
+        if (first) {
+            current = first;
+            nextStep = 0;
+        } else {
+            nextStep = (current->getStepNum() + 1) % current->getNumSteps();
+        }
+    }
+
+    double end = (double)(frame + nFrames);
+    double stepFrames = (60. * sampleRate) / bpm.load(std::memory_order_relaxed);
+
+    // Queue steps early enough for their earliest trigger
+    while (nextStepFrame - Sequencer::maxOffset < end) {
+        if (!queueStep(stepFrames)) break;
+    }
+
+    // Hand over everything due in this period. The queue is unordered, so
+    // only the latest step due moves the pattern on.
+    PendingEvent latest = {-1., stepMarker, 0, nullptr, 0};
+    int i = 0;
+    while (i < numPending) {
+        PendingEvent& e = pending[i];
+        int offset = std::max(0, (int)std::ceil(e.frame - (double)frame));
+        if (offset >= nFrames) {
+            i++;
+            continue;
+        }
+
+        if (e.drum == stepMarker) {
+            if (!latest.pattern || e.frame > latest.frame) latest = e;
+        } else {
+            events.add(offset, (drumID_t)e.drum, e.velocity);
+        }
+        e = pending[--numPending];
+    }
+
+    if (latest.pattern) {
+        latest.pattern->setStepNum(latest.step);
+        playing.store(latest.pattern, std::memory_order_release);
+    }
+}
+
+bool SequencerScheduler::queueStep(double stepFrames) {
+    if (numPending + NUM_DRUMS + 1 > maxPending) return false;
+
+    // The bar line: hand over to the song's next pattern, if any
+    if (barLine) {
+        barLine = false;
+        Song* s = song.load(std::memory_order_acquire);
+        Sequencer* next = s ? s->barLine() : nullptr;
+        if (next) current = next;
+    }
+
+    Sequencer* p = current;
+    pending[numPending++] = {nextStepFrame, stepMarker, 0, p, nextStep};
+
+    // Odd steps are swung towards the next step
+    double swing = (nextStep % 2) ? (p->getSwing() - 50.) / 50. * stepFrames : 0.;
+    for (uint32_t m = p->getHits(nextStep); m; m &= m - 1) {
+        drumID_t id = (drumID_t)__builtin_ctz(m);
+        double t = nextStepFrame + swing + p->getOffset(id, nextStep);
+        pending[numPending++] = {t, id, (uint8_t)p->getVelocity(id, nextStep), p, nextStep};
+    }
+
+    nextStepFrame += stepFrames;
+
+    // A pattern shortened past this step wraps here too
+    if (++nextStep >= p->getNumSteps()) {
+        nextStep = 0;
+        barLine = true;
+    }
+    return true;
+}
+
+void SequencerScheduler::start() {
+    active.store(true, std::memory_order_release);
+}
+
+void SequencerScheduler::stop() {
+    active.store(false, std::memory_order_release);
+}
+
+bool SequencerScheduler::isActive() {
+    return active.load(std::memory_order_acquire);
+}
+
+void SequencerScheduler::setRateBPM(double bpm) {
+    this->bpm.store(bpm, std::memory_order_relaxed);
+}
+
+double SequencerScheduler::getRateBPM() {
+    return bpm.load(std::memory_order_relaxed);
+}
+
+void SequencerScheduler::setSong(Song* song) {
+    this->song.store(song, std::memory_order_release);
+}
+
+Sequencer* SequencerScheduler::getPlaying() {
+    return playing.load(std::memory_order_acquire);
+}
+
+
 // SequencerClock class
 
-SequencerClock::SequencerClock(std::shared_ptr<Sequencer> s, audio::PlaybackEngine& p) {
+SequencerClock::SequencerClock(std::shared_ptr<Sequencer> s, audio::PlaybackEngine& p, bool sampleAccurate) :
+    scheduler(s)
+{
     setRateBPM(480);
     rateChangeFlag = false;
 
     seq = s;
     pbe = &p;
+
+    this->sampleAccurate = sampleAccurate;
+    if (sampleAccurate) pbe->setScheduler(&scheduler);
+}
+
+SequencerClock::~SequencerClock() {
+    stop();
+    if (sampleAccurate) pbe->setScheduler(nullptr);
 }
 
 void SequencerClock::tick() {
     seq->step();
 
-    std::vector<drumID_t> active = seq->getActive();
-    for(int i = 0; i < active.size(); i++) pbe->trigger(active[i]);
-}
\ No newline at end of file
+    int step = seq->getStepNum();
+    for (uint32_t m = seq->getHits(step); m; m &= m - 1) {
+        drumID_t id = (drumID_t)__builtin_ctz(m);
+        pbe->trigger(id, 0, seq->getVelocity(id, step));
+    }
+}
+
+void SequencerClock::start() {
+    if (sampleAccurate) {
+        scheduler.start();
+    } else {
+        Metronome::start();
+    }
+}
+
+void SequencerClock::stop() {
+    if (sampleAccurate) {
+        scheduler.stop();
+    } else {
+        Metronome::stop();
+    }
+}
+
+bool SequencerClock::isActive() {
+    if (sampleAccurate) return scheduler.isActive();
+    return Metronome::isActive();
+}
+
+void SequencerClock::setRateBPM(double bpm) {
+    Metronome::setRateBPM(bpm);
+    scheduler.setRateBPM(bpm);
+}
+
+void SequencerClock::setSong(Song* song) {
+    scheduler.setSong(song);
+}
+
+bool SequencerClock::isSampleAccurate() {
+    return sampleAccurate;
+}
@@ -8,10 +8,20 @@
 
 #include <vector>
 #include <array>
+#include <atomic>
+#include <memory>
+#include <cstdint>
 
 namespace drumpi {
 
-/*! Step class for a \ref Sequencer object. */
+class Song;
+
+static_assert(NUM_DRUMS <= 32, "a step's drums must fit a 32-bit mask");
+
+/*! Step class for a \ref Sequencer object.
+Packed as a bitmask of the active drums plus small per-drum arrays, so a
+step fits in a cache line and its hits are found with a ctz loop over the
+mask. */
 class _SequenceStep {
     public:
         /*! _SequenceStep constructor. */
@@ -42,20 +52,64 @@ class _SequenceStep {
         \return a vector containing the \ref drumID_t of the active drums. */
         std::vector<drumID_t> getActive();
 
-        /*! Removes all drums from the \ref _SequenceStep. */
+        /*! Returns the active drums as a bitmask.
+        \return mask with bit `id` set for each active drum. */
+        uint32_t getMask();
+
+        /*! Sets the velocity a drum is hit with.
+        \param id \ref drumID_t of the drum.
+        \param velocity velocity from 1 to \ref MAX_VELOCITY. */
+        void setVelocity(drumID_t id, int velocity);
+
+        /*! Returns the velocity a drum is hit with.
+        \param id \ref drumID_t of the drum.
+        \return velocity from 1 to \ref MAX_VELOCITY. */
+        int getVelocity(drumID_t id);
+
+        /*! Sets the chance of an active drum playing each time round.
+        \param id \ref drumID_t of the drum.
+        \param percent probability in percent, from 0 to 100. */
+        void setProbability(drumID_t id, int percent);
+
+        /*! Returns the chance of an active drum playing each time round.
+        \param id \ref drumID_t of the drum.
+        \return probability in percent. */
+        int getProbability(drumID_t id);
+
+        /*! Sets how far a drum's trigger is moved from the step's time.
+        \param id \ref drumID_t of the drum.
+        \param frames offset in frames, negative to play early. */
+        void setOffset(drumID_t id, int frames);
+
+        /*! Returns how far a drum's trigger is moved from the step's time.
+        \param id \ref drumID_t of the drum.
+        \return offset in frames. */
+        int getOffset(drumID_t id);
+
+        /*! Removes all drums from the \ref _SequenceStep and resets their
+        velocities, probabilities and offsets. */
         void clear();
     
     private:
-        /*! Container for drum trigger switches. */
-        std::array<bool, NUM_DRUMS> switches;
+        /*! Drum trigger switches, bit `id` for each drum. */
+        uint32_t mask;
+        /*! Velocity of each drum. */
+        std::array<uint8_t, NUM_DRUMS> velocities;
+        /*! Probability of each drum in percent. */
+        std::array<uint8_t, NUM_DRUMS> probabilities;
+        /*! Timing offset of each drum in frames. */
+        std::array<int16_t, NUM_DRUMS> offsets;
 };
 
 
-/*! Sequencer class for creating, manipulating and outputting a drum sequence. */
+/*! Sequencer class for creating, manipulating and outputting a drum sequence.
+Storage for \ref maxSteps steps is allocated up front, so the length of the
+pattern can change while it plays. */
 class Sequencer {
     public:
         /*! Constructor.
-        \param numSteps the number of steps in the sequence. */
+        \param numSteps the number of steps in the sequence, from 1 to
+        \ref maxSteps. */
         Sequencer(const int numSteps);
 
         /*! Advance the \ref Sequencer by one step.
@@ -83,17 +137,56 @@ class Sequencer {
         std::vector<bool> getSteps(drumID_t drumID);
 
         /*! Returns the entire \ref Sequencer pattern.
+        Allocates, so use \ref getMask from the clocking threads.
         \return a 2D vector of the \ref Sequencer pattern, indexed as [step][drum]. */
         std::vector<std::vector<bool>> getSequence();
 
+        /*! Returns the drums active in a step as a bitmask.
+        \param step ID of the step.
+        \return mask with bit `id` set for each active drum. */
+        uint32_t getMask(int step);
+
+        /*! Rolls for the drums that play in a step this time round.
+        Each active drum plays with its probability, drawn from the
+        \ref Sequencer's seeded generator, so a pattern plays back the same
+        way from each \ref reset. Called by whichever thread clocks the
+        \ref Sequencer.
+        \param step ID of the step.
+        \return mask with bit `id` set for each drum to play. */
+        uint32_t getHits(int step);
+
+        /*! Seeds the generator used for probabilities, and restarts it.
+        \param seed seed value. */
+        void setSeed(uint32_t seed);
+
+        /*! Returns the seed of the generator used for probabilities.
+        \return seed value. */
+        uint32_t getSeed();
+
         /*! Get the current step number.
         \return the current step number. */
         int getStepNum();
 
+        /*! Moves to a step.
+        \param step ID of the step, or -1 for before the first. */
+        void setStepNum(int step);
+
+        /*! Get the number of steps in the sequence.
+        \return the number of steps. */
+        int getNumSteps();
+
+        /*! Sets the number of steps in the sequence.
+        Safe while playing: nothing is reallocated, steps past the end keep
+        their contents for if the pattern grows again, and if the current
+        step is past the new end the pattern wraps on the next step.
+        \param n number of steps, clamped to 1 to \ref maxSteps. */
+        void setNumSteps(int n);
+
         /*! Clear the \ref Sequencer pattern. */
         void clear();
 
-        /*! Resets the \ref Sequencer to initial conditions.
+        /*! Resets the \ref Sequencer to initial conditions, restarting the
+        generator used for probabilities.
         \param clearSteps whether to clear the \ref Sequencer pattern. */
         void reset(bool clearSteps = true);
 
@@ -123,17 +216,68 @@ class Sequencer {
         /*! Toggles the specified drum in the current step.
         \param drum \ref drumID_t of the drum to toggle. */
         void toggle(drumID_t drum);
+
+        /*! Sets the velocity of a drum in a step.
+        \param drum \ref drumID_t of the drum.
+        \param step ID of the step to be modified.
+        \param velocity velocity from 1 to \ref MAX_VELOCITY, scaling the
+        drum's gain in proportion. */
+        void setVelocity(drumID_t drum, int step, int velocity);
+
+        /*! Returns the velocity of a drum in a step.
+        \param drum \ref drumID_t of the drum.
+        \param step ID of the step.
+        \return velocity from 1 to \ref MAX_VELOCITY. */
+        int getVelocity(drumID_t drum, int step);
+
+        /*! Sets the chance of a drum playing in a step each time round.
+        \param drum \ref drumID_t of the drum.
+        \param step ID of the step to be modified.
+        \param percent probability in percent, from 0 to 100. */
+        void setProbability(drumID_t drum, int step, int percent);
+
+        /*! Returns the chance of a drum playing in a step each time round.
+        \param drum \ref drumID_t of the drum.
+        \param step ID of the step.
+        \return probability in percent. */
+        int getProbability(drumID_t drum, int step);
+
+        /*! Sets the swing of the pattern.
+        Each odd step is delayed towards the step after it. Applied in
+        sample-accurate mode only.
+        \param percent where an odd step falls between its neighbours, from
+        50 (straight) to 75; 66 gives a triplet shuffle. */
+        void setSwing(float percent);
+
+        /*! Returns the swing of the pattern.
+        \return swing in percent. */
+        float getSwing();
+
+        /*! Sets the timing offset of a drum in a step.
+        Applied in sample-accurate mode only, on top of the swing.
+        \param drum \ref drumID_t of the drum.
+        \param step ID of the step to be modified.
+        \param frames offset in engine frames, clamped to \ref maxOffset
+        either way; negative plays early. */
+        void setOffset(drumID_t drum, int step, int frames);
+
+        /*! Returns the timing offset of a drum in a step.
+        \param drum \ref drumID_t of the drum.
+        \param step ID of the step.
+        \return offset in engine frames. */
+        int getOffset(drumID_t drum, int step);
+
+        /*! Largest timing offset either way, in frames; 50 ms at 48 kHz. */
+        static const int maxOffset = 2400;
+
+        /*! Most steps in a sequence. */
+        static const int maxSteps = 256;
     
     private:
-        /*! Container for \ref _SequenceStep objects. */
+        /*! Container for \ref _SequenceStep objects, \ref maxSteps long. */
         std::vector<_SequenceStep> steps;
         /*! Number of steps in the sequence. */
-        int numSteps;
-
-        /*! Sets the number of steps.
-        Unstable for active use.
-        \param n desired number of sequence steps. */
-        void setNumSteps(int n);
+        std::atomic<int> numSteps;
 
         /*! Index of the current step, e.g. in the \ref steps vector. */
         int stepNum;
@@ -142,6 +286,20 @@ class Sequencer {
 
         /*! Pointer to currently active \ref _SequenceStep object. */
         _SequenceStep* currentStep;
+
+        /*! Swing in percent. */
+        float swing;
+
+        /*! Returns the next number from the xorshift generator.
+        \return pseudo-random number. */
+        uint32_t nextRandom();
+
+        /*! Seed of the generator. */
+        uint32_t seed;
+        /*! State of the generator. */
+        uint32_t random;
+        /*! Seed used until another is set. */
+        static const uint32_t defSeed = 0x9e3779b9u;
         /*! Call to update the active step pointer.
         Should be called after the active step ID is updated
         (see \ref _updateStepID). */
@@ -149,18 +307,163 @@ class Sequencer {
 };
 
 
-/*! \ref Metronome derived class to clock a \ref Sequencer. */
+/*! Clocks a \ref Sequencer in audio time.
+Registered with an \ref audio::PlaybackEngine, it computes step positions from
+the engine's running frame counter and places each step's triggers at the
+exact frame within the period.
+
+Triggers are moved by the pattern's swing and each step's per-drum offsets.
+So that a trigger can fall before its step, each step is read
+\ref Sequencer::maxOffset frames ahead of its time and its triggers queued
+with their exact frames. The queue only holds active triggers, so the work
+per period is in proportion to the triggers and steps falling in it. Edits
+to a step already queued take effect on its next pass.
+
+With a \ref Song set, the pattern is handed over at each bar line, as the
+first step of the next bar is queued, so the new pattern starts exactly on
+the bar whatever the period size. A pattern cued less than
+\ref Sequencer::maxOffset frames before a bar line waits for the next. */
+class SequencerScheduler : public audio::EventScheduler {
+    public:
+        /*! Constructor.
+        \param s \ref Sequencer object to be clocked. */
+        SequencerScheduler(std::shared_ptr<Sequencer> s);
+
+        /*! Places the triggers for any steps falling within the period.
+        Called by the \ref audio::PlaybackEngine on the audio thread. */
+        void schedule(uint64_t frame, int nFrames, int sampleRate, audio::EventList& events) override;
+
+        /*! Starts clocking. The first step falls on the first frame of the
+        next period. */
+        void start();
+
+        /*! Stops clocking. */
+        void stop();
+
+        /*! Checks if the scheduler is clocking the \ref Sequencer.
+        \return `true` if active. */
+        bool isActive();
+
+        /*! Sets the step rate in BPM.
+        Takes effect from the next step.
+        \param bpm desired step rate in BPM. */
+        void setRateBPM(double bpm);
+
+        /*! Returns the step rate in BPM.
+        \return step rate in BPM. */
+        double getRateBPM();
+
+        /*! Sets the \ref Song to take patterns from at each bar line.
+        Set while stopped. The \ref Song must outlive the scheduler.
+        \param song the song, or `nullptr` to play only the \ref Sequencer
+        given to the constructor. */
+        void setSong(Song* song);
+
+        /*! Returns the pattern playing.
+        \return the pattern whose step last started, or `nullptr` before
+        the first. */
+        Sequencer* getPlaying();
+
+    private:
+        /*! Pointer to the \ref Sequencer object to be clocked. */
+        std::shared_ptr<Sequencer> seq = nullptr;
+        /*! Song to take patterns from, if any. */
+        std::atomic<Song*> song;
+        /*! Pattern being queued. Audio thread only. */
+        Sequencer* current;
+        /*! Pattern whose step last started. */
+        std::atomic<Sequencer*> playing;
+
+        /*! Active flag, set by control threads. */
+        std::atomic<bool> active;
+        /*! Step rate in BPM. */
+        std::atomic<double> bpm;
+
+        /*! A queued trigger or step. */
+        struct PendingEvent {
+            /*! Engine frame time, fractional. */
+            double frame;
+            /*! Drum to trigger, or \ref stepMarker to advance the
+            \ref Sequencer. */
+            int drum;
+            /*! Velocity of the trigger. */
+            uint8_t velocity;
+            /*! Pattern of a step marker. */
+            Sequencer* pattern;
+            /*! Step of a step marker. */
+            int step;
+        };
+
+        /*! Queues the triggers of the next step. Audio thread only.
+        \param stepFrames length of a step in frames.
+        \return `false` if the queue is too full to take them. */
+        bool queueStep(double stepFrames);
+
+        /*! Whether the audio thread has started clocking. Audio thread only. */
+        bool running;
+        /*! Engine frame time of the next step to queue, kept fractional so
+        steps do not drift. Audio thread only. */
+        double nextStepFrame;
+        /*! Index of the next step to queue. Audio thread only. */
+        int nextStep;
+        /*! Whether the next step to queue starts a bar. Audio thread only. */
+        bool barLine;
+
+        /*! Most triggers and steps queued at once. */
+        static const int maxPending = 512;
+        /*! Queued triggers and steps, unordered. Audio thread only. */
+        std::array<PendingEvent, maxPending> pending;
+        /*! Number of entries in \ref pending. Audio thread only. */
+        int numPending;
+
+        /*! \ref PendingEvent drum value that advances the \ref Sequencer. */
+        static const int stepMarker = -1;
+};
+
+
+/*! \ref Metronome derived class to clock a \ref Sequencer.
+Either ticks from its own timer, or, in sample-accurate mode, hands the
+clocking to a \ref SequencerScheduler running inside the audio callback. */
 class SequencerClock : public clock::Metronome {
     public:
         /*! Constructor.
         Sets the \ref Sequencer to be clocked.
         \param s \ref Sequencer object to be clocked.
-        \param p \ref audio::PlaybackEngine object for triggering the active drums. */
-        SequencerClock(std::shared_ptr<Sequencer> s, audio::PlaybackEngine& p);
+        \param p \ref audio::PlaybackEngine object for triggering the active drums.
+        \param sampleAccurate whether to clock the \ref Sequencer in audio
+        time instead of from the timer. */
+        SequencerClock(std::shared_ptr<Sequencer> s, audio::PlaybackEngine& p, bool sampleAccurate = false);
+
+        /*! Destructor.
+        Stops the clock and unregisters the sample-accurate scheduler. */
+        ~SequencerClock();
 
         /*! Override the tick method.
         Clocks the \ref Sequencer given to the constructor. */
         void tick() override;
+
+        /*! Start clocking the \ref Sequencer. */
+        void start();
+
+        /*! Stop clocking the \ref Sequencer. */
+        void stop();
+
+        /*! Checks if the \ref Sequencer is being clocked.
+        \return `true` if active. */
+        bool isActive();
+
+        /*! Sets the clock rate in BPM.
+        \param bpm desired clocking rate in BPM. */
+        void setRateBPM(double bpm);
+
+        /*! Sets the \ref Song to take patterns from at each bar line.
+        Sample-accurate mode only. See \ref SequencerScheduler::setSong.
+        \param song the song, or `nullptr`. */
+        void setSong(Song* song);
+
+        /*! Checks if the clock runs in sample-accurate mode.
+        \return `true` if clocked in audio time. */
+        bool isSampleAccurate();
     
     private:
         /*! Pointer to the \ref Sequencer object to be clocked. */
@@ -169,6 +472,12 @@ class SequencerClock : public clock::Metronome {
         /*! Pointer to the \ref audio::PlaybackEngine used for triggering the active
         drums. */
         audio::PlaybackEngine* pbe;
+
+        /*! Audio time scheduler used in sample-accurate mode. */
+        SequencerScheduler scheduler;
+
+        /*! Whether the clock runs in sample-accurate mode. */
+        bool sampleAccurate;
 };
 
 } // namespace drumpi
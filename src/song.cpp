@@ -0,0 +1,86 @@
+// File: song.cpp
+
+#include "song.hpp"
+
+#include <algorithm>
+
+using namespace drumpi;
+
+Song::Song() {
+    for (int i = 0; i < maxPatterns; i++) patterns[i] = nullptr;
+    for (int i = 0; i < maxChain; i++) chain[i] = 0;
+    count = 0;
+    chainLength = 0;
+    position = 0;
+    cued = -1;
+}
+
+int Song::addPattern(std::shared_ptr<Sequencer> pattern) {
+    int i = count.load();
+    if (!pattern || i >= maxPatterns) return -1;
+
+    owned.push_back(pattern);
+    patterns[i].store(pattern.get(), std::memory_order_relaxed);
+    count.store(i + 1, std::memory_order_release);
+    return i;
+}
+
+std::shared_ptr<Sequencer> Song::getPattern(int i) {
+    if (i < 0 || i >= (int)owned.size()) return nullptr;
+    return owned[i];
+}
+
+int Song::numPatterns() {
+    return count.load();
+}
+
+bool Song::setChain(const std::vector<int>& chain) {
+    if ((int)chain.size() > maxChain) return false;
+
+    int n = count.load();
+    for (int i = 0; i < (int)chain.size(); i++) {
+        if (chain[i] < 0 || chain[i] >= n) return false;
+    }
+
+    // Shorten first, so the audio thread never reads past what is written
+    int length = std::min(chainLength.load(), (int)chain.size());
+    chainLength.store(length, std::memory_order_release);
+    for (int i = 0; i < (int)chain.size(); i++) {
+        this->chain[i].store(chain[i], std::memory_order_relaxed);
+    }
+    chainLength.store((int)chain.size(), std::memory_order_release);
+    return true;
+}
+
+std::vector<int> Song::getChain() {
+    std::vector<int> v(chainLength.load());
+    for (int i = 0; i < (int)v.size(); i++) v[i] = chain[i].load();
+    return v;
+}
+
+bool Song::cue(int pattern) {
+    if (pattern < 0 || pattern >= count.load()) return false;
+    cued.store(pattern, std::memory_order_release);
+    return true;
+}
+
+int Song::getPosition() {
+    return position.load();
+}
+
+Sequencer* Song::restart() {
+    position.store(-1, std::memory_order_relaxed);
+    return barLine();
+}
+
+Sequencer* Song::barLine() {
+    int c = cued.exchange(-1, std::memory_order_acquire);
+    if (c >= 0) return patterns[c].load(std::memory_order_relaxed);
+
+    int length = chainLength.load(std::memory_order_acquire);
+    if (length == 0) return nullptr;
+
+    int p = (position.load(std::memory_order_relaxed) + 1) % length;
+    position.store(p, std::memory_order_relaxed);
+    return patterns[chain[p].load(std::memory_order_relaxed)].load(std::memory_order_relaxed);
+}
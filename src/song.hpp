@@ -0,0 +1,102 @@
+// File: song.hpp
+#ifndef DRUMPI_SONG_H
+#define DRUMPI_SONG_H
+
+#include "sequencer.hpp"
+
+#include <vector>
+#include <array>
+#include <atomic>
+#include <memory>
+
+namespace drumpi {
+
+/*! A set of patterns and the order to play them in.
+Holds up to \ref maxPatterns \ref Sequencer patterns, a chain of pattern
+indices, and a pattern cued to play next. A \ref SequencerScheduler asks
+for the next pattern at each bar line, from the audio thread, so the
+audio side only loads atomics: patterns are never removed once added, and
+edits to the chain are made one entry at a time. A pattern handed over
+still playing when the chain is changed simply finishes its bar.
+
+Patterns are added, and the chain and cues set, from control threads. */
+class Song {
+    public:
+        /*! Constructor.
+        Starts with no patterns and an empty chain. */
+        Song();
+
+        /*! Adds a pattern.
+        \param pattern the pattern, kept for the life of the \ref Song.
+        \return index of the pattern, or -1 if the \ref Song is full. */
+        int addPattern(std::shared_ptr<Sequencer> pattern);
+
+        /*! Returns a pattern.
+        \param i index of the pattern.
+        \return the pattern, or `nullptr` if there is none at that index. */
+        std::shared_ptr<Sequencer> getPattern(int i);
+
+        /*! Returns the number of patterns.
+        \return number of patterns. */
+        int numPatterns();
+
+        /*! Sets the order the patterns play in.
+        The chain loops, and an empty chain repeats the playing pattern.
+        Takes effect from the next bar line.
+        \param chain pattern indices, at most \ref maxChain.
+        \return `false`, leaving the chain unchanged, if it is too long or
+        names a pattern that does not exist. */
+        bool setChain(const std::vector<int>& chain);
+
+        /*! Returns the order the patterns play in.
+        \return pattern indices. */
+        std::vector<int> getChain();
+
+        /*! Plays a pattern from the next bar line, ahead of the chain.
+        The chain carries on from where it was afterwards.
+        \param pattern index of the pattern.
+        \return `false` if there is no pattern at that index. */
+        bool cue(int pattern);
+
+        /*! Returns the position in the chain.
+        \return index into the chain of the entry last handed over. */
+        int getPosition();
+
+        /*! Returns the first pattern to play, restarting the chain.
+        Audio thread.
+        \return the cued pattern, else the first in the chain, or `nullptr`
+        if neither is set. */
+        Sequencer* restart();
+
+        /*! Returns the pattern to play from a bar line. Audio thread.
+        \return the cued pattern, else the next in the chain, or `nullptr`
+        to keep playing the same pattern. */
+        Sequencer* barLine();
+
+        /*! Most patterns in a \ref Song. */
+        static const int maxPatterns = 64;
+        /*! Most entries in a chain. */
+        static const int maxChain = 256;
+
+    private:
+        /*! Owners of the patterns. Control threads only. */
+        std::vector<std::shared_ptr<Sequencer>> owned;
+        /*! The patterns, as read by the audio thread. */
+        std::array<std::atomic<Sequencer*>, maxPatterns> patterns;
+        /*! Number of patterns. */
+        std::atomic<int> count;
+
+        /*! Pattern indices in playing order. */
+        std::array<std::atomic<int>, maxChain> chain;
+        /*! Number of entries in the chain. */
+        std::atomic<int> chainLength;
+        /*! Index into the chain of the entry last handed over. */
+        std::atomic<int> position;
+
+        /*! Index of the cued pattern, or -1. */
+        std::atomic<int> cued;
+};
+
+} // namespace drumpi
+
+#endif // define DRUMPI_SONG_H
@@ -0,0 +1,11 @@
+// File: threads.cpp
+#include "threads.hpp"
+
+#include <signal.h>
+#include <pthread.h>
+
+void drumpi::blockSignals() {
+    sigset_t signals;
+    sigfillset(&signals);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+}
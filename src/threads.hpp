@@ -0,0 +1,15 @@
+// File: threads.hpp
+#ifndef DRUMPI_THREADS_H
+#define DRUMPI_THREADS_H
+
+namespace drumpi {
+
+/*! Blocks every signal on the calling thread.
+Called first by each worker thread, so that signals such as SIGINT are
+always delivered to the application's main thread, which owns the handlers
+and the shutdown, and never interrupt a worker mid-operation. */
+void blockSignals();
+
+} // namespace drumpi
+
+#endif // define DRUMPI_THREADS_H
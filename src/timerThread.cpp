@@ -0,0 +1,203 @@
+// File: timerThread.cpp
+#include "timerThread.hpp"
+#include "threads.hpp"
+
+#include <cerrno>
+#include <ctime>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+
+using namespace drumpi;
+using namespace clock;
+
+// ThreadTimer class
+
+ThreadTimer::ThreadTimer() {
+    fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    TimerThread::instance().add(this);
+}
+
+ThreadTimer::~ThreadTimer() {
+    TimerThread::instance().remove(this);
+    if (fd >= 0) close(fd);
+}
+
+void ThreadTimer::start(long nanosecs, timerType_t type) {
+    struct itimerspec its;
+
+    // A zero time would disarm the timer instead
+    if (nanosecs < 1) nanosecs = 1;
+
+    its.it_value.tv_sec = nanosecs / 1000000000L;
+    its.it_value.tv_nsec = nanosecs % 1000000000L;
+    if (type == TIMER_PERIODIC) {
+        its.it_interval = its.it_value;
+    } else {
+        its.it_interval.tv_sec = 0;
+        its.it_interval.tv_nsec = 0;
+    }
+
+    std::lock_guard<std::recursive_mutex> lock(TimerThread::instance().mutex);
+    timerfd_settime(fd, 0, &its, NULL);
+}
+
+void ThreadTimer::startAt(int64_t deadline) {
+    struct itimerspec its = {};
+
+    // A zero time would disarm the timer instead
+    if (deadline < 1) deadline = 1;
+
+    its.it_value.tv_sec = deadline / 1000000000L;
+    its.it_value.tv_nsec = deadline % 1000000000L;
+
+    std::lock_guard<std::recursive_mutex> lock(TimerThread::instance().mutex);
+    timerfd_settime(fd, TFD_TIMER_ABSTIME, &its, NULL);
+}
+
+void ThreadTimer::stop() {
+    struct itimerspec its = {};
+
+    // Disarming also clears any expiry the thread has not read yet
+    std::lock_guard<std::recursive_mutex> lock(TimerThread::instance().mutex);
+    timerfd_settime(fd, 0, &its, NULL);
+}
+
+int64_t ThreadTimer::now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+void ThreadTimer::fire() {
+    std::lock_guard<std::recursive_mutex> lock(TimerThread::instance().mutex);
+    timerEvent();
+}
+
+std::recursive_mutex& ThreadTimer::eventMutex() {
+    return TimerThread::instance().mutex;
+}
+
+
+// TimerThread class
+
+TimerThread& TimerThread::instance() {
+    static TimerThread t;
+    return t;
+}
+
+TimerThread::TimerThread() {
+    struct epoll_event ev = {};
+
+    priority = 0;
+    cpu = -1;
+
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    // The wake event carries no timer
+    ev.events = EPOLLIN;
+    ev.data.ptr = nullptr;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &ev);
+
+    running = true;
+    thread = std::thread(&TimerThread::loop, this);
+}
+
+TimerThread::~TimerThread() {
+    running = false;
+
+    uint64_t one = 1;
+    ssize_t r = write(wakeFd, &one, sizeof(one));
+    (void)r;
+    thread.join();
+
+    close(wakeFd);
+    close(epollFd);
+}
+
+bool TimerThread::setPriority(int priority) {
+    struct sched_param param = {};
+    param.sched_priority = priority;
+
+    int policy = (priority > 0) ? SCHED_FIFO : SCHED_OTHER;
+    if (pthread_setschedparam(thread.native_handle(), policy, &param) != 0) return false;
+
+    this->priority = priority;
+    return true;
+}
+
+int TimerThread::getPriority() {
+    return priority;
+}
+
+bool TimerThread::setAffinity(int cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+
+    if (cpu < 0) {
+        for (int i = 0; i < CPU_SETSIZE; i++) CPU_SET(i, &set);
+    } else {
+        CPU_SET(cpu, &set);
+    }
+
+    if (pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set) != 0) return false;
+
+    this->cpu = (cpu < 0) ? -1 : cpu;
+    return true;
+}
+
+int TimerThread::getAffinity() {
+    return cpu;
+}
+
+bool TimerThread::isCurrent() {
+    return std::this_thread::get_id() == thread.get_id();
+}
+
+void TimerThread::add(ThreadTimer* t) {
+    struct epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.ptr = t;
+
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    if (t->fd >= 0) epoll_ctl(epollFd, EPOLL_CTL_ADD, t->fd, &ev);
+    timers.insert(t);
+}
+
+void TimerThread::remove(ThreadTimer* t) {
+    // Waits for a running event to finish
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    if (t->fd >= 0) epoll_ctl(epollFd, EPOLL_CTL_DEL, t->fd, NULL);
+    timers.erase(t);
+}
+
+void TimerThread::loop() {
+    blockSignals();
+
+    struct epoll_event events[maxEvents];
+
+    while (running) {
+        int n = epoll_wait(epollFd, events, maxEvents, -1);
+        if (n < 0 && errno != EINTR) break;
+
+        for (int i = 0; i < n; i++) {
+            ThreadTimer* t = static_cast<ThreadTimer*>(events[i].data.ptr);
+            if (!t) continue;
+
+            std::lock_guard<std::recursive_mutex> lock(mutex);
+
+            // The timer may have been destroyed, or stopped, since the wait
+            // returned
+            if (timers.count(t) == 0) continue;
+
+            uint64_t expirations = 0;
+            if (read(t->fd, &expirations, sizeof(expirations)) != sizeof(expirations)) continue;
+            if (expirations > 0) t->timerEvent();
+        }
+    }
+}
@@ -0,0 +1,166 @@
+// File: timerThread.hpp
+#ifndef DRUMPI_TIMER_THREAD_H
+#define DRUMPI_TIMER_THREAD_H
+
+#include <set>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+
+#include "defs.hpp"
+
+namespace drumpi {
+namespace clock {
+
+/*! Base class for timers run by the \ref TimerThread.
+Each timer owns a `timerfd`, so the kernel keeps the deadlines and the
+thread sleeps in `epoll_wait` until one is due. \ref timerEvent runs on the
+timer thread in a normal thread context, never in a signal handler, so it
+may allocate, lock and do I/O. */
+class ThreadTimer {
+    public:
+        /*! Constructor.
+        Registers the timer with the \ref TimerThread, disarmed. */
+        ThreadTimer();
+
+        /*! Destructor.
+        Unregisters the timer, waiting for a running \ref timerEvent to
+        return. By then derived classes are already destroyed, so a class
+        that overrides \ref timerEvent, or a callback it makes, stops the
+        timer in its own destructor. */
+        virtual ~ThreadTimer();
+
+        /*! Arms the timer.
+        \param nanosecs time until the first event, and the interval between
+        events if periodic, in ns.
+        \param type \ref timerType_t of the timer. */
+        virtual void start(long nanosecs, timerType_t type = TIMER_PERIODIC);
+
+        /*! Arms the timer to fire once at an absolute time.
+        A deadline already passed fires at once.
+        \param deadline time of the event on the `CLOCK_MONOTONIC` clock, in
+        ns, as returned by \ref now. */
+        void startAt(int64_t deadline);
+
+        /*! Disarms the timer.
+        Once it returns no further \ref timerEvent starts. */
+        virtual void stop();
+
+        /*! Returns the current time of the clock timers run on.
+        \return `CLOCK_MONOTONIC` time in ns. */
+        static int64_t now();
+
+    protected:
+        /*! Called on the timer thread each time the timer fires.
+        If the thread fell behind, missed events are not replayed. */
+        virtual void timerEvent() = 0;
+
+        /*! Runs \ref timerEvent now on the calling thread, one at a time
+        with the timer thread's events. */
+        void fire();
+
+        /*! Returns the lock every \ref timerEvent runs under.
+        Holding it keeps events out while state they read is changed.
+        \return the timer thread's mutex, which is recursive. */
+        static std::recursive_mutex& eventMutex();
+
+    private:
+        friend class TimerThread;
+
+        /*! File descriptor of the timer's `timerfd`. */
+        int fd;
+};
+
+
+/*! The thread that runs all \ref ThreadTimer events.
+A single thread waits on every timer's `timerfd` with `epoll` and calls the
+due timers one at a time, so timer callbacks never run concurrently with
+each other, or with a \ref ThreadTimer being started, stopped or destroyed
+on another thread.
+
+The thread starts on first use. It blocks all signals, leaving them to the
+application's main thread, and can be given a real-time priority and a CPU
+so that clocks keep time on a loaded system. */
+class TimerThread {
+    public:
+        /*! Returns the timer thread, starting it if needed.
+        \return reference to the timer thread. */
+        static TimerThread& instance();
+
+        /*! Destructor.
+        Stops the thread. */
+        ~TimerThread();
+
+        /*! Sets the scheduling priority of the thread.
+        \param priority `SCHED_FIFO` priority from 1 to 99, or 0 for normal
+        scheduling.
+        \return `true` on success; real-time priorities usually need
+        `CAP_SYS_NICE` or an `rtprio` limit. */
+        bool setPriority(int priority);
+
+        /*! Returns the scheduling priority of the thread.
+        \return `SCHED_FIFO` priority, or 0 for normal scheduling. */
+        int getPriority();
+
+        /*! Pins the thread to a CPU.
+        \param cpu index of the CPU, or -1 to allow all CPUs.
+        \return `true` on success. */
+        bool setAffinity(int cpu);
+
+        /*! Returns the CPU the thread is pinned to.
+        \return index of the CPU, or -1 if not pinned. */
+        int getAffinity();
+
+        /*! Checks if the calling thread is the timer thread.
+        \return `true` when called from a timer event. */
+        bool isCurrent();
+
+    private:
+        friend class ThreadTimer;
+
+        /*! Constructor.
+        Creates the epoll set and starts the thread. */
+        TimerThread();
+
+        /*! Adds a timer to the epoll set.
+        \param t the timer. */
+        void add(ThreadTimer* t);
+
+        /*! Removes a timer from the epoll set.
+        \param t the timer. */
+        void remove(ThreadTimer* t);
+
+        /*! Thread loop. */
+        void loop();
+
+        /*! File descriptor of the epoll set. */
+        int epollFd;
+        /*! Event file descriptor used to wake the thread to stop. */
+        int wakeFd;
+
+        /*! Registered timers. Events for timers no longer here are
+        dropped. */
+        std::set<ThreadTimer*> timers;
+        /*! Guards \ref timers and is held while a timer event runs.
+        Recursive so events may start, stop, create and destroy timers. */
+        std::recursive_mutex mutex;
+
+        /*! The thread. */
+        std::thread thread;
+        /*! Whether the thread should keep running. */
+        std::atomic<bool> running;
+
+        /*! `SCHED_FIFO` priority, or 0. */
+        int priority;
+        /*! Pinned CPU, or -1. */
+        int cpu;
+
+        /*! Most events taken from each `epoll_wait`. */
+        static const int maxEvents = 16;
+};
+
+} // namespace clock
+} // namespace drumpi
+
+#endif // define DRUMPI_TIMER_THREAD_H
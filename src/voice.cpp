@@ -0,0 +1,295 @@
+// File: voice.cpp
+#include "voice.hpp"
+#include "mixer.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace drumpi;
+using namespace audio;
+
+// Voice class
+
+Voice::Voice() {
+    drum = DRUM_1;
+    age = 0;
+    velocity = 1.f;
+    playhead = 0;
+    lastGain = 0.f;
+    active = false;
+    streamer = nullptr;
+    slot = -1;
+    length = 0;
+    snap = true;
+    smoothing = 0.f;
+    for (int k = 0; k < NUM_GAINS; k++) {
+        gains[k] = 0.f;
+        steps[k] = 0.f;
+    }
+}
+
+void Voice::setSmoothing(float frames) {
+    smoothing = std::max(frames, 0.f);
+}
+
+void Voice::setStreamer(DiskStreamer* streamer) {
+    stop();
+    this->streamer = streamer;
+}
+
+void Voice::start(drumID_t drum, const std::shared_ptr<const SampleData>& data, uint64_t age,
+    float velocity)
+{
+    // A stolen voice gives up its stream first
+    stop();
+
+    this->data = data;
+    this->drum = drum;
+    this->age = age;
+    this->velocity = velocity;
+    playhead = 0;
+    lastGain = 0.f;
+    snap = true;
+    active = (data != nullptr) && !data->empty();
+    if (!active) return;
+
+    length = data->getLength();
+    if (data->getStream()) {
+        if (streamer) slot = streamer->claim(data->getStream(), data->size());
+
+        // Without a slot only the head can be played
+        if (slot < 0) {
+            length = data->size();
+            if (streamer) streamer->countUnderrun();
+        }
+    }
+}
+
+void Voice::stop() {
+    if (slot >= 0) streamer->release(slot);
+    slot = -1;
+    active = false;
+    data.reset();
+}
+
+void Voice::mix(sample_t* const* outs, int nOuts, int nFrames, float gain, float pan,
+    sample_t* const* direct, float directGain)
+{
+    if (!active || nOuts < 1) return;
+
+    int n = std::min(nFrames, length - playhead);
+    if (n <= 0) return;
+
+    gain *= velocity;
+    directGain *= velocity;
+
+    float left, right;
+    panGains(pan, left, right);
+
+    // Ramp each gain from where it is to where a one-pole smoother would be
+    // after this call
+    float targets[NUM_GAINS] = {gain * left, gain * right, gain, directGain};
+    float decay = (snap || smoothing <= 0.f) ? 0.f : std::exp(-float(n) / smoothing);
+    for (int k = 0; k < NUM_GAINS; k++) {
+        float diff = gains[k] - targets[k];
+        if (decay == 0.f || std::fabs(diff) < settled) {
+            gains[k] = targets[k];
+            steps[k] = 0.f;
+        } else {
+            steps[k] = -diff * (1.f - decay) / n;
+        }
+    }
+    snap = false;
+
+    // Resident frames
+    int done = std::max(0, std::min(n, data->size() - playhead));
+    if (done > 0) route(outs, nOuts, direct, 0, done, nullptr);
+
+    // Streamed frames, as far as the ring has them
+    if (done < n) {
+        const sample_t* ring[DiskStreamer::maxChannels];
+        while (done < n) {
+            int k = streamer->peek(slot, ring, n - done);
+            if (k == 0) break;
+
+            route(outs, nOuts, direct, done, k, ring);
+            streamer->advance(slot, k);
+            done += k;
+        }
+
+        // Skip the rest rather than fall further behind
+        if (done < n) {
+            streamer->advance(slot, n - done);
+            streamer->countUnderrun();
+        }
+    }
+
+    for (int k = 0; k < NUM_GAINS; k++) gains[k] += steps[k] * n;
+    playhead += n;
+    lastGain = gain;
+
+    if (playhead >= length) stop();
+}
+
+void Voice::route(sample_t* const* outs, int nOuts, sample_t* const* direct, int offset, int n,
+    const sample_t* const* ring)
+{
+    int numChannels = data->getNumChannels();
+
+    if (nOuts == 1) {
+        // Mix down
+        for (int c = 0; c < numChannels; c++) {
+            add(c, outs[0], GAIN_CENTRE, 1.f / numChannels, offset, n, ring);
+        }
+    } else if (numChannels == 1) {
+        add(0, outs[0], GAIN_LEFT, 1.f, offset, n, ring);
+        add(0, outs[1], GAIN_RIGHT, 1.f, offset, n, ring);
+    } else {
+        for (int c = 0; c < numChannels; c++) {
+            int o = c % nOuts;
+            int k = (o == 0) ? GAIN_LEFT : (o == 1) ? GAIN_RIGHT : GAIN_CENTRE;
+            add(c, outs[o], k, 1.f, offset, n, ring);
+        }
+    }
+
+    // Unpanned copy for external mixing
+    if (direct) {
+        for (int c = 0; c < numChannels; c++) {
+            add(c, direct[c % 2], GAIN_DIRECT, 1.f, offset, n, ring);
+        }
+        if (numChannels == 1) add(0, direct[1], GAIN_DIRECT, 1.f, offset, n, ring);
+    }
+}
+
+void Voice::add(int c, sample_t* out, int k, float scale, int offset, int n, const sample_t* const* ring) {
+    float g = (gains[k] + steps[k] * offset) * scale;
+    float step = steps[k] * scale;
+
+    if (!ring) {
+        data->mix(c, playhead + offset, out + offset, g, n, step);
+    } else if (step != 0.f) {
+        mixGainRamp(out + offset, ring[c], g, step, n);
+    } else {
+        mixGain(out + offset, ring[c], g, n);
+    }
+}
+
+bool Voice::isActive() {
+    return active;
+}
+
+drumID_t Voice::getDrum() {
+    return drum;
+}
+
+uint64_t Voice::getAge() {
+    return age;
+}
+
+float Voice::getLevel() {
+    if (!active) return 0.f;
+    return lastGain * float(length - playhead) / float(length);
+}
+
+
+// VoicePool class
+
+VoicePool::VoicePool(int numVoices) {
+    voices.resize(std::max(numVoices, 1));
+    policy = STEAL_OLDEST;
+    triggerCount = 0;
+}
+
+void VoicePool::setSmoothing(float frames) {
+    for (int i = 0; i < voices.size(); i++) voices[i].setSmoothing(frames);
+}
+
+void VoicePool::setStreamer(DiskStreamer* streamer) {
+    for (int i = 0; i < voices.size(); i++) voices[i].setStreamer(streamer);
+}
+
+void VoicePool::start(drumID_t drum, const std::shared_ptr<const SampleData>& data, float velocity) {
+    triggerCount++;
+    allocate(drum).start(drum, data, triggerCount, velocity);
+}
+
+void VoicePool::stop(drumID_t drum) {
+    for (int i = 0; i < voices.size(); i++) {
+        if (voices[i].isActive() && voices[i].getDrum() == drum) voices[i].stop();
+    }
+}
+
+void VoicePool::mix(sample_t* const* outs, int nOuts, int nFrames, const float* gains, const float* pans,
+    sample_t* const* direct, const float* directGains)
+{
+    for (int i = 0; i < voices.size(); i++) {
+        if (!voices[i].isActive()) continue;
+
+        drumID_t d = voices[i].getDrum();
+        voices[i].mix(
+            outs, nOuts, nFrames, gains[d], pans ? pans[d] : 0.f,
+            direct ? direct + 2 * d : nullptr, directGains ? directGains[d] : 0.f
+        );
+    }
+}
+
+bool VoicePool::isActive(drumID_t drum) {
+    for (int i = 0; i < voices.size(); i++) {
+        if (voices[i].isActive() && voices[i].getDrum() == drum) return true;
+    }
+    return false;
+}
+
+int VoicePool::numActive() {
+    int n = 0;
+    for (int i = 0; i < voices.size(); i++) {
+        n += (int)voices[i].isActive();
+    }
+    return n;
+}
+
+int VoicePool::size() {
+    return voices.size();
+}
+
+void VoicePool::setStealPolicy(voiceStealPolicy_t policy) {
+    this->policy = policy;
+}
+
+voiceStealPolicy_t VoicePool::getStealPolicy() {
+    return policy;
+}
+
+Voice& VoicePool::allocate(drumID_t drum) {
+    // Choke the drum's own voice
+    if (policy == STEAL_SAME_DRUM) {
+        Voice* choked = nullptr;
+        for (int i = 0; i < voices.size(); i++) {
+            if (voices[i].isActive() && voices[i].getDrum() == drum) {
+                if (choked) {
+                    voices[i].stop();
+                } else {
+                    choked = &voices[i];
+                }
+            }
+        }
+        if (choked) return *choked;
+    }
+
+    // Use a free voice if there is one
+    for (int i = 0; i < voices.size(); i++) {
+        if (!voices[i].isActive()) return voices[i];
+    }
+
+    // Otherwise steal one
+    int victim = 0;
+    for (int i = 1; i < voices.size(); i++) {
+        if (policy == STEAL_QUIETEST) {
+            if (voices[i].getLevel() < voices[victim].getLevel()) victim = i;
+        } else {
+            if (voices[i].getAge() < voices[victim].getAge()) victim = i;
+        }
+    }
+
+    return voices[victim];
+}
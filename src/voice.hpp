@@ -0,0 +1,241 @@
+// File: voice.hpp
+#ifndef DRUMPI_VOICE_H
+#define DRUMPI_VOICE_H
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+#include "defs.hpp"
+#include "sampleSource.hpp"
+#include "diskStream.hpp"
+
+namespace drumpi {
+namespace audio {
+
+/*! A single playhead over shared \ref SampleData.
+Voices are owned by a \ref VoicePool and only touched by the audio thread.
+A streamed sample is played from its resident head, then from a
+\ref DiskStreamer slot claimed when the voice starts. */
+class Voice {
+    public:
+        /*! Constructor. */
+        Voice();
+
+        /*! Sets the streamer used to play streamed samples.
+        \param streamer the streamer, or `nullptr` to play only the heads
+        of streamed samples. */
+        void setStreamer(DiskStreamer* streamer);
+
+        /*! Sets how quickly gain and pan changes take effect.
+        Changes between calls to \ref mix are followed by a one-pole
+        smoother, applied as a linear ramp across each call, so stepping the
+        volume does not cause zipper noise. A voice starts at its first gain
+        without a ramp, keeping the attack of the sample.
+        \param frames time constant in frames, or 0 to apply changes at
+        once. */
+        void setSmoothing(float frames);
+
+        /*! Starts playback of sample data from the beginning.
+        \param drum \ref drumID_t of the drum being played.
+        \param data sample data to play.
+        \param age trigger count, used to find the oldest voice.
+        \param velocity factor on the voice's gains for this hit. */
+        void start(drumID_t drum, const std::shared_ptr<const SampleData>& data, uint64_t age,
+            float velocity = 1.f);
+
+        /*! Stops playback. */
+        void stop();
+
+        /*! Adds the voice's next samples into a set of output buffers.
+        A mono sample is panned across the first two outputs. Channel `c` of
+        a multichannel sample goes to output `c` modulo the number of
+        outputs, with the pan applied as a balance to the first two. With a
+        single output all channels are mixed down to it.
+        The voice stops itself when it reaches the end of its data. Streamed
+        frames that have not arrived yet are played as silence.
+        \param outs array of buffers to add the samples to.
+        \param nOuts number of buffers.
+        \param nFrames number of frames to add.
+        \param gain linear gain to apply.
+        \param pan pan position, from -1 (left) to 1 (right).
+        \param direct optional pair of buffers the sample is also added to,
+        unpanned, or `nullptr`.
+        \param directGain linear gain to apply to the direct buffers. */
+        void mix(sample_t* const* outs, int nOuts, int nFrames, float gain, float pan = 0.f,
+            sample_t* const* direct = nullptr, float directGain = 0.f);
+
+        /*! Checks if the voice is playing.
+        \return `true` if playing. */
+        bool isActive();
+
+        /*! Returns the drum the voice is playing.
+        \return \ref drumID_t of the drum. */
+        drumID_t getDrum();
+
+        /*! Returns the trigger count at which the voice was started.
+        \return voice age. */
+        uint64_t getAge();
+
+        /*! Returns an estimate of the voice's current level.
+        Percussive samples decay, so the last gain applied is scaled by the
+        fraction of the sample remaining.
+        \return estimated level. */
+        float getLevel();
+
+    private:
+        /*! Adds a run of frames into the outputs, routed as described for
+        \ref mix, with the gains of the current call.
+        \param outs output buffers.
+        \param nOuts number of output buffers.
+        \param direct direct output pair, or `nullptr`.
+        \param offset frame offset of the run in the period.
+        \param n number of frames in the run.
+        \param ring position of each channel in a stream ring, or `nullptr`
+        to read the resident sample data at the playhead. */
+        void route(sample_t* const* outs, int nOuts, sample_t* const* direct, int offset, int n,
+            const sample_t* const* ring);
+
+        /*! Adds a run of one channel into a buffer.
+        \param c channel index.
+        \param out buffer to add to.
+        \param k \ref VoiceGain to apply.
+        \param scale extra factor on the gain.
+        \param offset frame offset of the run in the period.
+        \param n number of frames in the run.
+        \param ring as for \ref route. */
+        void add(int c, sample_t* out, int k, float scale, int offset, int n, const sample_t* const* ring);
+
+        /*! Sample data being played. */
+        std::shared_ptr<const SampleData> data;
+        /*! Streamer for streamed samples, if any. */
+        DiskStreamer* streamer;
+        /*! Streamer slot in use, or -1. */
+        int slot;
+        /*! Number of frames to play. */
+        int length;
+
+        /*! Gains smoothed by a voice. */
+        enum VoiceGain {
+            /*! Main gain times left pan gain. */
+            GAIN_LEFT,
+            /*! Main gain times right pan gain. */
+            GAIN_RIGHT,
+            /*! Main gain alone, for mixdowns and outputs past the first
+            two. */
+            GAIN_CENTRE,
+            /*! Direct output gain. */
+            GAIN_DIRECT,
+            /*! Number of smoothed gains. */
+            NUM_GAINS
+        };
+        /*! Smoothed gains at the start of the current \ref mix. */
+        float gains[NUM_GAINS];
+        /*! Change in each gain per frame during the current \ref mix. */
+        float steps[NUM_GAINS];
+        /*! Whether the gains are to be set, not smoothed, by the next
+        \ref mix, as after a start. */
+        bool snap;
+        /*! Time constant of the gain smoothing in frames, or 0 for none. */
+        float smoothing;
+        /*! Difference below which a smoothed gain jumps to its target. */
+        const float settled = 1e-5f;
+
+        /*! Drum being played. */
+        drumID_t drum;
+        /*! Trigger count at which the voice was started. */
+        uint64_t age;
+        /*! Factor on the gains for this hit. */
+        float velocity;
+        /*! The number of samples of playback elapsed. */
+        int playhead;
+        /*! Last gain applied in \ref mix. */
+        float lastGain;
+        /*! Playing flag. */
+        bool active;
+};
+
+
+/*! Fixed-size, preallocated pool of \ref Voice objects.
+Each trigger takes a voice, so overlapping hits of the same drum ring out
+instead of cutting each other off. When no voices are free one is stolen
+according to the \ref voiceStealPolicy_t. */
+class VoicePool {
+    public:
+        /*! Constructor.
+        \param numVoices number of voices to preallocate. */
+        VoicePool(int numVoices);
+
+        /*! Sets how quickly gain and pan changes take effect on all voices.
+        See \ref Voice::setSmoothing.
+        \param frames time constant in frames, or 0 to apply changes at
+        once. */
+        void setSmoothing(float frames);
+
+        /*! Sets the streamer used by all voices to play streamed samples.
+        \param streamer the streamer, or `nullptr`. */
+        void setStreamer(DiskStreamer* streamer);
+
+        /*! Starts a voice playing the given drum, stealing one if needed.
+        \param drum \ref drumID_t of the drum to play.
+        \param data sample data of the drum.
+        \param velocity factor on the voice's gains for this hit. */
+        void start(drumID_t drum, const std::shared_ptr<const SampleData>& data, float velocity = 1.f);
+
+        /*! Stops all voices playing the given drum.
+        \param drum \ref drumID_t of the drum to stop. */
+        void stop(drumID_t drum);
+
+        /*! Adds all active voices into a set of output buffers.
+        \param outs array of buffers to add the samples to.
+        \param nOuts number of buffers.
+        \param nFrames number of frames to add.
+        \param gains linear gain for each drum.
+        \param pans pan position of each drum, or `nullptr` for centre.
+        \param direct optional array of a stereo pair of buffers for each
+        drum, which its voices are also added to, or `nullptr`.
+        \param directGains linear gain for each drum on its direct buffers. */
+        void mix(sample_t* const* outs, int nOuts, int nFrames, const float* gains, const float* pans = nullptr,
+            sample_t* const* direct = nullptr, const float* directGains = nullptr);
+
+        /*! Checks if any voice is playing the given drum.
+        \param drum \ref drumID_t of the drum to check.
+        \return `true` if the drum is playing. */
+        bool isActive(drumID_t drum);
+
+        /*! Returns the number of voices playing.
+        \return number of active voices. */
+        int numActive();
+
+        /*! Returns the number of voices in the pool.
+        \return number of voices. */
+        int size();
+
+        /*! Sets the policy for choosing a voice when none are free.
+        \param policy \ref voiceStealPolicy_t to use. */
+        void setStealPolicy(voiceStealPolicy_t policy);
+
+        /*! Returns the voice stealing policy.
+        \return current \ref voiceStealPolicy_t. */
+        voiceStealPolicy_t getStealPolicy();
+
+    private:
+        /*! Chooses a voice to start.
+        \param drum \ref drumID_t of the drum to be played.
+        \return the voice to use. */
+        Voice& allocate(drumID_t drum);
+
+        /*! Voice storage. */
+        std::vector<Voice> voices;
+
+        /*! Voice stealing policy. */
+        voiceStealPolicy_t policy;
+
+        /*! Number of triggers so far, used to age voices. */
+        uint64_t triggerCount;
+};
+
+} // namespace audio
+} // namespace drumpi
+
+#endif // define DRUMPI_VOICE_H
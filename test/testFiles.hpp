@@ -0,0 +1,35 @@
+// File: testFiles.hpp
+// Scratch copies of the test audio file, shared by the tests that need a
+// file they can write a cache next to.
+#ifndef DRUMPI_TEST_FILES_H
+#define DRUMPI_TEST_FILES_H
+
+#include <string>
+#include <fstream>
+#include <cstdio>
+#include <unistd.h>
+
+#include "sampleCache.hpp"
+
+/*! Copies the test file somewhere writable so each test starts without a
+cache.
+\param prefix name of the copy, unique to the calling test suite.
+\return path of the copy. */
+inline std::string copyTestFile(std::string prefix) {
+    std::string copy = "/tmp/" + prefix + "_" + std::to_string(getpid()) + ".wav";
+    std::ifstream src(std::string(DRUMPI_DIR).append("test/test_audio_file.wav"), std::ios::binary);
+    std::ofstream dst(copy, std::ios::binary);
+    dst << src.rdbuf();
+    std::remove((copy + drumpi::audio::SampleCache::extension).data());
+    return copy;
+}
+
+/*! Removes a copy made by \ref copyTestFile and its default cache file.
+\param copy path of the copy. */
+inline void removeCopy(std::string copy) {
+    drumpi::audio::SampleCache cache;
+    std::remove(copy.data());
+    std::remove(cache.getCachePath(copy).data());
+}
+
+#endif // define DRUMPI_TEST_FILES_H
@@ -0,0 +1,35 @@
+// File: testSchedule.hpp
+// Drives a sequencer scheduler the way the audio thread would, for the tests
+// of sample-accurate sequencing.
+#ifndef DRUMPI_TEST_SCHEDULE_H
+#define DRUMPI_TEST_SCHEDULE_H
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+#include "sequencer.hpp"
+#include "playback.hpp"
+
+/*! Runs a scheduler over a range of engine frames in periods of the given
+size.
+\param sch the scheduler.
+\param period period size in frames.
+\param from engine frame of the first period.
+\param to engine frame to stop at; later triggers are dropped.
+\return engine frame and drum of each trigger, in frame order. */
+inline std::vector<std::pair<int, int>> scheduleFrames(drumpi::SequencerScheduler& sch, int period, int from, int to) {
+    std::vector<std::pair<int, int>> hits;
+    drumpi::audio::EventList events;
+    for (int f = from; f < to; f += period) {
+        events.clear();
+        sch.schedule(f, period, 48000, events);
+        for (int i = 0; i < events.size(); i++) {
+            if (f + events[i].offset < to) hits.push_back({f + events[i].offset, (int)events[i].drum});
+        }
+    }
+    std::sort(hits.begin(), hits.end());
+    return hits;
+}
+
+#endif // define DRUMPI_TEST_SCHEDULE_H
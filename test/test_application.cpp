@@ -5,13 +5,15 @@
 #include <boost/test/unit_test.hpp>
 #include <application.hpp>
 #include <linux/input.h>
+#include <thread>
+#include <chrono>
 
 using namespace std;
 using namespace drumpi;
 
 BOOST_AUTO_TEST_CASE(constructor) {
 	Application app;
-	app.setup();
+	app.setup(audio::BACKEND_NULL);
 
 	BOOST_CHECK(&app);
 
@@ -31,7 +33,7 @@ BOOST_AUTO_TEST_CASE(constructor) {
 
 BOOST_AUTO_TEST_CASE(changing_state) {
 	Application app;
-	app.setup();
+	app.setup(audio::BACKEND_NULL);
 
 	//change state to sequencer mode
 	app.setState(SET_DRUM_VOLUME_MODE);
@@ -45,7 +47,7 @@ BOOST_AUTO_TEST_CASE(changing_state) {
 
 BOOST_AUTO_TEST_CASE(interpreting_key_press) {
 	Application app;
-	app.setup();
+	app.setup(audio::BACKEND_NULL);
 
 	//simulate "v" key being pressed to switch to drum volume set mode
 	app.interpretKeyPress(KEY_V);
@@ -58,7 +60,7 @@ BOOST_AUTO_TEST_CASE(interpreting_key_press) {
 
 BOOST_AUTO_TEST_CASE(interpreting_drum_key) {
 	Application app;
-	app.setup();
+	app.setup(audio::BACKEND_NULL);
 
 	drumID_t testID;
 
@@ -87,7 +89,7 @@ BOOST_AUTO_TEST_CASE(interpreting_drum_key) {
 
 BOOST_AUTO_TEST_CASE(changing_to_SetTempoMode) {
 	Application app;
-	app.setup();
+	app.setup(audio::BACKEND_NULL);
 
 	//simulate "t" key being pressed to switch to SetTempoMode
 	//should do nothing as are in performance mode by default
@@ -118,7 +120,7 @@ BOOST_AUTO_TEST_CASE(changing_to_SetTempoMode) {
 
 BOOST_AUTO_TEST_CASE(sequencer_mode_defaults) {
 	Application app;
-	app.setup();
+	app.setup(audio::BACKEND_NULL);
 
 	//check defaults
 	BOOST_CHECK(app.sequencermode.currentdrum == DRUM_1);
@@ -128,7 +130,7 @@ BOOST_AUTO_TEST_CASE(sequencer_mode_defaults) {
 
 BOOST_AUTO_TEST_CASE(switching_pages_in_sequencer_mode) {
 	Application app;
-	app.setup();
+	app.setup(audio::BACKEND_NULL);
 
 	//switch to sequencer mode
 	app.setState(SEQUENCER_MODE);
@@ -147,7 +149,7 @@ BOOST_AUTO_TEST_CASE(switching_pages_in_sequencer_mode) {
 
 BOOST_AUTO_TEST_CASE(returning_to_sequencer_mode) {
 	Application app;
-	app.setup();
+	app.setup(audio::BACKEND_NULL);
 
 	//switch to sequencer mode
 	app.setState(SEQUENCER_MODE);
@@ -178,7 +180,7 @@ BOOST_AUTO_TEST_CASE(returning_to_sequencer_mode) {
 
 BOOST_AUTO_TEST_CASE(changing_to_SetDrumVolumeMode) {
 	Application app;
-	app.setup();
+	app.setup(audio::BACKEND_NULL);
 
 	//switch to SetDrumVolumeMode from default performance mode
 	app.interpretKeyPress(KEY_V);
@@ -211,3 +213,22 @@ BOOST_AUTO_TEST_CASE(changing_to_SetDrumVolumeMode) {
 	BOOST_CHECK(app.subMode->label == SET_MASTER_VOLUME_MODE);
 	BOOST_CHECK(app.displayState->label == SEQUENCER_MODE);
 }
+
+
+BOOST_AUTO_TEST_CASE(quitting) {
+	Application app;
+	app.setup(audio::BACKEND_NULL);
+
+	// Run on another thread and ask it to quit
+	std::thread t(&Application::run, &app);
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	BOOST_CHECK(app.audioEngine->isRunning());
+
+	app.quit();
+	t.join();
+
+	// Check everything has been shut down
+	BOOST_CHECK(!app.running);
+	BOOST_CHECK(!app.audioEngine->isRunning());
+	BOOST_CHECK(!app.displayClock->isActive());
+}
@@ -6,17 +6,18 @@
 #include <vector>
 #include <thread>
 #include <math.h>
+#include <algorithm>
 
 using namespace drumpi;
 using namespace audio;
 
 class TestCallback : public AudioCallback {
     public:
-        std::vector<sample_t> getSamples(int nSamples) override {
+        void render(sample_t* const* outs, int nOuts, int nFrames) override {
             v.clear();
-            v.resize(nSamples);
+            v.resize(nFrames);
 
-            for(int i = 0; i < nSamples; i++) {
+            for(int i = 0; i < nFrames; i++) {
                 phase += 0.01f;
 
                 if (phase > 1.f) phase -= 1.f;
@@ -24,9 +25,11 @@ class TestCallback : public AudioCallback {
                 v[i] = 0.25f * sinf(2.f * M_PI * phase);
             }
 
-            count++;
+            for (int i = 0; i < nOuts; i++) {
+                std::copy(v.begin(), v.end(), outs[i]);
+            }
 
-            return v;
+            count++;
         }
 
         std::vector<sample_t> v;
@@ -0,0 +1,53 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE AudioStatsTest
+#include <boost/test/unit_test.hpp>
+#include "audioStats.hpp"
+
+#include <sstream>
+
+using namespace drumpi;
+using namespace audio;
+
+BOOST_AUTO_TEST_CASE(empty) {
+    // Tests a fresh object reports nothing
+    AudioStats a;
+    AudioStatsSnapshot s = a.read();
+
+    BOOST_CHECK(s.periods == 0);
+    BOOST_CHECK(s.xruns == 0);
+    BOOST_CHECK(s.maxLoad == 0.f);
+    BOOST_CHECK(s.cpuLoad < 0.f);
+}
+
+BOOST_AUTO_TEST_CASE(loads) {
+    // Tests loads are fractions of the budget and the window rolls
+    AudioStats a;
+
+    // One slow period, then a window's worth of quick ones
+    a.recordPeriod(900, 1000);
+    BOOST_CHECK_CLOSE(a.read().maxLoad, 0.9f, 0.1f);
+
+    for (int i = 0; i < AudioStats::window; i++) a.recordPeriod(i % 100 == 0 ? 500 : 100, 1000);
+
+    AudioStatsSnapshot s = a.read();
+    BOOST_CHECK(s.periods == AudioStats::window + 1);
+    BOOST_CHECK_CLOSE(s.maxLoad, 0.5f, 0.1f);
+    BOOST_CHECK_CLOSE(s.p99Load, 0.5f, 0.1f);
+    BOOST_CHECK_CLOSE(s.lastLoad, 0.1f, 0.1f);
+}
+
+BOOST_AUTO_TEST_CASE(xruns) {
+    // Tests xruns are counted and reset
+    AudioStats a;
+
+    a.recordXrun();
+    a.recordXrun();
+    BOOST_CHECK(a.read().xruns == 2);
+
+    a.reset();
+    BOOST_CHECK(a.read().xruns == 0);
+
+    std::ostringstream os;
+    AudioStats::dump(os, a.read());
+    BOOST_CHECK(os.str().find("xruns=0") != std::string::npos);
+}
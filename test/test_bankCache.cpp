@@ -0,0 +1,64 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE BankCacheTest
+#include <boost/test/unit_test.hpp>
+#include "bankCache.hpp"
+
+#include "defs.hpp"
+
+#include <vector>
+#include <memory>
+
+using namespace drumpi;
+using namespace audio;
+
+// Makes a bank with every drum holding n samples
+std::shared_ptr<const DrumBank> makeBank(int id, int n) {
+    std::shared_ptr<DrumBank> b = std::make_shared<DrumBank>();
+    b->id = id;
+    for (int i = 0; i < NUM_DRUMS; i++) {
+        b->data[i] = std::make_shared<const SampleData>(std::vector<sample_t>(n, 0.f), 48000);
+    }
+    return b;
+}
+
+BOOST_AUTO_TEST_CASE(findsBanks) {
+    // Tests inserted banks are found by ID and type
+    BankCache c;
+    std::shared_ptr<const DrumBank> b = makeBank(1, 16);
+    c.insert(b, SOURCE_PREGENERATED);
+
+    BOOST_CHECK(c.find(1, SOURCE_PREGENERATED) == b);
+    BOOST_CHECK(!c.find(2, SOURCE_PREGENERATED));
+    BOOST_CHECK(!c.find(1, SOURCE_GENERALISED));
+    BOOST_CHECK(c.getBytes() == BankCache::bankBytes(*b));
+}
+
+BOOST_AUTO_TEST_CASE(evictsLeastRecent) {
+    // Tests the least recently used bank goes first when over the bank limit
+    BankCache c(2);
+    c.insert(makeBank(1, 16), SOURCE_PREGENERATED);
+    c.insert(makeBank(2, 16), SOURCE_PREGENERATED);
+    c.find(1, SOURCE_PREGENERATED);
+    c.insert(makeBank(3, 16), SOURCE_PREGENERATED);
+
+    BOOST_CHECK(c.size() == 2);
+    BOOST_CHECK(c.contains(1, SOURCE_PREGENERATED));
+    BOOST_CHECK(!c.contains(2, SOURCE_PREGENERATED));
+    BOOST_CHECK(c.contains(3, SOURCE_PREGENERATED));
+}
+
+BOOST_AUTO_TEST_CASE(keepsToBudget) {
+    // Tests the memory budget is kept, but never by evicting the newest bank
+    size_t bankSize = NUM_DRUMS * 100 * sizeof(sample_t);
+    BankCache c(8, 2 * bankSize);
+    c.insert(makeBank(1, 100), SOURCE_PREGENERATED);
+    c.insert(makeBank(2, 100), SOURCE_PREGENERATED);
+    c.insert(makeBank(3, 100), SOURCE_PREGENERATED);
+
+    BOOST_CHECK(c.size() == 2);
+    BOOST_CHECK(c.getBytes() <= c.getBudget());
+
+    c.setBudget(0);
+    BOOST_CHECK(c.size() == 1);
+    BOOST_CHECK(c.contains(3, SOURCE_PREGENERATED));
+}
@@ -0,0 +1,77 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE CommandQueueTest
+#include <boost/test/unit_test.hpp>
+#include "commandQueue.hpp"
+
+#include <thread>
+#include <vector>
+
+using namespace drumpi;
+
+BOOST_AUTO_TEST_CASE(ordering) {
+    // Test items come out in the order they went in
+    CommandQueue<int, 8> q;
+    int x;
+
+    BOOST_CHECK(!q.pop(x));
+
+    for (int i = 0; i < 5; i++) BOOST_CHECK(q.push(i));
+
+    for (int i = 0; i < 5; i++) {
+        BOOST_CHECK(q.pop(x));
+        BOOST_CHECK(x == i);
+    }
+
+    BOOST_CHECK(!q.pop(x));
+}
+
+BOOST_AUTO_TEST_CASE(full) {
+    // Test pushing to a full queue fails and wrapping around works
+    CommandQueue<int, 4> q;
+    int x;
+
+    for (int i = 0; i < 4; i++) BOOST_CHECK(q.push(i));
+    BOOST_CHECK(!q.push(4));
+
+    BOOST_CHECK(q.pop(x));
+    BOOST_CHECK(x == 0);
+    BOOST_CHECK(q.push(4));
+
+    for (int i = 1; i < 5; i++) {
+        BOOST_CHECK(q.pop(x));
+        BOOST_CHECK(x == i);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(multipleProducers) {
+    // Test no items are lost or duplicated with concurrent producers
+    CommandQueue<int, 1024> q;
+    const int nThreads = 4;
+    const int nItems = 10000;
+    std::vector<std::thread> producers;
+    std::vector<int> counts(nThreads * nItems, 0);
+    int received = 0;
+    int x;
+
+    for (int t = 0; t < nThreads; t++) {
+        producers.emplace_back([&q, t, nItems]() {
+            for (int i = 0; i < nItems; i++) {
+                while (!q.push((t * nItems) + i)) std::this_thread::yield();
+            }
+        });
+    }
+
+    while (received < nThreads * nItems) {
+        if (q.pop(x)) {
+            counts[x]++;
+            received++;
+        }
+    }
+
+    for (int t = 0; t < nThreads; t++) producers[t].join();
+
+    bool error = false;
+    for (int i = 0; i < counts.size(); i++) error = error || (counts[i] != 1);
+
+    BOOST_CHECK(!error);
+}
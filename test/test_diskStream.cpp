@@ -0,0 +1,186 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE DiskStreamTest
+#include <boost/test/unit_test.hpp>
+#include "diskStream.hpp"
+#include "sampleCache.hpp"
+#include "voice.hpp"
+#include "testFiles.hpp"
+
+#include "defs.hpp"
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <cmath>
+#include <thread>
+#include <chrono>
+
+using namespace drumpi;
+using namespace audio;
+
+/*! Frames kept in memory by the streamed clips under test. */
+const int headFrames = 256;
+/*! Frames per period. */
+const int period = 128;
+
+BOOST_AUTO_TEST_CASE(streamsLikeResident) {
+    // Tests a streamed voice plays the same samples as a resident one
+    std::string copy = copyTestFile("drumpi_test_stream");
+    AudioClip resident(copy);
+    StreamedClip streamed(copy, 0, SAMPLE_FLOAT32, 0, headFrames);
+    BOOST_REQUIRE(resident.getData());
+    BOOST_REQUIRE(streamed.isStreamed());
+    BOOST_CHECK(streamed.getData()->size() == headFrames);
+    BOOST_CHECK(streamed.getData()->getLength() == resident.getData()->size());
+
+    // Small rings, refilled by hand in place of the I/O thread
+    DiskStreamer streamer(2, 1024);
+    streamer.allocate();
+    Voice a, b;
+    b.setStreamer(&streamer);
+    a.start(DRUM_1, resident.getData(), 1);
+    b.start(DRUM_1, streamed.getData(), 2);
+    BOOST_CHECK(streamer.numActive() == 1);
+
+    std::vector<sample_t> bufA(period), bufB(period);
+    sample_t* outA = bufA.data();
+    sample_t* outB = bufB.data();
+    bool same = true;
+
+    while (a.isActive()) {
+        streamer.service();
+        std::fill(bufA.begin(), bufA.end(), 0.f);
+        std::fill(bufB.begin(), bufB.end(), 0.f);
+        a.mix(&outA, 1, period, 1.f);
+        b.mix(&outB, 1, period, 1.f);
+        same = same && bufA == bufB;
+    }
+
+    BOOST_CHECK(same);
+    BOOST_CHECK(!b.isActive());
+    BOOST_CHECK(streamer.getUnderruns() == 0);
+
+    // The slot is recycled on the next pass
+    streamer.service();
+    BOOST_CHECK(streamer.numActive() == 0);
+
+    removeCopy(copy);
+}
+
+BOOST_AUTO_TEST_CASE(underrunPlaysSilence) {
+    // Tests a voice whose ring is never filled plays its head, then silence,
+    // and counts underruns
+    std::string copy = copyTestFile("drumpi_test_stream");
+    StreamedClip streamed(copy, 0, SAMPLE_FLOAT32, 0, headFrames);
+    BOOST_REQUIRE(streamed.isStreamed());
+
+    DiskStreamer streamer(1, 1024);
+    streamer.allocate();
+    Voice v;
+    v.setStreamer(&streamer);
+    v.start(DRUM_1, streamed.getData(), 1);
+
+    std::vector<sample_t> buf(2 * headFrames, 0.f);
+    sample_t* out = buf.data();
+    v.mix(&out, 1, 2 * headFrames, 1.f);
+
+    // The head, mixed down to the one output
+    std::shared_ptr<const SampleData> d = streamed.getData();
+    std::vector<sample_t> head(headFrames, 0.f);
+    for (int c = 0; c < d->getNumChannels(); c++) d->mix(c, 0, head.data(), 1.f / d->getNumChannels(), headFrames);
+    BOOST_CHECK(std::equal(head.begin(), head.end(), buf.begin()));
+
+    bool silent = true;
+    for (int i = headFrames; i < 2 * headFrames; i++) silent = silent && buf[i] == 0.f;
+    BOOST_CHECK(silent);
+    BOOST_CHECK(streamer.getUnderruns() == 1);
+    BOOST_CHECK(v.isActive());
+
+    // With the only slot taken a second voice plays just the head
+    Voice w;
+    w.setStreamer(&streamer);
+    w.start(DRUM_2, streamed.getData(), 2);
+    BOOST_CHECK(streamer.getUnderruns() == 2);
+    std::fill(buf.begin(), buf.end(), 0.f);
+    w.mix(&out, 1, 2 * headFrames, 1.f);
+    BOOST_CHECK(!w.isActive());
+
+    removeCopy(copy);
+}
+
+BOOST_AUTO_TEST_CASE(ioThreadWakes) {
+    // Tests the I/O thread only runs once started, and keeps a voice fed
+    // from the audio side's signals alone
+    std::string copy = copyTestFile("drumpi_test_stream");
+    AudioClip resident(copy);
+    StreamedClip streamed(copy, 0, SAMPLE_FLOAT32, 0, headFrames);
+    BOOST_REQUIRE(streamed.isStreamed());
+
+    DiskStreamer streamer(1, 1024);
+    Voice v;
+    v.setStreamer(&streamer);
+    BOOST_CHECK(!streamer.isRunning());
+
+    // Nothing to stream into before the rings exist
+    v.start(DRUM_1, streamed.getData(), 1);
+    BOOST_CHECK(streamer.numActive() == 0);
+    BOOST_CHECK(streamer.getUnderruns() == 1);
+
+    streamer.start();
+    BOOST_CHECK(streamer.isRunning());
+
+    Voice a, b;
+    b.setStreamer(&streamer);
+    a.start(DRUM_1, resident.getData(), 1);
+    b.start(DRUM_1, streamed.getData(), 2);
+
+    std::vector<sample_t> bufA(period), bufB(period);
+    sample_t* outA = bufA.data();
+    sample_t* outB = bufB.data();
+    bool same = true;
+
+    // A few ms a period gives the thread ample time to refill
+    while (a.isActive()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        std::fill(bufA.begin(), bufA.end(), 0.f);
+        std::fill(bufB.begin(), bufB.end(), 0.f);
+        a.mix(&outA, 1, period, 1.f);
+        b.mix(&outB, 1, period, 1.f);
+        same = same && bufA == bufB;
+    }
+
+    BOOST_CHECK(same);
+    BOOST_CHECK(streamer.getUnderruns() == 1);
+
+    streamer.stop();
+    BOOST_CHECK(!streamer.isRunning());
+
+    removeCopy(copy);
+}
+
+BOOST_AUTO_TEST_CASE(rendersOffline) {
+    // Tests rendering a streamed clip reads the whole file, and short clips
+    // are loaded whole
+    std::string copy = copyTestFile("drumpi_test_stream");
+    AudioClip resident(copy);
+    StreamedClip streamed(copy, 0, SAMPLE_INT16, 0, headFrames);
+    StreamedClip whole(copy, 0, SAMPLE_FLOAT32, 1 << 30, headFrames);
+    BOOST_REQUIRE(streamed.isStreamed());
+    BOOST_CHECK(!whole.isStreamed());
+    BOOST_CHECK(whole.getData()->size() == resident.getData()->size());
+
+    int n = resident.getData()->size() + period;
+    std::vector<sample_t> r = resident.getSamples(n);
+    std::vector<sample_t> s = streamed.getSamples(n);
+
+    // Stored as 16-bit, so within half a step
+    bool close = true;
+    for (int i = 0; i < n; i++) close = close && std::abs(r[i] - s[i]) <= 0.5f / 32768.f + 1e-7f;
+    BOOST_CHECK(close);
+    BOOST_CHECK(streamed.getStatus() == SOURCE_FINISHED);
+
+    removeCopy(copy);
+    SampleCache cache;
+    std::remove(cache.getCachePath(copy, 0, SAMPLE_INT16).data());
+}
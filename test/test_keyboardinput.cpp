@@ -6,6 +6,13 @@
 #include <keyboardinput.hpp>
 #include <application.hpp>
 
+#include <vector>
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <sys/stat.h>
+
 using namespace drumpi;
 
 //Check the keyboard input file can be successfully opened
@@ -18,7 +25,7 @@ BOOST_AUTO_TEST_CASE(Open_Input_File) {
 //Check the KeyboardInput class can call the Application interpretKeyPress method
 BOOST_AUTO_TEST_CASE(application_callback) {
 	Application app;
-	app.setup();
+	app.setup(audio::BACKEND_NULL);
 	
 	BOOST_CHECK(app.mode->label == PERFORMANCE_MODE);
 	BOOST_CHECK(app.subMode->label == SET_MASTER_VOLUME_MODE);
@@ -28,3 +35,65 @@ BOOST_AUTO_TEST_CASE(application_callback) {
 	BOOST_CHECK(app.mode->label == PERFORMANCE_MODE);
 	BOOST_CHECK(app.subMode->label == SET_DRUM_VOLUME_MODE);
 }
+
+
+/*! Records the keys it is passed. */
+class KeyRecorder : public ApplicationCallback {
+public:
+	void interpretKeyPress(int key) override { keys.push_back(key); numKeys++; }
+	void setState(stateLabel_t newstate) override {}
+	void quit() override { running = false; }
+
+	std::vector<int> keys;
+	std::atomic<int> numKeys{0};
+};
+
+//Check events from several devices are read in batches and only key presses are passed on
+BOOST_AUTO_TEST_CASE(reads_multiple_devices) {
+	std::string fifo1 = "/tmp/drumpi_test_kbd1_" + std::to_string(getpid());
+	std::string fifo2 = "/tmp/drumpi_test_kbd2_" + std::to_string(getpid());
+	mkfifo(fifo1.c_str(), 0600);
+	mkfifo(fifo2.c_str(), 0600);
+
+	KeyboardInput kbd({fifo1, fifo2, "/nonexistent/device"});
+	KeyRecorder rec;
+	rec.running = true;
+	kbd.connectCallback(&rec);
+	BOOST_CHECK(kbd.getNumDevices() == 2);
+
+	int w1 = open(fifo1.c_str(), O_WRONLY);
+	int w2 = open(fifo2.c_str(), O_WRONLY);
+
+	std::thread t(&KeyboardInput::pollInput, &kbd);
+
+	// Press and release A, then press S, in one write
+	struct input_event ev[3] = {};
+	ev[0].type = EV_KEY; ev[0].code = KEY_A; ev[0].value = 1;
+	ev[1].type = EV_KEY; ev[1].code = KEY_A; ev[1].value = 0;
+	ev[2].type = EV_KEY; ev[2].code = KEY_S; ev[2].value = 1;
+	BOOST_CHECK(write(w1, ev, sizeof(ev)) == sizeof(ev));
+
+	// ESC from the second keyboard
+	ev[0].code = KEY_ESC;
+	BOOST_CHECK(write(w2, ev, sizeof(ev[0])) == sizeof(ev[0]));
+
+	for (int i = 0; i < 200 && rec.numKeys < 3; i++) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+	}
+
+	kbd.stop();
+	t.join();
+
+	BOOST_REQUIRE(rec.keys.size() == 3);
+	// Devices may be served in either order, but each keeps its own order
+	rec.keys.erase(std::remove(rec.keys.begin(), rec.keys.end(), KEY_ESC), rec.keys.end());
+	BOOST_REQUIRE(rec.keys.size() == 2);
+	BOOST_CHECK(rec.keys[0] == KEY_A);
+	BOOST_CHECK(rec.keys[1] == KEY_S);
+	BOOST_CHECK(!rec.running);
+
+	close(w1);
+	close(w2);
+	unlink(fifo1.c_str());
+	unlink(fifo2.c_str());
+}
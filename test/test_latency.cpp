@@ -0,0 +1,49 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE LatencyTest
+#include <boost/test/unit_test.hpp>
+#include "latency.hpp"
+
+#include <sstream>
+
+using namespace drumpi;
+using namespace audio;
+
+BOOST_AUTO_TEST_CASE(percentiles) {
+    // Tests percentiles are within the histogram's resolution
+    LatencyHistogram h;
+
+    for (int i = 1; i <= 1000; i++) h.record(i * 1000LL); // 1 to 1000 us
+
+    BOOST_CHECK(h.count() == 1000);
+    BOOST_CHECK(h.max() == 1000);
+    BOOST_CHECK_CLOSE((double)h.percentile(0.5), 500.0, 7.0);
+    BOOST_CHECK_CLOSE((double)h.percentile(0.99), 990.0, 7.0);
+    BOOST_CHECK(h.percentile(1.0) == 1000);
+    BOOST_CHECK(h.percentile(0.01) == 10);
+    BOOST_CHECK_CLOSE(h.mean(), 500.5, 0.1);
+}
+
+BOOST_AUTO_TEST_CASE(clampsAndResets) {
+    // Tests negative durations count as zero and reset empties the histogram
+    LatencyHistogram h;
+
+    h.record(-5000);
+    BOOST_CHECK(h.count() == 1);
+    BOOST_CHECK(h.percentile(0.5) == 0);
+
+    h.reset();
+    BOOST_CHECK(h.count() == 0);
+    BOOST_CHECK(h.percentile(0.5) == 0);
+}
+
+BOOST_AUTO_TEST_CASE(dumps) {
+    // Tests every histogram appears in the summary
+    LatencyStats s;
+    std::ostringstream os;
+
+    s.inputToOutput.record(2000000);
+    s.dump(os);
+
+    BOOST_CHECK(os.str().find("input -> trigger: n=0") != std::string::npos);
+    BOOST_CHECK(os.str().find("input -> output: n=1") != std::string::npos);
+}
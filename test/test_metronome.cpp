@@ -3,6 +3,9 @@
 #include <boost/test/unit_test.hpp>
 #include <clock.hpp>
 #include <thread>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
 
 using namespace drumpi;
 using namespace clock;
@@ -12,6 +15,22 @@ class TestMetronome : public Metronome {
         void tick() override {}
 };
 
+/*! Records the time of each tick. */
+class TimedMetronome : public Metronome {
+    public:
+        static const int maxTicks = 256;
+        int64_t times[maxTicks];
+        std::atomic<int> n{0};
+        ~TimedMetronome() {
+            stop();
+        }
+        void tick() override {
+            int i = n;
+            if (i < maxTicks) times[i] = now();
+            n = i + 1;
+        }
+};
+
 BOOST_AUTO_TEST_CASE(constructors) {
     // Test for NULL object pointers
     TestMetronome m1;
@@ -37,4 +56,93 @@ BOOST_AUTO_TEST_CASE(setRateBpm) {
 
     BOOST_CHECK(m.getRateBPM() == bpm);
     BOOST_CHECK(m.getRate() == ms);
-}
\ No newline at end of file
+}
+
+BOOST_AUTO_TEST_CASE(fractionalBpm) {
+    // Test fractional BPM is kept, and converts to ns without rounding
+    TestMetronome m;
+    m.setRateBPM(122.5);
+
+    BOOST_CHECK(m.getRateBPM() == 122.5);
+    BOOST_CHECK(std::abs(bpmToNs(488) - 60e9 / 488) < 1e-3);
+}
+
+BOOST_AUTO_TEST_CASE(noDriftOverTenMinutes) {
+    // Test beat times over 10 minutes, with a tempo change halfway, stay on
+    // the exact times. Whole ms periods would be over 4 s out at 488 BPM.
+    TempoGrid g;
+    g.reset(0);
+
+    double p1 = bpmToNs(488.);
+    double p2 = bpmToNs(500.25);
+    int half1 = (int)(300e9 / p1);
+    int half2 = (int)(300e9 / p2);
+
+    g.setPeriod(p1);
+    for (int i = 0; i < half1; i++) g.advance();
+    BOOST_CHECK(std::abs(g.getDeadline() - half1 * p1) <= 1.);
+
+    // The beat the tempo changes on keeps its time
+    int64_t boundary = g.getDeadline();
+    g.setPeriod(p2);
+    BOOST_CHECK(g.getDeadline() == boundary);
+
+    for (int i = 0; i < half2; i++) g.advance();
+    BOOST_CHECK(std::abs(g.getDeadline() - (half1 * p1 + half2 * p2)) <= 1.);
+}
+
+BOOST_AUTO_TEST_CASE(realTimeDrift) {
+    // Test a running metronome keeps to a tempo that is not a whole number
+    // of ms: 2929 BPM is 20.48 ms, 0.48 ms a beat from its rounded period
+    TimedMetronome m;
+    int beats = 40;
+    m.setRateBPM(2929);
+    m.start();
+
+    while (m.n < beats) std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    m.stop();
+
+    double elapsed = (double)(m.times[beats - 1] - m.times[0]);
+    double expected = (beats - 1) * bpmToNs(2929);
+    BOOST_CHECK(std::abs(elapsed - expected) < 3e6);
+}
+
+BOOST_AUTO_TEST_CASE(tempoChangeAtBeat) {
+    // Test a tempo change takes effect from the next beat, without an extra
+    // tick or a reset of the phase
+    TimedMetronome m;
+    m.setRateBPM(1200); // 50 ms
+    m.start();
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(75));
+    BOOST_CHECK(m.n == 2);
+    m.setRateBPM(600); // 100 ms
+
+    // Beat 2 still falls 50 ms after beat 1, then the beats are 100 ms apart
+    while (m.n < 4) std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    m.stop();
+
+    BOOST_CHECK(std::abs((double)(m.times[2] - m.times[1]) - 50e6) < 3e6);
+    BOOST_CHECK(std::abs((double)(m.times[3] - m.times[2]) - 100e6) < 3e6);
+}
+
+BOOST_AUTO_TEST_CASE(restartWhileRunning) {
+    // Test restarting and changing tempo from another thread while beats run
+    TimedMetronome m;
+    m.setRateBPM(6000);
+    m.start();
+
+    double bpm = 6000;
+    for (int i = 0; i < 100; i++) {
+        bpm = (i % 2) ? 6000 : 4000;
+        m.setRateBPM(bpm);
+        if (i % 10 == 0) m.start();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(40));
+    m.stop();
+
+    BOOST_CHECK(m.n > 10);
+    BOOST_CHECK(m.getRateBPM() == bpm);
+    BOOST_CHECK(m.getRate() == bpmToMs(bpm));
+}
@@ -0,0 +1,99 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE MixerTest
+#include <boost/test/unit_test.hpp>
+#include "mixer.hpp"
+
+#include <vector>
+#include <cstdlib>
+#include <cmath>
+
+using namespace drumpi;
+using namespace audio;
+
+BOOST_AUTO_TEST_CASE(mixGainMatchesScalar) {
+    // Test the vectorised kernel against the scalar reference, including
+    // lengths that leave a remainder
+    for (int n = 0; n < 70; n++) {
+        std::vector<sample_t> in(n), a(n), b(n);
+        for (int i = 0; i < n; i++) {
+            in[i] = float(rand()) / float(RAND_MAX) - 0.5f;
+            a[i] = b[i] = float(rand()) / float(RAND_MAX) - 0.5f;
+        }
+
+        mixGain(a.data(), in.data(), 0.3f, n);
+        mixGainScalar(b.data(), in.data(), 0.3f, n);
+
+        bool error = false;
+        for (int i = 0; i < n; i++) error = error || (std::fabs(a[i] - b[i]) > 1e-6f);
+        BOOST_CHECK(!error);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(fanOutCopies) {
+    // Test every output receives an exact copy
+    int n = 131;
+    std::vector<sample_t> in(n), l(n, 0.f), r(n, 0.f), c(n, 0.f);
+    sample_t* outs[3] = {l.data(), r.data(), c.data()};
+    for (int i = 0; i < n; i++) in[i] = float(i);
+
+    fanOut(outs, 3, in.data(), n);
+
+    BOOST_CHECK(l == in);
+    BOOST_CHECK(r == in);
+    BOOST_CHECK(c == in);
+}
+
+BOOST_AUTO_TEST_CASE(mixGainInt16MatchesScalar) {
+    // Test the converting kernel against the scalar reference, across the
+    // full integer range
+    for (int n = 0; n < 70; n++) {
+        std::vector<int16_t> in(n);
+        std::vector<sample_t> a(n), b(n);
+        for (int i = 0; i < n; i++) {
+            in[i] = (int16_t)(rand() % 65536 - 32768);
+            a[i] = b[i] = float(rand()) / float(RAND_MAX) - 0.5f;
+        }
+        if (n > 1) {
+            in[0] = -32768;
+            in[1] = 32767;
+        }
+
+        mixGainInt16(a.data(), in.data(), 0.3f * int16Scale, n);
+        mixGainInt16Scalar(b.data(), in.data(), 0.3f * int16Scale, n);
+
+        bool error = false;
+        for (int i = 0; i < n; i++) error = error || (std::fabs(a[i] - b[i]) > 1e-6f);
+        BOOST_CHECK(!error);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(mixGainRampMatchesScalar) {
+    // Test the ramped kernels against the scalar references, and that a ramp
+    // ends where it should
+    for (int n = 0; n < 70; n++) {
+        std::vector<sample_t> in(n), a(n), b(n);
+        std::vector<int16_t> in16(n);
+        std::vector<sample_t> c(n), d(n);
+        for (int i = 0; i < n; i++) {
+            in[i] = float(rand()) / float(RAND_MAX) - 0.5f;
+            in16[i] = (int16_t)(rand() % 65536 - 32768);
+            a[i] = b[i] = c[i] = d[i] = float(rand()) / float(RAND_MAX) - 0.5f;
+        }
+
+        mixGainRamp(a.data(), in.data(), 0.8f, -0.01f, n);
+        mixGainRampScalar(b.data(), in.data(), 0.8f, -0.01f, n);
+        mixGainRampInt16(c.data(), in16.data(), 0.8f * int16Scale, -0.01f * int16Scale, n);
+        mixGainRampInt16Scalar(d.data(), in16.data(), 0.8f * int16Scale, -0.01f * int16Scale, n);
+
+        bool error = false;
+        for (int i = 0; i < n; i++) {
+            error = error || (std::fabs(a[i] - b[i]) > 1e-6f) || (std::fabs(c[i] - d[i]) > 1e-6f);
+        }
+        BOOST_CHECK(!error);
+    }
+
+    std::vector<sample_t> ones(64, 1.f), out(64, 0.f);
+    mixGainRamp(out.data(), ones.data(), 0.f, 1.f / 64.f, 64);
+    BOOST_CHECK(out[0] == 0.f);
+    BOOST_CHECK(std::fabs(out[63] - 63.f / 64.f) < 1e-6f);
+}
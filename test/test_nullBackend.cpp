@@ -0,0 +1,92 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE NullBackendTest
+#include <boost/test/unit_test.hpp>
+#include "nullBackend.hpp"
+#include "playback.hpp"
+
+#include <thread>
+#include <atomic>
+
+using namespace drumpi;
+using namespace audio;
+
+class CountingCallback : public AudioCallback {
+    public:
+        void render(sample_t* const* outs, int nOuts, int nFrames) override {
+            frames += nFrames;
+            ports = nOuts;
+        }
+
+        void prepare(int sampleRate, int bufferSize) override {
+            rate = sampleRate;
+        }
+
+        std::atomic<long> frames{0};
+        std::atomic<int> ports{0};
+        int rate = 0;
+};
+
+BOOST_AUTO_TEST_CASE(startStop) {
+    NullBackend b(48000, 128, 2);
+    CountingCallback c;
+
+    BOOST_CHECK(b.isOpen());
+    BOOST_CHECK(!b.isRunning());
+    BOOST_CHECK(b.getSampleRate() == 48000);
+    BOOST_CHECK(b.getBufferSize() == 128);
+
+    BOOST_CHECK(b.start(c) == NO_ERROR);
+    BOOST_CHECK(b.isRunning());
+    BOOST_CHECK(c.rate == 48000);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    BOOST_CHECK(b.stop() == NO_ERROR);
+    BOOST_CHECK(!b.isRunning());
+    BOOST_CHECK(!b.isOpen());
+
+    // Paced to the sample rate: roughly 9600 frames in 200 ms
+    BOOST_CHECK(c.frames > 4800);
+    BOOST_CHECK(c.frames < 19200);
+    BOOST_CHECK(c.ports == 2);
+
+    // Every callback is timed
+    AudioStatsSnapshot s = b.getStats();
+    BOOST_CHECK(s.periods * 128 == c.frames);
+    BOOST_CHECK(s.maxLoad < 1.f);
+}
+
+BOOST_AUTO_TEST_CASE(freeRunning) {
+    // Without pacing the backend runs far faster than real time
+    NullBackend b(48000, 128, 2, false);
+    PlaybackEngine p;
+    p.loadBank(1, SOURCE_PREGENERATED);
+
+    b.start(p);
+    p.trigger(DRUM_1);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    b.stop();
+
+    BOOST_CHECK(b.getNumPeriods() * 128 > 4800);
+    BOOST_CHECK(p.getFrameTime() == b.getNumPeriods() * 128);
+}
+
+BOOST_AUTO_TEST_CASE(measuresLatency) {
+    // Tests triggers are stamped with the output time of their period
+    NullBackend b(48000, 128, 2);
+    PlaybackEngine p;
+    p.loadBank(1, SOURCE_PREGENERATED);
+
+    b.start(p);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    p.trigger(DRUM_1, monotonicTime() - 1000000); // Input 1 ms ago
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    b.stop();
+
+    LatencyStats& s = p.getLatencyStats();
+    BOOST_CHECK(s.triggerToOutput.count() == 1);
+    BOOST_CHECK(s.inputToOutput.count() == 1);
+    BOOST_CHECK(s.inputToTrigger.percentile(0.5) >= 1000);
+    // Within a couple of periods of 2.7 ms, allowing for scheduling jitter
+    BOOST_CHECK(s.triggerToOutput.max() < 20000);
+}
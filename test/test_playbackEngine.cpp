@@ -3,6 +3,12 @@
 #include <boost/test/unit_test.hpp>
 #include "playback.hpp"
 
+#include <cmath>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include <chrono>
+
 using namespace drumpi;
 using namespace audio;
 
@@ -15,6 +21,18 @@ BOOST_AUTO_TEST_CASE(constructors) {
     BOOST_CHECK(&p2);
 }
 
+BOOST_AUTO_TEST_CASE(streamsOnlyWhenOn) {
+    // Tests the disk I/O thread only runs while streaming is on
+    PlaybackEngine p;
+    BOOST_CHECK(!p.getStreamer().isRunning());
+
+    p.setStreamThreshold(1.f);
+    BOOST_CHECK(p.getStreamer().isRunning());
+
+    p.setStreamThreshold(0.f);
+    BOOST_CHECK(!p.getStreamer().isRunning());
+}
+
 BOOST_AUTO_TEST_CASE(volumes) {
     // Test the volume setters and getters
     PlaybackEngine p;
@@ -83,3 +101,165 @@ BOOST_AUTO_TEST_CASE(triggerSource) {
     a = p.getActive();
     BOOST_CHECK(a.empty());
 }
+
+BOOST_AUTO_TEST_CASE(rendersToOutputs) {
+    // Tests rendering into caller-provided buffers, including periods longer
+    // than the internal block size, puts a centred drum on both outputs
+    PlaybackEngine p;
+    int n = 3000;
+    std::vector<sample_t> l(n, 1.f);
+    std::vector<sample_t> r(n, -1.f);
+    sample_t* outs[2] = {l.data(), r.data()};
+    p.loadBank(1, SOURCE_PREGENERATED);
+
+    p.trigger(DRUM_1);
+    p.render(outs, 2, n);
+
+    sample_t max = 0.f;
+    bool equal = true;
+    for (int i = 0; i < n; i++) {
+        max = std::max(max, std::fabs(l[i]));
+        equal = equal && (l[i] == r[i]);
+    }
+
+    BOOST_CHECK(max != 0.f);
+    BOOST_CHECK(equal);
+}
+
+BOOST_AUTO_TEST_CASE(extraOutputs) {
+    // Tests outputs past the main pair repeat it, and outputs past the
+    // direct outputs are cleared
+    PlaybackEngine p;
+    int n = 256;
+    int nOuts = PlaybackEngine::numDirectOuts + 1;
+    std::vector<std::vector<sample_t>> bufs(nOuts, std::vector<sample_t>(n, 1.f));
+    std::vector<sample_t*> outs(nOuts);
+    for (int i = 0; i < nOuts; i++) outs[i] = bufs[i].data();
+    p.loadBank(1, SOURCE_PREGENERATED);
+
+    p.setPan(DRUM_1, -50);
+    p.trigger(DRUM_1);
+    p.render(outs.data(), 5, n);
+
+    BOOST_CHECK(bufs[0] != bufs[1]);
+    BOOST_CHECK(bufs[2] == bufs[0]);
+    BOOST_CHECK(bufs[3] == bufs[1]);
+    BOOST_CHECK(bufs[4] == bufs[0]);
+
+    p.setDirectOuts(true);
+    p.render(outs.data(), nOuts, n);
+
+    bool silent = true;
+    for (int i = 0; i < n; i++) silent = silent && bufs[nOuts - 1][i] == 0.f;
+    BOOST_CHECK(silent);
+}
+
+BOOST_AUTO_TEST_CASE(panAndDirectOuts) {
+    // Tests a panned drum leaves the far side silent, and direct outputs
+    // carry each drum on its own pair
+    PlaybackEngine p;
+    int n = 256;
+    int nOuts = PlaybackEngine::numDirectOuts;
+    std::vector<std::vector<sample_t>> bufs(nOuts, std::vector<sample_t>(n));
+    std::vector<sample_t*> outs(nOuts);
+    for (int i = 0; i < nOuts; i++) outs[i] = bufs[i].data();
+    p.loadBank(1, SOURCE_PREGENERATED);
+
+    p.setPan(DRUM_1, -150);
+    BOOST_CHECK(p.getPan(DRUM_1) == -100);
+    p.trigger(DRUM_1);
+    p.render(outs.data(), 2, n);
+
+    sample_t maxL = 0.f, maxR = 0.f;
+    for (int i = 0; i < n; i++) {
+        maxL = std::max(maxL, std::fabs(bufs[0][i]));
+        maxR = std::max(maxR, std::fabs(bufs[1][i]));
+    }
+    BOOST_CHECK(maxL != 0.f);
+    BOOST_CHECK(maxR == 0.f);
+
+    p.setDirectOuts(true);
+    BOOST_CHECK(p.getDirectOuts());
+    p.untrigger(DRUM_1);
+    p.trigger(DRUM_2);
+    p.render(outs.data(), nOuts, n);
+
+    std::vector<sample_t> peak(nOuts, 0.f);
+    for (int o = 0; o < nOuts; o++) {
+        for (int i = 0; i < n; i++) peak[o] = std::max(peak[o], std::fabs(bufs[o][i]));
+    }
+    BOOST_CHECK(peak[0] != 0.f);
+    BOOST_CHECK(peak[2 + 2 * DRUM_2] != 0.f);
+    BOOST_CHECK(peak[3 + 2 * DRUM_2] != 0.f);
+    BOOST_CHECK(peak[2 + 2 * DRUM_1] == 0.f);
+}
+
+BOOST_AUTO_TEST_CASE(overlappingHits) {
+    // Tests retriggering a drum adds a voice instead of cutting it off
+    PlaybackEngine p(8);
+    int n = 64;
+    p.loadBank(1, SOURCE_PREGENERATED);
+
+    BOOST_CHECK(p.getNumVoices() == 8);
+
+    p.trigger(DRUM_1);
+    p.getSamples(n);
+    p.trigger(DRUM_1);
+    p.getSamples(n);
+    BOOST_CHECK(p.getNumActiveVoices() == 2);
+
+    p.setStealPolicy(STEAL_SAME_DRUM);
+    BOOST_CHECK(p.getStealPolicy() == STEAL_SAME_DRUM);
+    p.trigger(DRUM_1);
+    p.getSamples(n);
+    BOOST_CHECK(p.getNumActiveVoices() == 1);
+}
+
+BOOST_AUTO_TEST_CASE(swapsBanks) {
+    // Tests background bank loads publish good banks, keep the current bank
+    // on failure, and never disturb a render running alongside them
+    PlaybackEngine p;
+    std::atomic<bool> running(true);
+    BOOST_REQUIRE(p.loadBank(1, SOURCE_PREGENERATED) == SOURCE_READY);
+    BOOST_CHECK(p.getBank() == 1);
+
+    std::thread audio([&p, &running] {
+        std::vector<sample_t> out(128);
+        sample_t* outs[1] = {out.data()};
+        while (running) {
+            p.trigger(DRUM_1);
+            p.render(outs, 1, out.size());
+        }
+    });
+
+    for (int i = 0; i < 20; i++) {
+        p.requestBank(1, SOURCE_PREGENERATED);
+        while (p.isLoading()) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        BOOST_CHECK(p.getLoadStatus() == SOURCE_READY);
+    }
+
+    p.requestBank(-1, SOURCE_PREGENERATED);
+    while (p.isLoading()) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    BOOST_CHECK(p.getLoadStatus() != SOURCE_READY);
+    BOOST_CHECK(p.getBank() == 1);
+    BOOST_CHECK(p.getSourceStatus(DRUM_1) == SOURCE_READY);
+
+    running = false;
+    audio.join();
+}
+
+BOOST_AUTO_TEST_CASE(preloadsNeighbours) {
+    // Tests a requested bank is cached along with the banks either side
+    PlaybackEngine p;
+
+    p.requestBank(2, SOURCE_PREGENERATED);
+    while (p.isLoading()) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    for (int i = 0; i < 1000 && !p.getBankCache().contains(1, SOURCE_PREGENERATED); i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+
+    BOOST_CHECK(p.getBank() == 2);
+    BOOST_CHECK(p.getBankCache().contains(2, SOURCE_PREGENERATED));
+    BOOST_CHECK(p.getBankCache().contains(3, SOURCE_PREGENERATED));
+    BOOST_CHECK(p.getBankCache().contains(1, SOURCE_PREGENERATED));
+}
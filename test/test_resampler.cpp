@@ -0,0 +1,62 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE ResamplerTest
+#include <boost/test/unit_test.hpp>
+#include "resampler.hpp"
+
+#include <vector>
+#include <cmath>
+
+using namespace drumpi;
+using namespace audio;
+
+// Generates a sine wave
+std::vector<sample_t> sine(float freq, int rate, int n) {
+    std::vector<sample_t> v(n);
+    for (int i = 0; i < n; i++) v[i] = sinf(2.f * float(M_PI) * freq * i / rate);
+    return v;
+}
+
+// Largest difference from a sine wave, away from the ends
+float sineError(const std::vector<sample_t>& v, float freq, int rate) {
+    float error = 0.f;
+    for (int i = 200; i < (int)v.size() - 200; i++) {
+        error = std::max(error, std::fabs(v[i] - sinf(2.f * float(M_PI) * freq * i / rate)));
+    }
+    return error;
+}
+
+BOOST_AUTO_TEST_CASE(lengths) {
+    // Test the output length follows the ratio
+    Resampler up(44100, 48000);
+    Resampler down(48000, 44100);
+
+    BOOST_CHECK(up.getOutputLength(44100) == 48000);
+    BOOST_CHECK(down.getOutputLength(48000) == 44100);
+    BOOST_CHECK(up.getOutputLength(1) == 2);
+
+    std::vector<sample_t> in(441, 0.f);
+    BOOST_CHECK(up.process(in.data(), in.size()).size() == 480);
+}
+
+BOOST_AUTO_TEST_CASE(keepsPitch) {
+    // Test a tone keeps its frequency and level through conversion
+    std::vector<sample_t> in = sine(1000.f, 44100, 4410);
+
+    Resampler up(44100, 48000);
+    BOOST_CHECK(sineError(up.process(in.data(), in.size()), 1000.f, 48000) < 1e-3f);
+
+    Resampler down(44100, 32000);
+    BOOST_CHECK(sineError(down.process(in.data(), in.size()), 1000.f, 32000) < 1e-3f);
+}
+
+BOOST_AUTO_TEST_CASE(rejectsAliases) {
+    // Test a tone above the output Nyquist frequency is filtered out
+    std::vector<sample_t> in = sine(20000.f, 48000, 4800);
+
+    Resampler down(48000, 22050);
+    std::vector<sample_t> out = down.process(in.data(), in.size());
+
+    float peak = 0.f;
+    for (int i = 200; i < (int)out.size() - 200; i++) peak = std::max(peak, std::fabs(out[i]));
+    BOOST_CHECK(peak < 1e-3f);
+}
@@ -0,0 +1,173 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE SampleCacheTest
+#include <boost/test/unit_test.hpp>
+#include "sampleCache.hpp"
+#include "mixer.hpp"
+#include "testFiles.hpp"
+
+#include "defs.hpp"
+
+#include <string>
+#include <fstream>
+#include <cstdio>
+#include <cmath>
+#include <vector>
+#include <thread>
+#include <algorithm>
+#include <glob.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#include <AudioFile.h>
+
+using namespace drumpi;
+using namespace audio;
+
+std::string fp = std::string(DRUMPI_DIR).append("test/test_audio_file.wav");
+
+BOOST_AUTO_TEST_CASE(writesCache) {
+    // Tests loading a file creates its cache file
+    SampleCache cache;
+    std::string copy = copyTestFile("drumpi_test_cache");
+
+    std::shared_ptr<const SampleData> data = cache.load(copy);
+    BOOST_REQUIRE(data);
+
+    std::ifstream f(cache.getCachePath(copy));
+    BOOST_CHECK(f.good());
+
+    removeCopy(copy);
+}
+
+BOOST_AUTO_TEST_CASE(matchesDecode) {
+    // Tests cached samples match a direct decode, on first and second load
+    SampleCache cache;
+    std::string copy = copyTestFile("drumpi_test_cache");
+    AudioFile<sample_t> file;
+    BOOST_REQUIRE(file.load(fp));
+
+    std::shared_ptr<const SampleData> first = cache.load(copy);
+    std::shared_ptr<const SampleData> second = cache.load(copy);
+    BOOST_REQUIRE(first);
+    BOOST_REQUIRE(second);
+
+    BOOST_CHECK(first->getSampleRate() == file.getSampleRate());
+    BOOST_CHECK(second->size() == (int)file.samples[0].size());
+    for (int i = 0; i < second->size(); i++) {
+        BOOST_REQUIRE(second->data()[i] == file.samples[0][i]);
+        BOOST_REQUIRE(first->data()[i] == file.samples[0][i]);
+    }
+
+    removeCopy(copy);
+}
+
+BOOST_AUTO_TEST_CASE(resamples) {
+    // Tests loading at another rate resamples into its own cache file, which
+    // survives the source being touched
+    SampleCache cache;
+    std::string copy = copyTestFile("drumpi_test_cache");
+    AudioFile<sample_t> file;
+    BOOST_REQUIRE(file.load(fp));
+    int rate = (file.getSampleRate() == 48000) ? 44100 : 48000;
+    std::string cachePath = cache.getCachePath(copy, rate);
+    std::remove(cachePath.data());
+
+    std::shared_ptr<const SampleData> data = cache.load(copy, rate);
+    BOOST_REQUIRE(data);
+    BOOST_CHECK(data->getSampleRate() == rate);
+    int expected = (int)((long long)file.getNumSamplesPerChannel() * rate / (int)file.getSampleRate());
+    BOOST_CHECK(std::abs(data->size() - expected) <= 1);
+    BOOST_CHECK(cachePath != cache.getCachePath(copy));
+
+    struct stat before, after;
+    BOOST_REQUIRE(stat(cachePath.data(), &before) == 0);
+
+    // A new modification time alone is checked against the hash
+    struct timeval times[2] = {{1000000000, 0}, {1000000000, 0}};
+    BOOST_REQUIRE(utimes(copy.data(), times) == 0);
+
+    std::shared_ptr<const SampleData> again = cache.load(copy, rate);
+    BOOST_REQUIRE(again);
+    BOOST_REQUIRE(stat(cachePath.data(), &after) == 0);
+    BOOST_CHECK(before.st_ino == after.st_ino);
+    BOOST_CHECK(again->size() == data->size());
+
+    std::remove(copy.data());
+    std::remove(cachePath.data());
+}
+
+BOOST_AUTO_TEST_CASE(storesInt16) {
+    // Tests 16-bit storage takes half the memory and mixes like the floats
+    SampleCache cache;
+    std::string copy = copyTestFile("drumpi_test_cache");
+    std::string cachePath = cache.getCachePath(copy, 0, SAMPLE_INT16);
+    std::remove(cachePath.data());
+
+    std::shared_ptr<const SampleData> f = cache.load(copy);
+    std::shared_ptr<const SampleData> first = cache.load(copy, 0, SAMPLE_INT16);
+    std::shared_ptr<const SampleData> second = cache.load(copy, 0, SAMPLE_INT16);
+    BOOST_REQUIRE(f);
+    BOOST_REQUIRE(first);
+    BOOST_REQUIRE(second);
+
+    BOOST_CHECK(second->getFormat() == SAMPLE_INT16);
+    BOOST_CHECK(second->size() == f->size());
+    BOOST_CHECK(second->getBytes() * 2 == f->getBytes());
+    BOOST_CHECK(second->data() == nullptr);
+
+    int n = f->size();
+    std::vector<sample_t> a(n, 0.f), b(n, 0.f), c(n);
+    f->mix(0, 0, a.data(), 1.f, n);
+    second->mix(0, 0, b.data(), 1.f, n);
+    first->read(0, 0, c.data(), n);
+    for (int i = 0; i < n; i++) {
+        BOOST_REQUIRE(std::fabs(a[i] - b[i]) <= int16Scale);
+        BOOST_REQUIRE(b[i] == c[i]);
+    }
+
+    removeCopy(copy);
+    std::remove(cachePath.data());
+}
+
+BOOST_AUTO_TEST_CASE(rejectsMissing) {
+    // Tests a missing file gives no data
+    SampleCache cache;
+
+    BOOST_CHECK(!cache.load("/nonexistent/file.wav"));
+}
+
+BOOST_AUTO_TEST_CASE(concurrentWriters) {
+    // Tests threads building the same cache at once each get whole samples,
+    // and leave no temporary files behind
+    std::string copy = copyTestFile("drumpi_test_cache");
+    SampleCache reference;
+    std::shared_ptr<const SampleData> expected = reference.load(copy);
+    BOOST_REQUIRE(expected);
+
+    for (int round = 0; round < 20; round++) {
+        std::remove(reference.getCachePath(copy).data());
+
+        const int n = 8;
+        std::shared_ptr<const SampleData> loaded[n];
+        std::vector<std::thread> threads;
+        for (int t = 0; t < n; t++) {
+            threads.push_back(std::thread([&, t]() {
+                SampleCache cache;
+                loaded[t] = cache.load(copy);
+            }));
+        }
+        for (int t = 0; t < n; t++) threads[t].join();
+
+        for (int t = 0; t < n; t++) {
+            BOOST_REQUIRE(loaded[t]);
+            BOOST_CHECK(loaded[t]->size() == expected->size());
+            BOOST_CHECK(std::equal(expected->data(), expected->data() + expected->size(), loaded[t]->data()));
+        }
+    }
+
+    glob_t temps;
+    BOOST_CHECK(glob((reference.getCachePath(copy) + ".??????").data(), 0, NULL, &temps) == GLOB_NOMATCH);
+    globfree(&temps);
+
+    removeCopy(copy);
+}
@@ -103,3 +103,17 @@ BOOST_AUTO_TEST_CASE(reset) {
 
     BOOST_CHECK(c.getStatus() == SOURCE_READY);
 }
+
+BOOST_AUTO_TEST_CASE(rendersInPlace) {
+    // Tests rendering into a caller-provided buffer matches getSamples
+    AudioClip c1(fp);
+    AudioClip c2(fp);
+    int n = 4096;
+    std::vector<sample_t> b(n, 1.f);
+
+    std::vector<sample_t> v = c1.getSamples(n);
+    c2.render(b.data(), n);
+
+    BOOST_CHECK(v == b);
+    BOOST_CHECK(c2.getStatus() == c1.getStatus());
+}
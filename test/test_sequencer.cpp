@@ -137,3 +137,41 @@ BOOST_AUTO_TEST_CASE(resetting) {
 	BOOST_CHECK(!error);
 	BOOST_CHECK(seq.getStepNum() == -1);
 }
+
+BOOST_AUTO_TEST_CASE(probability) {
+	// Test probabilities follow the seed and replay from each reset
+	Sequencer seq(numSteps);
+	seq.add(DRUM_1, 0);
+	seq.add(DRUM_2, 0);
+	seq.add(DRUM_3, 0);
+	seq.setProbability(DRUM_1, 0, 50);
+	seq.setProbability(DRUM_3, 0, 0);
+	seq.setSeed(1234);
+
+	const int rounds = 1000;
+	std::vector<uint32_t> first;
+	int played = 0;
+	for (int i = 0; i < rounds; i++) {
+		uint32_t hits = seq.getHits(0);
+		first.push_back(hits);
+		played += (hits >> DRUM_1) & 1;
+
+		// Certain and impossible hits
+		BOOST_REQUIRE((hits >> DRUM_2) & 1);
+		BOOST_REQUIRE(!((hits >> DRUM_3) & 1));
+	}
+	BOOST_CHECK(played > 400 && played < 600);
+
+	// The same hits again after a reset
+	seq.reset(false);
+	bool same = true;
+	for (int i = 0; i < rounds; i++) same = same && seq.getHits(0) == first[i];
+	BOOST_CHECK(same);
+
+	// And different ones from another seed
+	seq.setSeed(5678);
+	same = true;
+	for (int i = 0; i < rounds; i++) same = same && seq.getHits(0) == first[i];
+	BOOST_CHECK(!same);
+	BOOST_CHECK(seq.getSeed() == 5678);
+}
@@ -3,8 +3,13 @@
 #include <boost/test/unit_test.hpp>
 #include "sequencer.hpp"
 #include "playback.hpp"
+#include "testSchedule.hpp"
 #include <thread>
+#include <atomic>
 #include <memory>
+#include <vector>
+#include <utility>
+#include <algorithm>
 
 using namespace drumpi;
 
@@ -36,3 +41,131 @@ BOOST_AUTO_TEST_CASE(clocking) {
 
     BOOST_CHECK(s->getStepNum() == 1);
 }
+
+BOOST_AUTO_TEST_CASE(sampleAccurate) {
+    // Test steps are placed from the engine's frame counter
+    std::shared_ptr<Sequencer> s(new Sequencer(8));
+    audio::PlaybackEngine p;
+    SequencerClock c(s, p, true);
+    int rate = p.getSampleRate();
+    int n = 128;
+    p.loadBank(1, audio::SOURCE_PREGENERATED);
+
+    // 60 BPM = one step per second of frames
+    c.setRateBPM(60);
+    s->add(DRUM_1, 1);
+
+    BOOST_CHECK(c.isSampleAccurate());
+    BOOST_CHECK(!c.isActive());
+
+    c.start();
+    BOOST_CHECK(c.isActive());
+    BOOST_CHECK(s->getStepNum() == -1);
+
+    // First step falls on the first frame rendered
+    p.getSamples(n);
+    BOOST_CHECK(s->getStepNum() == 0);
+    BOOST_CHECK(p.getActive().empty());
+
+    // Render up to one frame before the second step
+    int frames = n;
+    while (frames + n <= rate) {
+        p.getSamples(n);
+        frames += n;
+    }
+    p.getSamples(rate - frames);
+    BOOST_CHECK(s->getStepNum() == 0);
+
+    // Second step, with DRUM_1, starts on the very next frame
+    std::vector<audio::sample_t> v = p.getSamples(1);
+    BOOST_CHECK(s->getStepNum() == 1);
+    BOOST_CHECK(p.getActive().size() == 1);
+
+    c.stop();
+    p.getSamples(rate + n);
+    BOOST_CHECK(s->getStepNum() == 1);
+}
+
+BOOST_AUTO_TEST_CASE(destroyWhileRendering) {
+    // Test sample-accurate clocks can come and go while audio is rendering
+    std::shared_ptr<Sequencer> s(new Sequencer(8));
+    audio::PlaybackEngine p;
+    s->add(DRUM_1, 0);
+
+    std::atomic<bool> rendering{true};
+    std::thread audio([&]() {
+        std::vector<audio::sample_t> buf(64);
+        audio::sample_t* out = buf.data();
+        while (rendering) p.render(&out, 1, 64);
+    });
+
+    for (int i = 0; i < 200; i++) {
+        SequencerClock c(s, p, true);
+        c.setRateBPM(6000);
+        c.start();
+        std::this_thread::yield();
+    }
+
+    rendering = false;
+    audio.join();
+    BOOST_CHECK(s->getStepNum() >= -1);
+}
+
+BOOST_AUTO_TEST_CASE(swingAndOffsets) {
+    // Test swing and per-drum offsets land on exact frames at any period size
+    std::shared_ptr<Sequencer> s(new Sequencer(4));
+    for (int i = 0; i < 4; i++) s->add(DRUM_1, i);
+    s->add(DRUM_2, 0);
+    s->add(DRUM_2, 2);
+
+    // 1000 frames a step; odd steps half a step late
+    s->setSwing(75.f);
+    s->setOffset(DRUM_2, 0, 37);
+    s->setOffset(DRUM_2, 2, -100);
+    BOOST_CHECK(s->getOffset(DRUM_2, 2) == -100);
+
+    std::vector<std::pair<int, int>> expected = {
+        {0, DRUM_1}, {37, DRUM_2}, {1500, DRUM_1}, {1900, DRUM_2},
+        {2000, DRUM_1}, {3500, DRUM_1}, {4000, DRUM_1}, {4037, DRUM_2}
+    };
+
+    int periods[] = {1, 64, 1000, 4096};
+    for (int period : periods) {
+        s->reset(false);
+        SequencerScheduler sch(s);
+        sch.setRateBPM(2880);
+        sch.start();
+
+        std::vector<std::pair<int, int>> hits = scheduleFrames(sch, period, 0, 4096);
+        BOOST_CHECK(hits == expected);
+
+        // Back on the first step of the second bar
+        BOOST_CHECK(s->getStepNum() == 0);
+    }
+
+    // Out of range settings are clamped
+    s->setSwing(90.f);
+    s->setOffset(DRUM_1, 1, 1 << 20);
+    BOOST_CHECK(s->getSwing() == 75.f);
+    BOOST_CHECK(s->getOffset(DRUM_1, 1) == Sequencer::maxOffset);
+}
+
+BOOST_AUTO_TEST_CASE(velocityAndProbability) {
+    // Test scheduled triggers carry their velocity and skip silent drums
+    std::shared_ptr<Sequencer> s(new Sequencer(2));
+    s->add(DRUM_1, 0);
+    s->add(DRUM_2, 0);
+    s->setVelocity(DRUM_1, 0, 40);
+    s->setProbability(DRUM_2, 0, 0);
+
+    SequencerScheduler sch(s);
+    sch.setRateBPM(2880);
+    sch.start();
+
+    audio::EventList events;
+    sch.schedule(0, 64, 48000, events);
+
+    BOOST_REQUIRE(events.size() == 1);
+    BOOST_CHECK(events[0].drum == DRUM_1);
+    BOOST_CHECK(events[0].velocity == 40);
+}
@@ -64,4 +64,54 @@ BOOST_AUTO_TEST_CASE(removeDrums) {
     s.clear();
 
     BOOST_CHECK(s.numActive() == 0);
-}
\ No newline at end of file
+}
+
+BOOST_AUTO_TEST_CASE(offsets) {
+    // Test per-drum timing offsets, and clearing them
+    _SequenceStep s;
+
+    BOOST_CHECK(s.getOffset(DRUM_3) == 0);
+    s.setOffset(DRUM_3, -120);
+    s.setOffset(DRUM_4, 45);
+
+    BOOST_CHECK(s.getOffset(DRUM_3) == -120);
+    BOOST_CHECK(s.getOffset(DRUM_4) == 45);
+
+    s.clear();
+
+    BOOST_CHECK(s.getOffset(DRUM_3) == 0);
+    BOOST_CHECK(s.getOffset(DRUM_4) == 0);
+}
+
+BOOST_AUTO_TEST_CASE(velocityAndProbability) {
+    // Test the packed per-drum settings, their ranges and the drum mask
+    _SequenceStep s;
+
+    BOOST_CHECK(s.getVelocity(DRUM_1) == MAX_VELOCITY);
+    BOOST_CHECK(s.getProbability(DRUM_1) == 100);
+    BOOST_CHECK(s.getMask() == 0);
+
+    s.add(DRUM_2);
+    s.add(DRUM_8);
+    BOOST_CHECK(s.getMask() == ((1u << DRUM_2) | (1u << DRUM_8)));
+    BOOST_CHECK(s.getActive().size() == 2);
+    BOOST_CHECK(s.getActive()[1] == DRUM_8);
+
+    s.setVelocity(DRUM_2, 64);
+    s.setVelocity(DRUM_3, 0);
+    s.setVelocity(DRUM_4, 1000);
+    s.setProbability(DRUM_2, 25);
+    s.setProbability(DRUM_3, -5);
+    s.setProbability(DRUM_4, 150);
+
+    BOOST_CHECK(s.getVelocity(DRUM_2) == 64);
+    BOOST_CHECK(s.getVelocity(DRUM_3) == 1);
+    BOOST_CHECK(s.getVelocity(DRUM_4) == MAX_VELOCITY);
+    BOOST_CHECK(s.getProbability(DRUM_2) == 25);
+    BOOST_CHECK(s.getProbability(DRUM_3) == 0);
+    BOOST_CHECK(s.getProbability(DRUM_4) == 100);
+
+    s.clear();
+    BOOST_CHECK(s.getVelocity(DRUM_2) == MAX_VELOCITY);
+    BOOST_CHECK(s.getProbability(DRUM_2) == 100);
+}
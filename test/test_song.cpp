@@ -0,0 +1,115 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE SongTest
+#include <boost/test/unit_test.hpp>
+#include "song.hpp"
+#include "testSchedule.hpp"
+
+#include "defs.hpp"
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <memory>
+
+using namespace drumpi;
+
+/*! BPM giving 1000 frames a step at 48 kHz. */
+const double bpm = 2880;
+
+// A pattern with one drum on its first step
+std::shared_ptr<Sequencer> makePattern(int numSteps, drumID_t drum) {
+    std::shared_ptr<Sequencer> p(new Sequencer(numSteps));
+    p->add(drum, 0);
+    return p;
+}
+
+BOOST_AUTO_TEST_CASE(patternLength) {
+    // Test pattern lengths are clamped and can change while stepping
+    Sequencer big(1000);
+    BOOST_CHECK(big.getNumSteps() == Sequencer::maxSteps);
+
+    Sequencer seq(16);
+    seq.add(DRUM_1, 200);
+    seq.setNumSteps(0);
+    BOOST_CHECK(seq.getNumSteps() == 1);
+
+    // Steps past the end keep their contents
+    seq.setNumSteps(256);
+    BOOST_CHECK(seq.isActive(DRUM_1, 200));
+
+    // Shrinking behind the current step wraps on the next
+    seq.step(10);
+    seq.setNumSteps(4);
+    seq.step();
+    BOOST_CHECK(seq.getStepNum() == 0);
+}
+
+BOOST_AUTO_TEST_CASE(chainSetting) {
+    // Test adding patterns and checking chains
+    Song song;
+    BOOST_CHECK(song.addPattern(makePattern(4, DRUM_1)) == 0);
+    BOOST_CHECK(song.addPattern(makePattern(2, DRUM_2)) == 1);
+    BOOST_CHECK(song.addPattern(nullptr) == -1);
+    BOOST_CHECK(song.numPatterns() == 2);
+    BOOST_CHECK(song.getPattern(1)->getNumSteps() == 2);
+    BOOST_CHECK(!song.getPattern(2));
+
+    BOOST_CHECK(song.setChain({0, 1, 1}));
+    BOOST_CHECK(!song.setChain({0, 2}));
+    BOOST_CHECK(!song.cue(-1));
+    BOOST_CHECK(song.getChain() == std::vector<int>({0, 1, 1}));
+}
+
+BOOST_AUTO_TEST_CASE(chainOnBarLines) {
+    // Test the chain hands over exactly on each bar line at any period size
+    std::shared_ptr<Sequencer> a = makePattern(4, DRUM_1);
+    std::shared_ptr<Sequencer> b = makePattern(2, DRUM_2);
+
+    std::vector<std::pair<int, int>> expected = {
+        {0, DRUM_1}, {4000, DRUM_2}, {6000, DRUM_2}, {8000, DRUM_1}, {12000, DRUM_2}
+    };
+
+    int periods[] = {1, 128, 1000, 4096};
+    for (int period : periods) {
+        Song song;
+        song.addPattern(a);
+        song.addPattern(b);
+        song.setChain({0, 1, 1});
+
+        SequencerScheduler sch(a);
+        sch.setSong(&song);
+        sch.setRateBPM(bpm);
+        sch.start();
+
+        BOOST_CHECK(scheduleFrames(sch, period, 0, 13000) == expected);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(cueing) {
+    // Test a cued pattern takes over at the next bar line, then the lone
+    // pattern repeats
+    std::shared_ptr<Sequencer> a = makePattern(4, DRUM_1);
+    std::shared_ptr<Sequencer> b = makePattern(2, DRUM_2);
+    Song song;
+    song.addPattern(a);
+    song.addPattern(b);
+
+    SequencerScheduler sch(a);
+    sch.setSong(&song);
+    sch.setRateBPM(bpm);
+    sch.start();
+
+    std::vector<std::pair<int, int>> hits = scheduleFrames(sch, 100, 0, 1000);
+    BOOST_CHECK(sch.getPlaying() == a.get());
+
+    BOOST_CHECK(song.cue(1));
+    std::vector<std::pair<int, int>> more = scheduleFrames(sch, 100, 1000, 9000);
+    hits.insert(hits.end(), more.begin(), more.end());
+
+    std::vector<std::pair<int, int>> expected = {
+        {0, DRUM_1}, {4000, DRUM_2}, {6000, DRUM_2}, {8000, DRUM_2}
+    };
+    BOOST_CHECK(hits == expected);
+    BOOST_CHECK(sch.getPlaying() == b.get());
+    BOOST_CHECK(b->getStepNum() == 0);
+}
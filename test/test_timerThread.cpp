@@ -0,0 +1,82 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE TimerThreadTest
+#include <boost/test/unit_test.hpp>
+#include "timerThread.hpp"
+
+#include <atomic>
+#include <thread>
+#include <chrono>
+
+using namespace drumpi;
+using namespace clock;
+
+class TestTimer : public ThreadTimer {
+    public:
+    std::atomic<int> i{0};
+    std::atomic<bool> onTimerThread{true};
+    ~TestTimer() {
+        stop();
+    }
+    void timerEvent() override {
+        onTimerThread = onTimerThread && TimerThread::instance().isCurrent();
+        i++;
+    }
+};
+
+/*! Timer period in ms. */
+const int period = 5;
+
+BOOST_AUTO_TEST_CASE(runsOnTimerThread) {
+    // Tests events run on the timer thread, not in the caller or a handler
+    TestTimer t;
+    BOOST_CHECK(!TimerThread::instance().isCurrent());
+
+    t.start(period * 1000000L);
+    std::this_thread::sleep_for(std::chrono::milliseconds(4 * period + period / 2));
+    t.stop();
+
+    BOOST_CHECK(t.i >= 2);
+    BOOST_CHECK(t.onTimerThread);
+}
+
+BOOST_AUTO_TEST_CASE(noEventsAfterStop) {
+    // Tests no event starts once stop has returned, and oneshots fire once
+    TestTimer t, o;
+    t.start(period * 1000000L);
+    o.start(period * 1000000L, TIMER_ONESHOT);
+    std::this_thread::sleep_for(std::chrono::milliseconds(3 * period));
+
+    t.stop();
+    int val = t.i;
+    std::this_thread::sleep_for(std::chrono::milliseconds(3 * period));
+
+    BOOST_CHECK(t.i == val);
+    BOOST_CHECK(o.i == 1);
+}
+
+BOOST_AUTO_TEST_CASE(destroyWhileRunning) {
+    // Tests destroying many running timers leaves the thread working
+    for (int n = 0; n < 50; n++) {
+        TestTimer t;
+        t.start(10000L);
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+
+    TestTimer t;
+    t.start(period * 1000000L, TIMER_ONESHOT);
+    std::this_thread::sleep_for(std::chrono::milliseconds(3 * period));
+    BOOST_CHECK(t.i == 1);
+}
+
+BOOST_AUTO_TEST_CASE(scheduling) {
+    // Tests the thread can be pinned and set back to normal scheduling
+    TimerThread& timers = TimerThread::instance();
+
+    BOOST_CHECK(timers.setAffinity(0));
+    BOOST_CHECK(timers.getAffinity() == 0);
+    BOOST_CHECK(timers.setAffinity(-1));
+    BOOST_CHECK(timers.getAffinity() == -1);
+
+    BOOST_CHECK(timers.setPriority(0));
+    BOOST_CHECK(timers.getPriority() == 0);
+}
@@ -0,0 +1,205 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE VoiceTest
+#include <boost/test/unit_test.hpp>
+#include "voice.hpp"
+
+#include <vector>
+#include <memory>
+#include <cmath>
+
+using namespace drumpi;
+using namespace audio;
+
+std::shared_ptr<const SampleData> makeData(int n) {
+    std::vector<sample_t> v(n, 1.f);
+    return std::make_shared<const SampleData>(std::move(v), 48000);
+}
+
+BOOST_AUTO_TEST_CASE(voicePlayback) {
+    // Test a voice mixes its data and stops at the end
+    std::shared_ptr<const SampleData> d = makeData(100);
+    Voice v;
+    std::vector<sample_t> b(64, 0.f);
+    sample_t* out = b.data();
+
+    BOOST_CHECK(!v.isActive());
+
+    v.start(DRUM_2, d, 1);
+    BOOST_CHECK(v.isActive());
+    BOOST_CHECK(v.getDrum() == DRUM_2);
+
+    v.mix(&out, 1, 64, 0.5f);
+    BOOST_CHECK(b[0] == 0.5f);
+    BOOST_CHECK(b[63] == 0.5f);
+    BOOST_CHECK(v.isActive());
+
+    std::fill(b.begin(), b.end(), 0.f);
+    v.mix(&out, 1, 64, 0.5f);
+    BOOST_CHECK(b[35] == 0.5f);
+    BOOST_CHECK(b[36] == 0.f);
+    BOOST_CHECK(!v.isActive());
+}
+
+BOOST_AUTO_TEST_CASE(sharedData) {
+    // Test overlapping hits share the sample data and sum
+    std::shared_ptr<const SampleData> d = makeData(1000);
+    VoicePool p(4);
+    float gains[NUM_DRUMS];
+    std::fill(gains, gains + NUM_DRUMS, 1.f);
+    std::vector<sample_t> b(16, 0.f);
+    sample_t* out = b.data();
+
+    p.start(DRUM_1, d);
+    p.start(DRUM_1, d);
+
+    BOOST_CHECK(p.numActive() == 2);
+    BOOST_CHECK(d.use_count() == 3);
+
+    p.mix(&out, 1, 16, gains);
+    BOOST_CHECK(b[0] == 2.f);
+
+    p.stop(DRUM_1);
+    BOOST_CHECK(p.numActive() == 0);
+    BOOST_CHECK(!p.isActive(DRUM_1));
+}
+
+BOOST_AUTO_TEST_CASE(stealing) {
+    // Test voices are stolen according to the policy
+    std::shared_ptr<const SampleData> d = makeData(1000);
+    VoicePool p(2);
+
+    // Oldest: the first drum's voice is reused
+    p.start(DRUM_1, d);
+    p.start(DRUM_2, d);
+    p.start(DRUM_3, d);
+    BOOST_CHECK(p.numActive() == 2);
+    BOOST_CHECK(!p.isActive(DRUM_1));
+    BOOST_CHECK(p.isActive(DRUM_2));
+    BOOST_CHECK(p.isActive(DRUM_3));
+
+    // Same drum: a retrigger chokes the drum's own voice
+    p.stop(DRUM_2);
+    p.stop(DRUM_3);
+    p.setStealPolicy(STEAL_SAME_DRUM);
+    p.start(DRUM_1, d);
+    p.start(DRUM_1, d);
+    BOOST_CHECK(p.numActive() == 1);
+
+    // Quietest: the voice mixed at the lowest gain is reused
+    float gains[NUM_DRUMS];
+    std::fill(gains, gains + NUM_DRUMS, 1.f);
+    gains[DRUM_2] = 0.1f;
+    std::vector<sample_t> b(16, 0.f);
+    sample_t* out = b.data();
+    p.setStealPolicy(STEAL_QUIETEST);
+    p.start(DRUM_2, d);
+    p.mix(&out, 1, 16, gains);
+    p.start(DRUM_3, d);
+    BOOST_CHECK(p.isActive(DRUM_1));
+    BOOST_CHECK(!p.isActive(DRUM_2));
+    BOOST_CHECK(p.isActive(DRUM_3));
+}
+
+BOOST_AUTO_TEST_CASE(stereoAndPan) {
+    // Test stereo data keeps its channels and mono data is panned
+    std::vector<sample_t> v(32);
+    std::fill(v.begin(), v.begin() + 16, 1.f);
+    std::fill(v.begin() + 16, v.end(), 2.f);
+    std::shared_ptr<const SampleData> stereo = std::make_shared<const SampleData>(std::move(v), 48000, 2);
+    std::shared_ptr<const SampleData> mono = makeData(16);
+    std::vector<sample_t> l(16, 0.f), r(16, 0.f);
+    sample_t* outs[2] = {l.data(), r.data()};
+
+    BOOST_CHECK(stereo->getNumChannels() == 2);
+    BOOST_CHECK(stereo->size() == 16);
+
+    Voice voice;
+    voice.start(DRUM_1, stereo, 1);
+    voice.mix(outs, 2, 16, 1.f);
+    BOOST_CHECK(l[0] == 1.f);
+    BOOST_CHECK(r[15] == 2.f);
+
+    // Mixed down to one output
+    std::vector<sample_t> m(16, 0.f);
+    sample_t* out = m.data();
+    voice.start(DRUM_1, stereo, 2);
+    voice.mix(&out, 1, 16, 1.f);
+    BOOST_CHECK(m[0] == 1.5f);
+
+    // Hard left
+    std::fill(l.begin(), l.end(), 0.f);
+    std::fill(r.begin(), r.end(), 0.f);
+    voice.start(DRUM_1, mono, 3);
+    voice.mix(outs, 2, 16, 1.f, -1.f);
+    BOOST_CHECK(l[0] == 1.f);
+    BOOST_CHECK(r[0] == 0.f);
+
+    // Half right, with a direct pair
+    std::vector<sample_t> dl(16, 0.f), dr(16, 0.f);
+    sample_t* direct[2] = {dl.data(), dr.data()};
+    std::fill(l.begin(), l.end(), 0.f);
+    std::fill(r.begin(), r.end(), 0.f);
+    voice.start(DRUM_1, mono, 4);
+    voice.mix(outs, 2, 16, 1.f, 0.5f, direct, 0.25f);
+    BOOST_CHECK(l[0] == 0.5f);
+    BOOST_CHECK(r[0] == 1.f);
+    BOOST_CHECK(dl[0] == 0.25f);
+    BOOST_CHECK(dr[0] == 0.25f);
+}
+
+BOOST_AUTO_TEST_CASE(gainSmoothing) {
+    // Test a gain change is ramped towards its target rather than stepped,
+    // and a new voice starts at its gain without a ramp
+    std::shared_ptr<const SampleData> d = makeData(4096);
+    std::vector<sample_t> b(64, 0.f);
+    sample_t* out = b.data();
+
+    Voice v;
+    v.setSmoothing(48.f);
+    v.start(DRUM_1, d, 1);
+    v.mix(&out, 1, 64, 1.f);
+    BOOST_CHECK(b[0] == 1.f);
+    BOOST_CHECK(b[63] == 1.f);
+
+    // Halve the gain: the first sample carries on from the old gain and the
+    // rest fall steadily
+    std::fill(b.begin(), b.end(), 0.f);
+    v.mix(&out, 1, 64, 0.5f);
+    BOOST_CHECK(b[0] == 1.f);
+    bool falling = true;
+    for (int i = 1; i < 64; i++) falling = falling && b[i] < b[i - 1] && b[i] > 0.5f;
+    BOOST_CHECK(falling);
+    BOOST_CHECK(std::fabs(b[63] - (0.5f + 0.5f * std::exp(-64.f / 48.f))) < 0.01f);
+
+    // Settles on the target
+    for (int i = 0; i < 20; i++) {
+        std::fill(b.begin(), b.end(), 0.f);
+        v.mix(&out, 1, 64, 0.5f);
+    }
+    BOOST_CHECK(b[0] == 0.5f);
+    BOOST_CHECK(b[63] == 0.5f);
+
+    // Without smoothing the change is immediate
+    v.setSmoothing(0.f);
+    v.start(DRUM_1, d, 2);
+    v.mix(&out, 1, 64, 1.f);
+    std::fill(b.begin(), b.end(), 0.f);
+    v.mix(&out, 1, 64, 0.5f);
+    BOOST_CHECK(b[0] == 0.5f);
+}
+
+BOOST_AUTO_TEST_CASE(velocity) {
+    // Test a hit's velocity scales its gain from the first frame
+    std::shared_ptr<const SampleData> d = makeData(100);
+    VoicePool p(2);
+    float gains[NUM_DRUMS];
+    std::fill(gains, gains + NUM_DRUMS, 0.8f);
+    std::vector<sample_t> b(16, 0.f);
+    sample_t* out = b.data();
+
+    p.start(DRUM_1, d, 0.5f);
+    p.mix(&out, 1, 16, gains);
+
+    BOOST_CHECK(std::abs(b[0] - 0.4f) < 1e-6f);
+    BOOST_CHECK(std::abs(b[15] - 0.4f) < 1e-6f);
+}
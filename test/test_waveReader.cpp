@@ -0,0 +1,115 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE WaveReaderTest
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstdio>
+#include <cstdint>
+#include <cmath>
+#include <cstdlib>
+#include <unistd.h>
+
+#include <AudioFile.h>
+
+// Writes a file of random samples and returns its path
+std::string writeTestFile(int bitDepth, int numChannels, int numFrames, AudioFile<float>& file) {
+    std::string path = "/tmp/drumpi_test_wave_" + std::to_string(getpid()) + ".wav";
+
+    file.setAudioBufferSize(numChannels, numFrames);
+    file.setBitDepth(bitDepth);
+    file.setSampleRate(44100);
+    for (int c = 0; c < numChannels; c++) {
+        for (int i = 0; i < numFrames; i++) {
+            file.samples[c][i] = 1.8f * (float(rand()) / float(RAND_MAX) - 0.5f);
+        }
+    }
+    file.save(path);
+
+    return path;
+}
+
+BOOST_AUTO_TEST_CASE(matchesSource) {
+    // Tests bulk and streamed decoding agree, and match the samples written,
+    // for every bit depth and SIMD and scalar channel counts
+    int bitDepths[] = {8, 16, 24, 32};
+    int numFrames = 10007;
+
+    for (int bitDepth : bitDepths) {
+        for (int numChannels = 1; numChannels <= 3; numChannels++) {
+            AudioFile<float> source;
+            std::string path = writeTestFile(bitDepth, numChannels, numFrames, source);
+
+            AudioFile<float> loaded;
+            BOOST_REQUIRE(loaded.load(path));
+            BOOST_REQUIRE(loaded.getNumChannels() == numChannels);
+            BOOST_REQUIRE(loaded.getNumSamplesPerChannel() == numFrames);
+
+            // Stream in odd-sized chunks
+            WaveReader<float> reader;
+            BOOST_REQUIRE(reader.open(path));
+            BOOST_CHECK(reader.getSampleRate() == 44100);
+            BOOST_CHECK(reader.getBitDepth() == bitDepth);
+            BOOST_REQUIRE(reader.getNumChannels() == numChannels);
+            BOOST_REQUIRE(reader.getNumSamplesPerChannel() == numFrames);
+
+            std::vector<std::vector<float>> streamed(numChannels, std::vector<float>(numFrames));
+            std::vector<float*> out(numChannels);
+            int n, pos = 0;
+            do {
+                for (int c = 0; c < numChannels; c++) out[c] = streamed[c].data() + pos;
+                n = reader.read(out.data(), 4099);
+                pos += n;
+            } while (n > 0);
+            BOOST_CHECK(pos == numFrames);
+            BOOST_CHECK(reader.getPosition() == numFrames);
+
+            float tolerance = (bitDepth == 8) ? 2.f / 128.f : 2.f / 32768.f;
+            bool same = true, close = true;
+            for (int c = 0; c < numChannels; c++) {
+                for (int i = 0; i < numFrames; i++) {
+                    same = same && (streamed[c][i] == loaded.samples[c][i]);
+                    close = close && (std::fabs(loaded.samples[c][i] - source.samples[c][i]) <= tolerance);
+                }
+            }
+            BOOST_CHECK_MESSAGE(same, bitDepth << "-bit " << numChannels << " channel streamed decode differs");
+            BOOST_CHECK_MESSAGE(close, bitDepth << "-bit " << numChannels << " channel decode is inaccurate");
+
+            std::remove(path.data());
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(decodesIntegerFormats) {
+    // Tests the extremes of 24- and 32-bit integer samples
+    uint8_t pcm24[] = {0x00, 0x00, 0x80, 0xff, 0xff, 0x7f, 0x00, 0x00, 0x00};
+    uint8_t pcm32[] = {0x00, 0x00, 0x00, 0x80, 0xff, 0xff, 0xff, 0x7f};
+    float a[3], b[2];
+    float* outA = a;
+    float* outB = b;
+
+    BOOST_REQUIRE(AudioFileDecoding::decode(pcm24, 24, false, 1, &outA, 3));
+    BOOST_CHECK(a[0] == -1.f);
+    BOOST_CHECK(a[1] == 8388607.f / 8388608.f);
+    BOOST_CHECK(a[2] == 0.f);
+
+    BOOST_REQUIRE(AudioFileDecoding::decode(pcm32, 32, false, 1, &outB, 2));
+    BOOST_CHECK(b[0] <= -1.f);
+    BOOST_CHECK(b[1] == 1.f);
+
+    BOOST_CHECK(!AudioFileDecoding::decode(pcm32, 12, false, 1, &outB, 1));
+}
+
+BOOST_AUTO_TEST_CASE(rejectsInvalid) {
+    // Tests missing and non-WAV files are rejected
+    WaveReader<float> reader;
+    std::string path = "/tmp/drumpi_test_wave_" + std::to_string(getpid()) + ".txt";
+    std::ofstream(path) << "not a wave file, just some text";
+
+    BOOST_CHECK(!reader.open("/nonexistent/file.wav"));
+    BOOST_CHECK(!reader.open(path));
+    BOOST_CHECK(reader.getNumSamplesPerChannel() == 0);
+
+    std::remove(path.data());
+}